@@ -0,0 +1,116 @@
+#include "benchmark.hpp"
+
+#include <gravel/actor.hpp>
+#include <gravel/thread_pool.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t actor_count = 10'000;
+	constexpr std::size_t tokens = 1'000;
+	constexpr std::size_t hops = 1'000;
+
+	//!
+	//! An actor of the ring, forwarding tokens to the next one
+	//!
+	struct Node
+	{
+		gravel::actor<Node>* next = nullptr;
+		std::uint64_t seen = 0;
+	};
+
+	struct Hop
+	{
+		void operator()(Node& node)
+		{
+			node.seen += 1;
+			if (remaining == 0)
+			{
+				finished->fetch_add(1, std::memory_order_release);
+				return;
+			}
+			node.next->send(Hop{ remaining - 1, finished });
+		}
+
+		std::size_t remaining;
+		std::atomic<std::size_t>* finished;
+	};
+
+	//!
+	//! What actors replace, an object guarded by its own mutex, updated from pool tasks
+	//!
+	struct LockedNode
+	{
+		std::mutex mutex;
+		std::uint64_t seen = 0;
+	};
+
+	void locked_hop(gravel::thread_pool& pool, std::vector<LockedNode>& nodes, std::size_t index, std::size_t remaining, std::atomic<std::size_t>& finished)
+	{
+		{
+			std::scoped_lock lock(nodes[index].mutex);
+			nodes[index].seen += 1;
+		}
+		if (remaining == 0)
+		{
+			finished.fetch_add(1, std::memory_order_release);
+			return;
+		}
+		pool.submit([&pool, &nodes, index, remaining, &finished]()
+		{
+			locked_hop(pool, nodes, (index + 1) % nodes.size(), remaining - 1, finished);
+		});
+	}
+
+	template <typename StartT>
+	double run_ring(gravel::thread_pool& pool, std::atomic<std::size_t>& finished, StartT&& start)
+	{
+		return benchmark::time([&]()
+		{
+			for (std::size_t token = 0; token < tokens; ++token)
+			{
+				start(token * (actor_count / tokens));
+			}
+			pool.run_until([&finished]() { return finished.load(std::memory_order_acquire) == tokens; });
+		});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		{
+			gravel::thread_pool pool(threads);
+			std::vector<std::unique_ptr<gravel::actor<Node>>> actors;
+			for (std::size_t i = 0; i < actor_count; ++i)
+			{
+				actors.push_back(std::make_unique<gravel::actor<Node>>(pool));
+			}
+			for (std::size_t i = 0; i < actor_count; ++i)
+			{
+				gravel::actor<Node>* next = actors[(i + 1) % actor_count].get();
+				actors[i]->send([next](Node& node) { node.next = next; });
+			}
+			std::atomic<std::size_t> finished{ 0 };
+			const double seconds = run_ring(pool, finished, [&](std::size_t index) { actors[index]->send(Hop{ hops - 1, &finished }); });
+			benchmark::report("actor messages (10k actors)", threads, tokens * hops, seconds);
+		}
+		{
+			gravel::thread_pool pool(threads);
+			std::vector<LockedNode> nodes(actor_count);
+			std::atomic<std::size_t> finished{ 0 };
+			const double seconds = run_ring(pool, finished, [&](std::size_t index)
+			{
+				pool.submit([&pool, &nodes, index, &finished]() { locked_hop(pool, nodes, index, hops - 1, finished); });
+			});
+			benchmark::report("mutex per object + pool tasks", threads, tokens * hops, seconds);
+		}
+	}
+}
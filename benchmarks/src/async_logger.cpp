@@ -0,0 +1,79 @@
+#include "benchmark.hpp"
+
+#include <gravel/async_logger.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+	constexpr std::size_t bursts = 200;
+	//! Records per burst, no more than a ring holds so that none is dropped
+	constexpr std::size_t burst_size = 1000;
+
+	//!
+	//! Times every call of log_one, flushing between bursts outside of the measurement
+	//!
+	template <typename LogT, typename FlushT>
+	void run(const char* name, LogT&& log_one, FlushT&& flush)
+	{
+		std::vector<double> latencies;
+		latencies.reserve(bursts * burst_size);
+		for (std::size_t burst = 0; burst < bursts; ++burst)
+		{
+			for (std::size_t i = 0; i < burst_size; ++i)
+			{
+				const auto start = std::chrono::steady_clock::now();
+				log_one(burst * burst_size + i);
+				latencies.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+			}
+			flush();
+		}
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&latencies](double fraction) { return latencies[static_cast<std::size_t>(fraction * static_cast<double>(latencies.size() - 1))]; };
+		std::printf("%-40s p50: %8.1f ns  p99: %8.1f ns  p99.9: %8.1f ns\n", name, percentile(0.5), percentile(0.99), percentile(0.999));
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+	const char* peer = "10.0.0.1";
+	{
+		gravel::async_logger logger(fd, burst_size);
+		run("async_logger", [&](std::size_t i)
+		{
+			logger.log(gravel::log_level::info, [i, peer](std::string& out)
+			{
+				out += "Request ";
+				out += std::to_string(i);
+				out += " from ";
+				out += peer;
+				out += " took ";
+				out += std::to_string(i % 1000 * 0.25);
+				out += " ms";
+			});
+		}, [&]() { logger.flush(); });
+	}
+	{
+		std::string line;
+		run("format and write on the calling thread", [&](std::size_t i)
+		{
+			line.assign("INFO Request ");
+			line += std::to_string(i);
+			line += " from ";
+			line += peer;
+			line += " took ";
+			line += std::to_string(i % 1000 * 0.25);
+			line += " ms\n";
+			[[maybe_unused]] const auto written = ::write(fd, line.data(), line.size());
+		}, []() {});
+	}
+	::close(fd);
+}
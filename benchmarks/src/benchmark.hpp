@@ -0,0 +1,78 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace benchmark
+{
+	//!
+	//! Thread counts to measure scaling at, powers of two up to and including the number of hardware threads
+	//!
+	inline std::vector<std::size_t> thread_counts()
+	{
+		const std::size_t hardware = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+		std::vector<std::size_t> counts;
+		for (std::size_t count = 1; count < hardware; count *= 2)
+		{
+			counts.push_back(count);
+		}
+		counts.push_back(hardware);
+		return counts;
+	}
+
+	//!
+	//! Runs body(thread_index) on thread_count threads that are released at the same time
+	//! @return the wall clock time in seconds until all threads finished
+	//!
+	template <typename FuncT>
+	double run_threads(std::size_t thread_count, FuncT&& body)
+	{
+		std::atomic<bool> go = false;
+		std::atomic<std::size_t> ready = 0;
+		std::vector<std::thread> threads;
+		for (std::size_t i = 0; i < thread_count; ++i)
+		{
+			threads.emplace_back([&, i]()
+			{
+				ready += 1;
+				while (!go.load(std::memory_order_acquire))
+				{
+				}
+				body(i);
+			});
+		}
+		while (ready.load() < thread_count)
+		{
+		}
+
+		const auto start = std::chrono::steady_clock::now();
+		go.store(true, std::memory_order_release);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	//!
+	//! Times a single-threaded body
+	//! @return the wall clock time in seconds body took
+	//!
+	template <typename FuncT>
+	double time(FuncT&& body)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		body();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	inline void report(const char* name, std::size_t threads, std::size_t operations, double seconds)
+	{
+		std::printf("%-40s threads: %3zu  %10.2f Mops/s  %8.2f ns/op\n", name, threads,
+			static_cast<double>(operations) / seconds / 1e6, seconds * 1e9 / static_cast<double>(operations));
+	}
+}
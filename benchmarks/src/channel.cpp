@@ -0,0 +1,121 @@
+#include "benchmark.hpp"
+
+#include <gravel/channel.hpp>
+#include <gravel/task.hpp>
+#include <gravel/thread_pool.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace
+{
+	constexpr std::size_t round_trips = 200'000;
+
+	//!
+	//! Mutex and condition variable protected deque, the blocking queue a channel between threads replaces
+	//!
+	class LockedQueue
+	{
+	public:
+		void push(std::size_t value)
+		{
+			{
+				std::scoped_lock lock(m_mutex);
+				m_values.push_back(value);
+			}
+			m_not_empty.notify_one();
+		}
+
+		std::size_t pop()
+		{
+			std::unique_lock lock(m_mutex);
+			m_not_empty.wait(lock, [this]() { return !m_values.empty(); });
+			const std::size_t value = m_values.front();
+			m_values.pop_front();
+			return value;
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_not_empty;
+		std::deque<std::size_t> m_values;
+	};
+
+	gravel::task<void> ping(gravel::channel<std::size_t>& out, gravel::channel<std::size_t>& in)
+	{
+		for (std::size_t i = 0; i < round_trips; ++i)
+		{
+			co_await out.send(i);
+			co_await in.recv();
+		}
+		out.close();
+	}
+
+	gravel::task<void> pong(gravel::channel<std::size_t>& in, gravel::channel<std::size_t>& out)
+	{
+		while (std::optional<std::size_t> value = co_await in.recv())
+		{
+			co_await out.send(*value);
+		}
+	}
+
+	//!
+	//! Like pong, but hops back onto the pool after every receive, so that each round trip crosses threads
+	//!
+	gravel::task<void> pong_on(gravel::thread_pool& pool, gravel::channel<std::size_t>& in, gravel::channel<std::size_t>& out)
+	{
+		while (std::optional<std::size_t> value = co_await in.recv())
+		{
+			co_await pool.schedule();
+			co_await out.send(*value);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	{
+		gravel::channel<std::size_t> requests(1);
+		gravel::channel<std::size_t> replies(1);
+		const double seconds = benchmark::time([&]()
+		{
+			gravel::future<void> replied = gravel::start(pong(requests, replies));
+			gravel::start(ping(requests, replies)).get();
+			replied.get();
+		});
+		benchmark::report("channel ping-pong (coroutines)", 1, round_trips, seconds);
+	}
+	{
+		gravel::thread_pool pool(2);
+		gravel::channel<std::size_t> requests(1);
+		gravel::channel<std::size_t> replies(1);
+		const double seconds = benchmark::time([&]()
+		{
+			gravel::future<void> replied = gravel::start(pong_on(pool, requests, replies));
+			gravel::start(ping(requests, replies)).get();
+			replied.get();
+		});
+		benchmark::report("channel ping-pong (thread_pool hop)", 2, round_trips, seconds);
+	}
+	{
+		LockedQueue requests;
+		LockedQueue replies;
+		const double seconds = benchmark::run_threads(2, [&](std::size_t index)
+		{
+			for (std::size_t i = 0; i < round_trips; ++i)
+			{
+				if (index == 0)
+				{
+					requests.push(i);
+					replies.pop();
+				}
+				else
+				{
+					replies.push(requests.pop());
+				}
+			}
+		});
+		benchmark::report("mutex + condvar ping-pong (threads)", 2, round_trips, seconds);
+	}
+}
@@ -0,0 +1,90 @@
+#include "benchmark.hpp"
+
+#include <gravel/command_buffer.hpp>
+#include <gravel/unique_function.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t frames = 1'000;
+	constexpr std::size_t commands_per_frame = 10'000;
+
+	struct Context
+	{
+		std::uint64_t state = 0;
+		float position[4] = {};
+	};
+
+	//!
+	//! Records a frame of commands of a few sizes, as draw and update calls would, then replays and resets them
+	//!
+	template <typename RecordT, typename ReplayT, typename ResetT>
+	void run(const char* name, RecordT&& record, ReplayT&& replay, ResetT&& reset)
+	{
+		Context context;
+		const double seconds = benchmark::time([&]()
+		{
+			for (std::size_t frame = 0; frame < frames; ++frame)
+			{
+				for (std::size_t i = 0; i < commands_per_frame; i += 4)
+				{
+					record([i](Context& context) { context.state += i; });
+					record([x = float(i), y = float(frame), z = 1.0f, w = 0.5f, id = i](Context& context)
+					{
+						context.position[id & 3] += x * y + z * w;
+					});
+					record([i](Context& context) { context.state -= i / 2; });
+					// A draw with its transform, larger than the small buffer of unique_function
+					record([transform = std::array<float, 12>{ float(i), 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, float(frame) }, id = i](Context& context)
+					{
+						context.position[id & 3] += transform[0] * transform[5] + transform[11];
+					});
+				}
+				replay(context);
+				reset();
+			}
+		});
+		benchmark::report(name, 1, frames * commands_per_frame, seconds);
+		if (context.state == 0)
+		{
+			std::printf("unexpected state\n");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	{
+		gravel::command_buffer<void(Context&)> commands;
+		run("command_buffer record + replay", [&](auto&& command) { commands.record(std::move(command)); },
+			[&](Context& context) { commands.replay(context); }, [&]() { commands.reset(); });
+	}
+	{
+		std::vector<gravel::unique_function<void(Context&)>> commands;
+		run("vector<unique_function> record + replay", [&](auto&& command) { commands.emplace_back(std::move(command)); },
+			[&](Context& context)
+			{
+				for (auto& command : commands)
+				{
+					command(context);
+				}
+			},
+			[&]() { commands.clear(); });
+	}
+	{
+		std::vector<std::function<void(Context&)>> commands;
+		run("vector<std::function> record + replay", [&](auto&& command) { commands.emplace_back(std::move(command)); },
+			[&](Context& context)
+			{
+				for (auto& command : commands)
+				{
+					command(context);
+				}
+			},
+			[&]() { commands.clear(); });
+	}
+}
@@ -0,0 +1,122 @@
+#include "benchmark.hpp"
+
+#include <gravel/delegate.hpp>
+#include <gravel/unique_function.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t listener_count = 1'024;
+	constexpr std::size_t rounds = 50'000;
+
+	class Listener
+	{
+	public:
+		void on_value(std::uint64_t value)
+		{
+			m_total += value;
+		}
+
+		void on_scaled(std::uint64_t value)
+		{
+			m_total += value * 3;
+		}
+
+		void on_shifted(std::uint64_t value)
+		{
+			m_total += value << 2;
+		}
+
+		void on_offset(std::uint64_t value)
+		{
+			m_total += value + 7;
+		}
+
+		std::uint64_t total() const
+		{
+			return m_total;
+		}
+
+	private:
+		std::uint64_t m_total = 0;
+	};
+
+	//!
+	//! Binds one of four member functions of every listener, then calls them all round after round. Binding a single
+	//! member function would let the compiler devirtualize calls through unique_function and std::function by
+	//! guessing their only target.
+	//!
+	template <typename FunctionT, typename BindT>
+	void run(const char* name, BindT&& bind)
+	{
+		std::vector<Listener> listeners(listener_count);
+		std::vector<FunctionT> functions;
+		functions.reserve(listener_count);
+		const double bind_seconds = benchmark::time([&]()
+		{
+			for (std::size_t i = 0; i < listener_count; ++i)
+			{
+				functions.push_back(bind(listeners[i], i % 4));
+			}
+		});
+		const double seconds = benchmark::time([&]()
+		{
+			for (std::uint64_t round = 0; round < rounds; ++round)
+			{
+				for (FunctionT& function : functions)
+				{
+					function(round);
+				}
+			}
+		});
+		std::printf("%s, %zu bytes\n", name, sizeof(FunctionT));
+		benchmark::report("  bind", 1, listener_count, bind_seconds);
+		benchmark::report("  call", 1, rounds * listener_count, seconds);
+		if (listeners[0].total() == 0)
+		{
+			std::printf("unexpected total\n");
+		}
+	}
+
+	//!
+	//! Binds the kind-th member function through a lambda, as is done without delegate
+	//!
+	template <typename FunctionT>
+	FunctionT bind_lambda(Listener& listener, std::size_t kind)
+	{
+		switch (kind)
+		{
+		case 0:
+			return FunctionT([&listener](std::uint64_t value) { listener.on_value(value); });
+		case 1:
+			return FunctionT([&listener](std::uint64_t value) { listener.on_scaled(value); });
+		case 2:
+			return FunctionT([&listener](std::uint64_t value) { listener.on_shifted(value); });
+		default:
+			return FunctionT([&listener](std::uint64_t value) { listener.on_offset(value); });
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	run<gravel::delegate<void(std::uint64_t)>>("delegate", [](Listener& listener, std::size_t kind)
+	{
+		switch (kind)
+		{
+		case 0:
+			return gravel::bind<&Listener::on_value>(&listener);
+		case 1:
+			return gravel::bind<&Listener::on_scaled>(&listener);
+		case 2:
+			return gravel::bind<&Listener::on_shifted>(&listener);
+		default:
+			return gravel::bind<&Listener::on_offset>(&listener);
+		}
+	});
+	run<gravel::unique_function<void(std::uint64_t)>>("unique_function", bind_lambda<gravel::unique_function<void(std::uint64_t)>>);
+	run<std::function<void(std::uint64_t)>>("std::function", bind_lambda<std::function<void(std::uint64_t)>>);
+}
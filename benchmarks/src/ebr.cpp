@@ -0,0 +1,52 @@
+#include "benchmark.hpp"
+
+#include <gravel/ebr.hpp>
+
+namespace
+{
+	struct Node
+	{
+		std::size_t value;
+	};
+
+	constexpr std::size_t operations_per_thread = 2'000'000;
+
+	//!
+	//! Every thread pins and reads a shared node, and replaces it once every write_interval operations
+	//!
+	void run(const char* name, std::size_t thread_count, std::size_t write_interval)
+	{
+		gravel::ebr::domain domain;
+		std::atomic<Node*> shared = new Node{ 0 };
+		std::atomic<std::size_t> sink = 0;
+
+		const double seconds = benchmark::run_threads(thread_count, [&](std::size_t)
+		{
+			std::size_t sum = 0;
+			for (std::size_t i = 1; i <= operations_per_thread; ++i)
+			{
+				auto guard = domain.pin();
+				sum += shared.load(std::memory_order_acquire)->value;
+				if (write_interval && i % write_interval == 0)
+				{
+					domain.retire(shared.exchange(new Node{ i }));
+				}
+			}
+			sink += sum;
+		});
+		benchmark::report(name, thread_count, operations_per_thread * thread_count, seconds);
+		delete shared.load();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		run("ebr pin/read", threads, 0);
+	}
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		run("ebr pin/read, 1/64 retire", threads, 64);
+	}
+}
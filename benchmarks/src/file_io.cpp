@@ -0,0 +1,103 @@
+#include "benchmark.hpp"
+
+#include <gravel/file_io.hpp>
+
+#include <cstddef>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+	constexpr std::size_t block_size = 64 * 1024;
+	constexpr std::size_t blocks = 2048;
+	constexpr std::size_t queue_depth = 64;
+	//! tmpfs, so that the numbers measure the submission path rather than a disk
+	constexpr const char* path = "/dev/shm/gravel_file_io_benchmark";
+
+	void report_bandwidth(const char* name, double seconds)
+	{
+		benchmark::report(name, 1, blocks, seconds);
+		std::printf("%-40s %10.2f GiB/s\n", "", static_cast<double>(blocks * block_size) / seconds / (1024.0 * 1024.0 * 1024.0));
+	}
+
+	//!
+	//! Writes and then reads the whole file in blocks, keeping up to queue_depth operations in flight
+	//!
+	void run(const char* write_name, const char* read_name, gravel::thread_pool& pool, gravel::file_io::backend preferred)
+	{
+		gravel::file_io io(pool, queue_depth, preferred);
+		if (io.active_backend() != preferred)
+		{
+			std::printf("%-40s unavailable\n", write_name);
+			return;
+		}
+		const int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+		std::vector<std::byte> buffer(block_size * queue_depth, std::byte{ 1 });
+
+		std::size_t failed = 0;
+		auto transfer = [&](bool write)
+		{
+			for (std::size_t i = 0; i < blocks; ++i)
+			{
+				const std::span<std::byte> block = std::span(buffer).subspan(i % queue_depth * block_size, block_size);
+				auto done = [&failed](ssize_t result) { failed += result != block_size; };
+				if (write)
+				{
+					io.async_write(fd, block, i * block_size, std::move(done));
+				}
+				else
+				{
+					io.async_read(fd, block, i * block_size, std::move(done));
+				}
+				// The buffer of a block is reused queue_depth blocks later
+				while (io.in_flight() >= queue_depth)
+				{
+					io.wait();
+				}
+			}
+			io.drain();
+		};
+		report_bandwidth(write_name, benchmark::time([&]() { transfer(true); }));
+		report_bandwidth(read_name, benchmark::time([&]() { transfer(false); }));
+		if (failed != 0)
+		{
+			std::printf("%zu operations failed\n", failed);
+		}
+		::close(fd);
+		::unlink(path);
+	}
+
+	void run_synchronous()
+	{
+		const int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+		std::vector<std::byte> buffer(block_size, std::byte{ 1 });
+		report_bandwidth("pwrite", benchmark::time([&]()
+		{
+			for (std::size_t i = 0; i < blocks; ++i)
+			{
+				[[maybe_unused]] const auto written = ::pwrite(fd, buffer.data(), block_size, static_cast<off_t>(i * block_size));
+			}
+		}));
+		report_bandwidth("pread", benchmark::time([&]()
+		{
+			for (std::size_t i = 0; i < blocks; ++i)
+			{
+				[[maybe_unused]] const auto read = ::pread(fd, buffer.data(), block_size, static_cast<off_t>(i * block_size));
+			}
+		}));
+		::close(fd);
+		::unlink(path);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	gravel::thread_pool pool;
+	run("file_io write (io_uring)", "file_io read (io_uring)", pool, gravel::file_io::backend::io_uring);
+	run("file_io write (thread_pool)", "file_io read (thread_pool)", pool, gravel::file_io::backend::thread_pool);
+	run_synchronous();
+}
@@ -0,0 +1,26 @@
+#include "benchmark.hpp"
+
+#include <gravel/flight_recorder.hpp>
+
+#include <cstdint>
+
+namespace
+{
+	constexpr std::size_t events_per_thread = 10'000'000;
+}
+
+int main(int argc, char** argv)
+{
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		gravel::flight_recorder recorder;
+		const double seconds = benchmark::run_threads(threads, [&](std::size_t index)
+		{
+			for (std::uint64_t i = 0; i < events_per_thread; ++i)
+			{
+				recorder.record(0x100, index, i);
+			}
+		});
+		benchmark::report("flight_recorder record", threads, events_per_thread, seconds);
+	}
+}
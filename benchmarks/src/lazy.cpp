@@ -0,0 +1,133 @@
+#include "benchmark.hpp"
+
+#include <gravel/lazy.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t value_count = 1'000'000;
+	//! One value in read_stride is ever read
+	constexpr std::size_t read_stride = 100;
+	constexpr std::size_t reads = 100'000'000;
+
+	//!
+	//! A derived value that is expensive to compute
+	//!
+	double derive(std::size_t seed)
+	{
+		double value = static_cast<double>(seed);
+		for (int i = 0; i < 200; ++i)
+		{
+			value = std::sqrt(value + i);
+		}
+		return value;
+	}
+
+	//!
+	//! What atomic_lazy is compared to, an optional guarded by std::call_once
+	//!
+	struct OnceValue
+	{
+		template <typename FuncT>
+		double& get(FuncT&& produce)
+		{
+			std::call_once(flag, [&]() { value.emplace(produce()); });
+			return *value;
+		}
+
+		std::once_flag flag;
+		std::optional<double> value;
+	};
+
+	//!
+	//! Creates value_count values and reads one in read_stride of them
+	//!
+	template <typename CreateT, typename ReadT>
+	void run_sparse(const char* name, CreateT&& create, ReadT&& read)
+	{
+		double sum = 0;
+		const double seconds = benchmark::time([&]()
+		{
+			auto values = create();
+			for (std::size_t i = 0; i < value_count; i += read_stride)
+			{
+				sum += read(values, i);
+			}
+		});
+		benchmark::report(name, 1, value_count, seconds);
+		if (sum == 0)
+		{
+			std::printf("unexpected sum\n");
+		}
+	}
+
+	//!
+	//! Reads an already computed value over and over
+	//!
+	template <typename ReadT>
+	void run_reads(const char* name, ReadT&& read)
+	{
+		double sum = 0;
+		const double seconds = benchmark::time([&]()
+		{
+			for (std::size_t i = 0; i < reads; ++i)
+			{
+				sum += read();
+			}
+		});
+		benchmark::report(name, 1, reads, seconds);
+		if (sum == 0)
+		{
+			std::printf("unexpected sum\n");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	run_sparse("eager values, 1% read", []()
+	{
+		std::vector<double> values;
+		values.reserve(value_count);
+		for (std::size_t i = 0; i < value_count; ++i)
+		{
+			values.push_back(derive(i));
+		}
+		return values;
+	}, [](std::vector<double>& values, std::size_t i) { return values[i]; });
+
+	run_sparse("lazy values, 1% read", []()
+	{
+		std::vector<gravel::lazy<double>> values;
+		values.reserve(value_count);
+		for (std::size_t i = 0; i < value_count; ++i)
+		{
+			values.emplace_back([i]() { return derive(i); });
+		}
+		return values;
+	}, [](std::vector<gravel::lazy<double>>& values, std::size_t i) { return values[i].get(); });
+
+	run_sparse("atomic_lazy values, 1% read", []()
+	{
+		std::vector<std::unique_ptr<gravel::atomic_lazy<double>>> values;
+		values.reserve(value_count);
+		for (std::size_t i = 0; i < value_count; ++i)
+		{
+			values.push_back(std::make_unique<gravel::atomic_lazy<double>>([i]() { return derive(i); }));
+		}
+		return values;
+	}, [](std::vector<std::unique_ptr<gravel::atomic_lazy<double>>>& values, std::size_t i) { return values[i]->get(); });
+
+	gravel::lazy<double> single([]() { return derive(1); });
+	run_reads("lazy get, computed", [&single]() { return single.get(); });
+	gravel::atomic_lazy<double> shared([]() { return derive(1); });
+	run_reads("atomic_lazy get, computed", [&shared]() { return shared.get(); });
+	OnceValue once;
+	run_reads("call_once + optional, computed", [&once]() { return once.get([]() { return derive(1); }); });
+}
@@ -0,0 +1,97 @@
+#include "benchmark.hpp"
+
+#include <gravel/mpmc_queue.hpp>
+#include <gravel/unique_function.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace
+{
+	constexpr std::size_t total_tasks = 2'000'000;
+	constexpr std::size_t capacity = 1024;
+
+	//!
+	//! Bounded mutex and condition variable protected deque of std::function, what mpmc_queue is meant to replace
+	//!
+	class LockedQueue
+	{
+	public:
+		void push(std::function<void()>&& task)
+		{
+			std::unique_lock lock(m_mutex);
+			m_not_full.wait(lock, [this]() { return m_tasks.size() < capacity; });
+			m_tasks.push_back(std::move(task));
+			lock.unlock();
+			m_not_empty.notify_one();
+		}
+
+		std::function<void()> pop()
+		{
+			std::unique_lock lock(m_mutex);
+			m_not_empty.wait(lock, [this]() { return !m_tasks.empty(); });
+			std::function<void()> task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			lock.unlock();
+			m_not_full.notify_one();
+			return task;
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_not_empty;
+		std::condition_variable m_not_full;
+		std::deque<std::function<void()>> m_tasks;
+	};
+
+	//!
+	//! Half of thread_count threads push total_tasks tasks between them, the other half pops and runs them
+	//!
+	template <typename PushT, typename PopT>
+	void run(const char* name, std::size_t thread_count, PushT&& push, PopT&& pop)
+	{
+		const std::size_t producers = std::max<std::size_t>(1, thread_count / 2);
+		const std::size_t consumers = std::max<std::size_t>(1, thread_count - producers);
+		const std::size_t per_producer = total_tasks / producers / consumers * consumers;
+		const std::size_t per_consumer = per_producer * producers / consumers;
+		const double seconds = benchmark::run_threads(producers + consumers, [&](std::size_t index)
+		{
+			if (index < producers)
+			{
+				for (std::size_t i = 0; i < per_producer; ++i)
+				{
+					push(i);
+				}
+				return;
+			}
+			for (std::size_t i = 0; i < per_consumer; ++i)
+			{
+				pop();
+			}
+		});
+		benchmark::report(name, producers + consumers, per_producer * producers, seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		gravel::mpmc_queue<gravel::unique_function<void()>> queue(capacity);
+		std::atomic<std::size_t> sum = 0;
+		run("mpmc_queue<unique_function>", threads,
+			[&](std::size_t i) { queue.emplace([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); }); },
+			[&]() { queue.pop()(); });
+	}
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		LockedQueue queue;
+		std::atomic<std::size_t> sum = 0;
+		run("mutex + condvar + deque<std::function>", threads,
+			[&](std::size_t i) { queue.push([&sum, i]() { sum.fetch_add(i, std::memory_order_relaxed); }); },
+			[&]() { queue.pop()(); });
+	}
+}
@@ -0,0 +1,90 @@
+#include "benchmark.hpp"
+
+#include <gravel/mpsc_queue.hpp>
+#include <gravel/unique_function.hpp>
+
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace
+{
+	constexpr std::size_t total_tasks = 4'000'000;
+
+	//!
+	//! Mutex protected deque of std::function, what mpsc_queue is meant to replace
+	//!
+	class LockedQueue
+	{
+	public:
+		void push(std::function<void()>&& task)
+		{
+			std::lock_guard lock(m_mutex);
+			m_tasks.push_back(std::move(task));
+		}
+
+		std::size_t consume()
+		{
+			std::deque<std::function<void()>> batch;
+			{
+				std::lock_guard lock(m_mutex);
+				batch.swap(m_tasks);
+			}
+			for (auto& task : batch)
+			{
+				task();
+			}
+			return batch.size();
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::deque<std::function<void()>> m_tasks;
+	};
+
+	//!
+	//! producer_count threads push total_tasks tasks between them while one consumer runs them
+	//!
+	template <typename PushT, typename ConsumeT>
+	void run(const char* name, std::size_t producer_count, PushT&& push, ConsumeT&& consume)
+	{
+		const std::size_t per_producer = total_tasks / producer_count;
+		const double seconds = benchmark::run_threads(producer_count + 1, [&](std::size_t index)
+		{
+			if (index == producer_count)
+			{
+				std::size_t consumed = 0;
+				while (consumed < per_producer * producer_count)
+				{
+					consumed += consume();
+				}
+				return;
+			}
+			for (std::size_t i = 0; i < per_producer; ++i)
+			{
+				push(i);
+			}
+		});
+		benchmark::report(name, producer_count, per_producer * producer_count, seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (std::size_t producers : { 1, 4, 16 })
+	{
+		gravel::mpsc_queue<gravel::unique_function<void()>> queue;
+		std::size_t sum = 0;
+		run("mpsc_queue<unique_function>", producers,
+			[&](std::size_t i) { queue.emplace([&sum, i]() { sum += i; }); },
+			[&]() { return queue.consume([](gravel::unique_function<void()>&& task) { task(); }, 256); });
+	}
+	for (std::size_t producers : { 1, 4, 16 })
+	{
+		LockedQueue queue;
+		std::size_t sum = 0;
+		run("mutex + deque<std::function>", producers,
+			[&](std::size_t i) { queue.push([&sum, i]() { sum += i; }); },
+			[&]() { return queue.consume(); });
+	}
+}
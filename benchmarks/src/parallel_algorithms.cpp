@@ -0,0 +1,116 @@
+#include "benchmark.hpp"
+
+#include <gravel/dynamic_value.hpp>
+#include <gravel/parallel_algorithms.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t plain_size = 1 << 24;
+	constexpr std::size_t shape_size = 1 << 21;
+
+	class Shape
+	{
+	public:
+		virtual ~Shape() = default;
+		virtual double area() const = 0;
+	};
+
+	class Square : public Shape
+	{
+	public:
+		explicit Square(double side)
+			: m_side(side)
+		{
+		}
+
+		double area() const override
+		{
+			return m_side * m_side;
+		}
+
+	private:
+		double m_side;
+	};
+
+	class Circle : public Shape
+	{
+	public:
+		explicit Circle(double radius)
+			: m_radius(radius)
+		{
+		}
+
+		double area() const override
+		{
+			return 3.14159 * m_radius * m_radius;
+		}
+
+	private:
+		double m_radius;
+	};
+
+	using ShapeValue = gravel::dynamic_value<Shape, gravel::Properties<gravel::Attr::Movable>>;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<double> plain(plain_size);
+	std::vector<std::uint32_t> keys(plain_size);
+	std::vector<ShapeValue> shapes;
+	shapes.reserve(shape_size);
+	for (std::size_t i = 0; i < shape_size; ++i)
+	{
+		const double size = static_cast<double>((i * 2654435761u) % 1000);
+		if (i % 2 == 0)
+		{
+			shapes.emplace_back(ShapeValue::make_emplaced<Square>(size));
+		}
+		else
+		{
+			shapes.emplace_back(ShapeValue::make_emplaced<Circle>(size));
+		}
+	}
+	std::vector<double> areas(shape_size);
+
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		gravel::thread_pool pool(threads);
+
+		benchmark::report("parallel_for sqrt (double)", threads, plain_size, benchmark::time([&]()
+		{
+			gravel::parallel_for(pool, std::size_t(0), plain_size, [&plain](std::size_t i) { plain[i] = std::sqrt(static_cast<double>(i)); });
+		}));
+		double sum = 0;
+		benchmark::report("parallel_reduce sum (double)", threads, plain_size, benchmark::time([&]()
+		{
+			sum = gravel::parallel_reduce(pool, plain.begin(), plain.end(), 0.0);
+		}));
+		benchmark::report("parallel_transform area (dynamic_value)", threads, shape_size, benchmark::time([&]()
+		{
+			gravel::parallel_transform(pool, shapes.begin(), shapes.end(), areas.begin(), [](const ShapeValue& shape) { return shape->area(); });
+		}));
+		benchmark::report("parallel_transform_reduce area (dynamic_value)", threads, shape_size, benchmark::time([&]()
+		{
+			sum += gravel::parallel_transform_reduce(pool, shapes.begin(), shapes.end(), 0.0, std::plus<>(),
+				[](const ShapeValue& shape) { return shape->area(); });
+		}));
+
+		for (std::size_t i = 0; i < keys.size(); ++i)
+		{
+			keys[i] = static_cast<std::uint32_t>(i * 2654435761u);
+		}
+		benchmark::report("parallel_sort (uint32_t)", threads, plain_size, benchmark::time([&]()
+		{
+			gravel::parallel_sort(pool, keys.begin(), keys.end());
+		}));
+		benchmark::report("parallel_sort by area (dynamic_value)", threads, shape_size, benchmark::time([&]()
+		{
+			gravel::parallel_sort(pool, shapes.begin(), shapes.end(), [](const ShapeValue& a, const ShapeValue& b) { return a->area() < b->area(); });
+		}));
+		std::printf("  (checksum %f)\n", sum);
+	}
+}
@@ -0,0 +1,72 @@
+#include "benchmark.hpp"
+
+#include <gravel/pipeline.hpp>
+#include <gravel/unique_function.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t values = 50'000'000;
+
+	//!
+	//! The stages of a small signal processing chain
+	//!
+	auto gain = [](float sample) { return sample * 1.5f; };
+	auto offset = [](float sample) { return sample - 0.25f; };
+	auto clip = [](float sample) { return sample > 1.0f ? 1.0f : (sample < -1.0f ? -1.0f : sample); };
+	auto square = [](float sample) { return sample * sample; };
+
+	template <typename FuncT>
+	void run(const char* name, FuncT&& process)
+	{
+		float sum = 0;
+		const double seconds = benchmark::time([&]()
+		{
+			for (std::size_t i = 0; i < values; ++i)
+			{
+				sum += process(static_cast<float>(i & 1023) / 512.0f - 1.0f);
+			}
+		});
+		benchmark::report(name, 1, values, seconds);
+		if (sum == 0)
+		{
+			std::printf("unexpected sum\n");
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	{
+		std::vector<gravel::unique_function<float(float)>> stages;
+		stages.emplace_back(decltype(gain)(gain));
+		stages.emplace_back(decltype(offset)(offset));
+		stages.emplace_back(decltype(clip)(clip));
+		stages.emplace_back(decltype(square)(square));
+		run("vector<unique_function> of 4 stages", [&stages](float sample)
+		{
+			for (auto& stage : stages)
+			{
+				sample = stage(sample);
+			}
+			return sample;
+		});
+	}
+	{
+		gravel::pipeline<float> stages;
+		stages.then(gain).then(offset).then(clip).then(square);
+		run("pipeline of 4 chained stages", stages);
+	}
+	{
+		gravel::pipeline<float> stages;
+		stages.then(gain, offset, clip, square);
+		run("pipeline of 4 fused stages", stages);
+	}
+	{
+		gravel::unique_function<float(float)> fused(gravel::compose(gain, offset, clip, square));
+		run("unique_function of compose", fused);
+	}
+	run("compose", gravel::compose(gain, offset, clip, square));
+}
@@ -0,0 +1,175 @@
+#include "benchmark.hpp"
+
+#include <gravel/reactor.hpp>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace
+{
+	constexpr std::size_t events_per_run = 200'000;
+	constexpr std::size_t posts_per_thread = 250'000;
+
+	//!
+	//! The event loop reactor replaces, handlers as std::function looked up by file descriptor and posted tasks in a
+	//! locked deque with an eventfd write per post
+	//!
+	class FunctionLoop
+	{
+	public:
+		FunctionLoop()
+			: m_epoll(::epoll_create1(EPOLL_CLOEXEC))
+			, m_wake(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+		{
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.fd = m_wake;
+			::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &event);
+		}
+
+		~FunctionLoop()
+		{
+			::close(m_wake);
+			::close(m_epoll);
+		}
+
+		void add(int fd, std::uint32_t events, std::function<void(std::uint32_t)> handler)
+		{
+			epoll_event event{};
+			event.events = events;
+			event.data.fd = fd;
+			::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event);
+			m_handlers.emplace(fd, std::move(handler));
+		}
+
+		void post(std::function<void()> task)
+		{
+			{
+				std::scoped_lock lock(m_mutex);
+				m_tasks.push_back(std::move(task));
+			}
+			const std::uint64_t one = 1;
+			[[maybe_unused]] const auto written = ::write(m_wake, &one, sizeof(one));
+		}
+
+		std::size_t run_once()
+		{
+			std::array<epoll_event, 64> events;
+			const int count = ::epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), -1);
+			std::size_t ran = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				if (events[i].data.fd == m_wake)
+				{
+					std::uint64_t value;
+					[[maybe_unused]] const auto read = ::read(m_wake, &value, sizeof(value));
+					std::deque<std::function<void()>> tasks;
+					{
+						std::scoped_lock lock(m_mutex);
+						tasks.swap(m_tasks);
+					}
+					for (auto& task : tasks)
+					{
+						task();
+						ran += 1;
+					}
+					continue;
+				}
+				m_handlers.at(events[i].data.fd)(events[i].events);
+				ran += 1;
+			}
+			return ran;
+		}
+
+	private:
+		int m_epoll;
+		int m_wake;
+		std::unordered_map<int, std::function<void(std::uint32_t)>> m_handlers;
+		std::mutex m_mutex;
+		std::deque<std::function<void()>> m_tasks;
+	};
+
+	//!
+	//! Bounces a byte through a pipe events_per_run times, one readiness event and handler call per byte
+	//!
+	template <typename LoopT>
+	void run_events(const char* name)
+	{
+		LoopT loop;
+		int fds[2];
+		if (::pipe(fds) != 0)
+		{
+			return;
+		}
+		std::size_t received = 0;
+		loop.add(fds[0], EPOLLIN, [&](std::uint32_t)
+		{
+			char value;
+			[[maybe_unused]] const auto read = ::read(fds[0], &value, 1);
+			received += 1;
+			if (received < events_per_run)
+			{
+				[[maybe_unused]] const auto written = ::write(fds[1], &value, 1);
+			}
+		});
+
+		const double seconds = benchmark::time([&]()
+		{
+			const char value = 'x';
+			[[maybe_unused]] const auto written = ::write(fds[1], &value, 1);
+			while (received < events_per_run)
+			{
+				loop.run_once();
+			}
+		});
+		benchmark::report(name, 1, events_per_run, seconds);
+		::close(fds[0]);
+		::close(fds[1]);
+	}
+
+	//!
+	//! Posts posts_per_thread tasks from each of threads producers while the loop runs them
+	//!
+	template <typename LoopT>
+	void run_posts(const char* name, std::size_t threads)
+	{
+		LoopT loop;
+		std::size_t ran = 0;
+		const std::size_t total = threads * posts_per_thread;
+		const double seconds = benchmark::run_threads(threads + 1, [&](std::size_t index)
+		{
+			if (index == threads)
+			{
+				while (ran < total)
+				{
+					ran += loop.run_once();
+				}
+				return;
+			}
+			for (std::size_t i = 0; i < posts_per_thread; ++i)
+			{
+				loop.post([]() {});
+			}
+		});
+		benchmark::report(name, threads + 1, total, seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	run_events<gravel::reactor>("reactor pipe events");
+	run_events<FunctionLoop>("epoll + std::function pipe events");
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		run_posts<gravel::reactor>("reactor post", threads);
+		run_posts<FunctionLoop>("mutex + eventfd per post", threads);
+	}
+}
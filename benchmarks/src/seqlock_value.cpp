@@ -0,0 +1,109 @@
+#include "benchmark.hpp"
+
+#include <gravel/atomic_dynamic_value.hpp>
+#include <gravel/seqlock_value.hpp>
+
+#include <mutex>
+
+namespace
+{
+	class Limit
+	{
+	public:
+		Limit(int limit)
+			: m_limit(limit)
+		{
+		}
+
+		virtual int clamp(int value) const
+		{
+			return value < m_limit ? value : m_limit;
+		}
+
+		int m_limit;
+	};
+
+	class OffsetLimit : public Limit
+	{
+	public:
+		OffsetLimit(int limit)
+			: Limit(limit)
+		{
+		}
+
+		int clamp(int value) const override
+		{
+			return Limit::clamp(value) + 1;
+		}
+	};
+
+	constexpr std::size_t reads_per_thread = 2'000'000;
+	constexpr std::size_t writes = 20'000;
+
+	//!
+	//! One writer replaces the value writes times while the reader threads read it reads_per_thread times each
+	//!
+	template <typename ReadT, typename WriteT>
+	void run(const char* name, std::size_t reader_count, ReadT&& read, WriteT&& write)
+	{
+		std::atomic<bool> readers_done = false;
+		std::atomic<std::size_t> sink = 0;
+		const double seconds = benchmark::run_threads(reader_count + 1, [&](std::size_t index)
+		{
+			if (index == reader_count)
+			{
+				for (std::size_t i = 0; i < writes && !readers_done.load(std::memory_order_relaxed); ++i)
+				{
+					write(static_cast<int>(i));
+				}
+				return;
+			}
+			std::size_t sum = 0;
+			for (std::size_t i = 0; i < reads_per_thread; ++i)
+			{
+				sum += read(static_cast<int>(i));
+			}
+			sink += sum;
+			readers_done = true;
+		});
+		benchmark::report(name, reader_count, reads_per_thread * reader_count, seconds);
+	}
+}
+
+template <>
+struct gravel::is_bitwise_copyable<Limit>
+{
+	static const bool value = true;
+};
+
+template <>
+struct gravel::is_bitwise_copyable<OffsetLimit>
+{
+	static const bool value = true;
+};
+
+int main(int argc, char** argv)
+{
+	for (std::size_t readers : benchmark::thread_counts())
+	{
+		gravel::seqlock_value<Limit> value(Limit(100));
+		run("seqlock_value read", readers,
+			[&](int i) { return value.load()->clamp(i); },
+			[&](int i) { if (i % 2) { value.emplace<OffsetLimit>(i); } else { value.emplace<Limit>(i); } });
+	}
+	for (std::size_t readers : benchmark::thread_counts())
+	{
+		gravel::atomic_dynamic_value<Limit> value(Limit(100));
+		run("atomic_dynamic_value read", readers,
+			[&](int i) { return value.load()->clamp(i); },
+			[&](int i) { if (i % 2) { value.emplace<OffsetLimit>(i); } else { value.emplace<Limit>(i); } });
+	}
+	for (std::size_t readers : benchmark::thread_counts())
+	{
+		std::mutex mutex;
+		gravel::dynamic_value<Limit> value(Limit(100));
+		run("mutex + dynamic_value read", readers,
+			[&](int i) { std::lock_guard lock(mutex); return value->clamp(i); },
+			[&](int i) { std::lock_guard lock(mutex); if (i % 2) { value.emplace<OffsetLimit>(i); } else { value.emplace<Limit>(i); } });
+	}
+}
@@ -0,0 +1,125 @@
+#include "benchmark.hpp"
+
+#include <gravel/signal.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t slot_calls = 50'000'000;
+
+	//!
+	//! A slot with some state of its own, as handlers of an event bus usually have, too large for the inline buffer
+	//! of std::function
+	//!
+	struct Accumulate
+	{
+		void operator()(std::uint64_t value)
+		{
+			calls += 1;
+			*total += value * factor + label[calls & 7];
+		}
+
+		std::uint64_t* total;
+		std::uint64_t factor;
+		std::uint64_t calls = 0;
+		char label[8] = "handler";
+	};
+
+	//!
+	//! Emits to slot_count slots until slot_calls slots have been called
+	//!
+	template <typename ConnectT, typename EmitT>
+	void run(const char* name, std::size_t slot_count, ConnectT&& connect, EmitT&& emit)
+	{
+		std::uint64_t total = 0;
+		std::vector<std::unique_ptr<std::uint64_t[]>> noise;
+		for (std::size_t i = 0; i < slot_count; ++i)
+		{
+			connect(Accumulate{ &total, i + 1 });
+			// Other allocations between connections, as when handlers are registered over time
+			noise.push_back(std::make_unique<std::uint64_t[]>(8));
+		}
+		const std::size_t emits = slot_calls / slot_count;
+		const double seconds = benchmark::time([&]()
+		{
+			for (std::size_t i = 0; i < emits; ++i)
+			{
+				emit(i);
+			}
+		});
+		benchmark::report(name, 1, emits * slot_count, seconds);
+		if (total == 0)
+		{
+			std::printf("unexpected total\n");
+		}
+	}
+
+	//!
+	//! An event bus with many topics of a few slots each, emitted round robin so that slots are rarely in cache
+	//!
+	template <typename TopicT, typename ConnectT, typename EmitT>
+	void run_topics(const char* name, ConnectT&& connect, EmitT&& emit)
+	{
+		constexpr std::size_t topic_count = 100'000;
+		constexpr std::size_t slots_per_topic = 4;
+		std::uint64_t total = 0;
+		std::vector<std::unique_ptr<std::uint64_t[]>> noise;
+		std::vector<TopicT> topics(topic_count);
+		for (std::size_t slot = 0; slot < slots_per_topic; ++slot)
+		{
+			for (TopicT& topic : topics)
+			{
+				connect(topic, Accumulate{ &total, slot + 1 });
+				noise.push_back(std::make_unique<std::uint64_t[]>(8));
+			}
+		}
+		const std::size_t emits = slot_calls / slots_per_topic / 4;
+		const double seconds = benchmark::time([&]()
+		{
+			for (std::size_t i = 0; i < emits; ++i)
+			{
+				// Stride through the topics, as unrelated events would
+				emit(topics[i * 7919 % topic_count], i);
+			}
+		});
+		benchmark::report(name, 1, emits * slots_per_topic, seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	for (std::size_t slot_count : { 1, 10, 100, 1000 })
+	{
+		std::printf("%zu slots\n", slot_count);
+		{
+			gravel::signal<void(std::uint64_t)> changed;
+			run("signal emit", slot_count, [&](Accumulate slot) { changed.connect(slot); }, [&](std::uint64_t value) { changed.emit(value); });
+		}
+		{
+			std::vector<std::function<void(std::uint64_t)>> slots;
+			run("vector<std::function> emit", slot_count, [&](Accumulate slot) { slots.push_back(slot); }, [&](std::uint64_t value)
+			{
+				for (auto& slot : slots)
+				{
+					slot(value);
+				}
+			});
+		}
+	}
+	std::printf("100k topics of 4 slots\n");
+	using Signal = gravel::signal<void(std::uint64_t)>;
+	using Slots = std::vector<std::function<void(std::uint64_t)>>;
+	run_topics<Signal>("signal emit", [](Signal& topic, Accumulate slot) { topic.connect(slot); },
+		[](Signal& topic, std::uint64_t value) { topic.emit(value); });
+	run_topics<Slots>("vector<std::function> emit", [](Slots& topic, Accumulate slot) { topic.push_back(slot); }, [](Slots& topic, std::uint64_t value)
+	{
+		for (auto& slot : topic)
+		{
+			slot(value);
+		}
+	});
+}
@@ -0,0 +1,111 @@
+#include "benchmark.hpp"
+
+#include <gravel/dynamic_value.hpp>
+#include <gravel/spsc_ring.hpp>
+
+#include <array>
+#include <cstdint>
+
+namespace
+{
+	constexpr std::size_t total_messages = 4'000'000;
+	constexpr std::size_t batch_size = 32;
+
+	class Message
+	{
+	public:
+		explicit Message(std::size_t value)
+			: m_value(value)
+		{
+		}
+
+		virtual ~Message() = default;
+
+		virtual std::size_t value() const
+		{
+			return m_value;
+		}
+
+	private:
+		std::size_t m_value;
+	};
+
+	//!
+	//! Too large for the small buffer, so it is relocated by copying the dynamic_value's words
+	//!
+	class LargeMessage : public Message
+	{
+	public:
+		using Message::Message;
+
+		std::array<std::uint8_t, 64> m_payload = {};
+	};
+
+	template <typename MessageT>
+	void run(const char* single_name, const char* bulk_name)
+	{
+		using Value = gravel::dynamic_value<Message, gravel::Properties<gravel::Attr::Movable>>;
+
+		{
+			gravel::spsc_ring<Value> ring(1024);
+			std::size_t sum = 0;
+			const double seconds = benchmark::run_threads(2, [&](std::size_t index)
+			{
+				if (index == 0)
+				{
+					for (std::size_t i = 0; i < total_messages;)
+					{
+						i += ring.try_emplace(Value::make_emplaced<MessageT>(i)) ? 1 : 0;
+					}
+					return;
+				}
+				for (std::size_t consumed = 0; consumed < total_messages;)
+				{
+					consumed += ring.consume([&sum](Value&& message) { sum += message->value(); }, batch_size);
+				}
+			});
+			benchmark::report(single_name, 2, total_messages, seconds);
+		}
+		{
+			gravel::spsc_ring<Value> ring(1024);
+			std::size_t sum = 0;
+			const double seconds = benchmark::run_threads(2, [&](std::size_t index)
+			{
+				alignas(Value) std::array<std::uint8_t, sizeof(Value) * batch_size> storage;
+				Value* batch = reinterpret_cast<Value*>(storage.data());
+				if (index == 0)
+				{
+					for (std::size_t i = 0; i < total_messages; i += batch_size)
+					{
+						for (std::size_t j = 0; j < batch_size; ++j)
+						{
+							new (batch + j) Value(Value::make_emplaced<MessageT>(i + j));
+						}
+						for (std::size_t pushed = 0; pushed < batch_size;)
+						{
+							pushed += ring.push_n(batch + pushed, batch_size - pushed);
+						}
+					}
+					return;
+				}
+				for (std::size_t consumed = 0; consumed < total_messages;)
+				{
+					const std::size_t popped = ring.pop_n(batch, batch_size);
+					for (std::size_t j = 0; j < popped; ++j)
+					{
+						sum += batch[j]->value();
+						batch[j].~Value();
+					}
+					consumed += popped;
+				}
+			});
+			benchmark::report(bulk_name, 2, total_messages, seconds);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	run<Message>("spsc_ring try_emplace/consume (inline)", "spsc_ring push_n/pop_n (inline)");
+	run<LargeMessage>("spsc_ring try_emplace/consume (heap)", "spsc_ring push_n/pop_n (heap)");
+}
@@ -0,0 +1,84 @@
+#include "benchmark.hpp"
+
+#include <gravel/task_graph.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t node_count = 10'000;
+	constexpr std::size_t runs = 50;
+
+	//!
+	//! A little work per node, so that the benchmark measures scheduling rather than the work itself
+	//!
+	void spin(std::atomic<std::uint64_t>& sink, std::uint64_t seed)
+	{
+		std::uint64_t value = seed;
+		for (int i = 0; i < 64; ++i)
+		{
+			value = value * 6364136223846793005u + 1442695040888963407u;
+		}
+		sink.fetch_add(value & 1, std::memory_order_relaxed);
+	}
+
+	void report(const char* name, std::size_t threads, gravel::task_graph& graph, gravel::thread_pool& pool)
+	{
+		graph.run(pool);
+		const double seconds = benchmark::time([&]()
+		{
+			for (std::size_t run = 0; run < runs; ++run)
+			{
+				graph.run(pool);
+			}
+		});
+		benchmark::report(name, threads, runs * graph.size(), seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::atomic<std::uint64_t> sink = 0;
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		gravel::thread_pool pool(threads);
+
+		// One source fanning out to every node, which all join in one sink
+		gravel::task_graph wide;
+		auto source = wide.emplace([]() {});
+		auto sink_node = wide.emplace([]() {});
+		for (std::size_t i = 0; i < node_count; ++i)
+		{
+			wide.emplace([&sink, i]() { spin(sink, i); }).succeed(source).precede(sink_node);
+		}
+		report("task_graph wide", threads, wide, pool);
+
+		// A single chain, every node depends on the one before it
+		gravel::task_graph deep;
+		auto previous = deep.emplace([]() {});
+		for (std::size_t i = 0; i < node_count; ++i)
+		{
+			auto next = deep.emplace([&sink, i]() { spin(sink, i); });
+			previous.precede(next);
+			previous = next;
+		}
+		report("task_graph deep", threads, deep, pool);
+
+		// Layers of 64 nodes, each depending on two nodes of the layer before
+		gravel::task_graph layered;
+		std::vector<gravel::task_graph::node> layer;
+		for (std::size_t i = 0; i < node_count; ++i)
+		{
+			auto created = layered.emplace([&sink, i]() { spin(sink, i); });
+			if (i >= 64)
+			{
+				created.succeed(layer[i - 64]).succeed(layer[i - 64 + (i * 7) % 64]);
+			}
+			layer.push_back(created);
+		}
+		report("task_graph layered", threads, layered, pool);
+	}
+	std::printf("  (checksum %llu)\n", static_cast<unsigned long long>(sink.load()));
+}
@@ -0,0 +1,142 @@
+#include "benchmark.hpp"
+
+#include <gravel/thread_pool.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+	constexpr int fibonacci_n = 30;
+	constexpr int fibonacci_cutoff = 12;
+	constexpr std::size_t reduce_size = 1 << 24;
+	constexpr std::size_t reduce_grain = 1 << 14;
+
+	long long serial_fibonacci(int n)
+	{
+		return n < 2 ? n : serial_fibonacci(n - 1) + serial_fibonacci(n - 2);
+	}
+
+	//!
+	//! Forks the first half of the work as a task, runs the second half itself and joins by helping the pool.
+	//! The task only captures a pointer, so it fits the small buffer of unique_function.
+	//!
+	template <typename FuncT>
+	void fork_join(gravel::thread_pool& pool, FuncT& forked, FuncT& inline_part)
+	{
+		struct Fork
+		{
+			FuncT* function;
+			std::atomic<bool> done = false;
+		} fork{ &forked };
+
+		pool.submit([&fork]()
+		{
+			(*fork.function)();
+			fork.done.store(true, std::memory_order_release);
+		});
+		inline_part();
+		pool.run_until([&fork]() { return fork.done.load(std::memory_order_acquire); });
+	}
+
+	struct Fibonacci
+	{
+		gravel::thread_pool* pool;
+		int n;
+		long long result = 0;
+
+		void operator()()
+		{
+			if (n < fibonacci_cutoff)
+			{
+				result = serial_fibonacci(n);
+				return;
+			}
+			Fibonacci first{ pool, n - 1 };
+			Fibonacci second{ pool, n - 2 };
+			fork_join(*pool, first, second);
+			result = first.result + second.result;
+		}
+	};
+
+	struct Reduce
+	{
+		gravel::thread_pool* pool;
+		const std::uint32_t* begin;
+		const std::uint32_t* end;
+		std::uint64_t result = 0;
+
+		void operator()()
+		{
+			const std::size_t size = static_cast<std::size_t>(end - begin);
+			if (size <= reduce_grain)
+			{
+				for (const std::uint32_t* it = begin; it != end; ++it)
+				{
+					result += *it;
+				}
+				return;
+			}
+			Reduce left{ pool, begin, begin + size / 2 };
+			Reduce right{ pool, begin + size / 2, end };
+			fork_join(*pool, left, right);
+			result = left.result + right.result;
+		}
+	};
+
+	//!
+	//! Runs root on the pool and waits for it from the calling thread
+	//!
+	template <typename FuncT>
+	void run_on(gravel::thread_pool& pool, FuncT& root)
+	{
+		std::atomic<bool> done = false;
+		pool.submit([&root, &done]()
+		{
+			root();
+			done.store(true, std::memory_order_release);
+		});
+		while (!done.load(std::memory_order_acquire))
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::uint32_t> values(reduce_size);
+	for (std::size_t i = 0; i < values.size(); ++i)
+	{
+		values[i] = static_cast<std::uint32_t>(i * 2654435761u);
+	}
+
+	long long expected_fibonacci = 0;
+	benchmark::report("serial fibonacci", 1, 1, benchmark::time([&]() { expected_fibonacci = serial_fibonacci(fibonacci_n); }));
+	std::uint64_t expected_sum = 0;
+	benchmark::report("serial reduce", 1, values.size(), benchmark::time([&]()
+	{
+		for (std::uint32_t value : values)
+		{
+			expected_sum += value;
+		}
+	}));
+
+	for (std::size_t threads : benchmark::thread_counts())
+	{
+		gravel::thread_pool pool(threads);
+
+		Fibonacci fibonacci{ &pool, fibonacci_n };
+		benchmark::report("thread_pool fork-join fibonacci", threads, 1, benchmark::time([&]() { run_on(pool, fibonacci); }));
+
+		Reduce reduce{ &pool, values.data(), values.data() + values.size() };
+		benchmark::report("thread_pool fork-join reduce", threads, values.size(), benchmark::time([&]() { run_on(pool, reduce); }));
+
+		if (fibonacci.result != expected_fibonacci || reduce.result != expected_sum)
+		{
+			std::printf("Wrong result\n");
+			return 1;
+		}
+	}
+}
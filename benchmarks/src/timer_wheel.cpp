@@ -0,0 +1,102 @@
+#include "benchmark.hpp"
+
+#include <gravel/timer_wheel.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+	constexpr std::size_t timer_count = 1'000'000;
+	//! Delays up to about 17 minutes of millisecond ticks, like connection timeouts
+	constexpr std::uint64_t max_delay = 1'000'000;
+
+	//!
+	//! What timer_wheel is meant to replace, O(log n) and an allocation per timer
+	//!
+	class MultimapTimers
+	{
+	public:
+		using Handle = std::multimap<std::uint64_t, std::function<void()>>::iterator;
+
+		Handle schedule(std::uint64_t delay, std::function<void()>&& callback)
+		{
+			return m_timers.emplace(m_now + delay, std::move(callback));
+		}
+
+		void cancel(Handle timer)
+		{
+			m_timers.erase(timer);
+		}
+
+		std::size_t advance_to(std::uint64_t target)
+		{
+			std::size_t ran = 0;
+			while (!m_timers.empty() && m_timers.begin()->first <= target)
+			{
+				auto node = m_timers.extract(m_timers.begin());
+				m_now = node.key();
+				node.mapped()();
+				ran += 1;
+			}
+			m_now = target;
+			return ran;
+		}
+
+	private:
+		std::multimap<std::uint64_t, std::function<void()>> m_timers;
+		std::uint64_t m_now = 0;
+	};
+
+	//!
+	//! Schedules timer_count timers, cancels and reschedules every other one as a connection seeing traffic would,
+	//! then runs them all
+	//!
+	template <typename TimersT>
+	void run(const char* name, TimersT& timers)
+	{
+		std::mt19937_64 random(7);
+		std::vector<std::uint64_t> delays(timer_count);
+		for (std::uint64_t& delay : delays)
+		{
+			delay = 1 + random() % max_delay;
+		}
+
+		std::size_t sum = 0;
+		std::size_t ran = 0;
+		const double seconds = benchmark::time([&]()
+		{
+			using Handle = decltype(timers.schedule(0, [&sum]() { sum += 1; }));
+			std::vector<Handle> handles;
+			handles.reserve(timer_count);
+			for (std::size_t i = 0; i < timer_count; ++i)
+			{
+				handles.push_back(timers.schedule(delays[i], [&sum, i]() { sum += i; }));
+			}
+			for (std::size_t i = 0; i < timer_count; i += 2)
+			{
+				timers.cancel(handles[i]);
+				handles[i] = timers.schedule(delays[i] / 2 + 1, [&sum, i]() { sum += i; });
+			}
+			ran = timers.advance_to(max_delay + 1);
+		});
+		// Schedule, cancel, reschedule and expiry per timer
+		benchmark::report(name, 1, timer_count + timer_count / 2 * 2 + ran, seconds);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	{
+		gravel::timer_wheel wheel;
+		wheel.reserve(timer_count);
+		run("timer_wheel", wheel);
+	}
+	{
+		MultimapTimers timers;
+		run("multimap<tick, std::function>", timers);
+	}
+}
@@ -1,13 +1,13 @@
+#include "gravel/future.hpp"
 #include "gravel/unique_function.hpp"
 
-#include <future>
 #include <iostream>
 
 namespace {
 	class FunctionObjectWithPromise
 	{
 	public:
-		std::future<int> get_future()
+		gravel::future<int> get_future()
 		{
 			return m_promise.get_future();
 		}
@@ -18,7 +18,7 @@ namespace {
 		}
 
 	private:
-		std::promise<int> m_promise;
+		gravel::promise<int> m_promise;
 	};
 }
 
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "gravel/executor.hpp"
+#include "gravel/future.hpp"
+#include "gravel/mpsc_queue.hpp"
+#include "gravel/thread_pool.hpp"
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Owns a state that is only ever touched by the messages sent to it, one at a time, so the state needs no
+	//! locking even though messages are sent from any thread and run on any thread of the executor.
+	//!
+	//! Messages are unique_function<void(StateT&)> queued in a lock-free mpsc_queue mailbox, whose nodes hold them
+	//! inline. An actor is scheduled by submitting a single drain task to the executor when its mailbox goes from
+	//! empty to non-empty, which runs up to batch_size messages and then either goes idle or resubmits itself, so
+	//! that many actors share a pool fairly while each keeps its state in cache for a batch. On a thread_pool,
+	//! actors woken by messages sent from a worker run on that worker's own deque unless stolen.
+	//!
+	//! NOTE: The executor must keep running tasks until the actor has been destroyed. Messages must not throw.
+	//!
+	//! @tparam StateT	the state owned by the actor
+	//! @tparam ExecutorT	the executor to run the messages on
+	//!
+	template <typename StateT, Executor ExecutorT = thread_pool>
+	class actor
+	{
+	public:
+		using Message = unique_function<void(StateT&)>;
+
+		//!
+		//! Constructor
+		//! @param executor	the executor to run the messages on
+		//! @param state	the initial state
+		//! @param batch_size	the largest number of messages to run before giving the executor back
+		//!
+		explicit actor(ExecutorT& executor, StateT state = StateT(), std::size_t batch_size = 64)
+			: m_executor(&executor)
+			, m_batch_size(batch_size)
+			, m_state(std::move(state))
+		{
+		}
+
+		actor(const actor&) = delete;
+		actor& operator=(const actor&) = delete;
+
+		//!
+		//! Destructor, waits until all sent messages have run and the actor has let go of the executor
+		//!
+		~actor()
+		{
+			while (m_pending.load(std::memory_order_acquire) != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		//!
+		//! Queues a message, it runs after all messages sent before it have finished, may be called from any thread
+		//! @param message	called with the state of the actor
+		//!
+		void send(Message&& message)
+		{
+			// Count before pushing, so that a drain never consumes more messages than it knows of
+			const bool idle = m_pending.fetch_add(1, std::memory_order_acq_rel) == 0;
+			m_mailbox.push(std::move(message));
+			if (idle)
+			{
+				schedule_drain();
+			}
+		}
+
+		//!
+		//! Queues a function object as a message
+		//! @tparam FuncT	the type of the function object, callable as void(StateT&)
+		//!
+		template <typename FuncT>
+		void send(FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, Message>)
+		{
+			send(Message(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Queues a message whose result is wanted
+		//! @tparam FuncT	the type of the function object, callable as R(StateT&)
+		//! @param function	called with the state of the actor
+		//! @return a future for the result of function, or the exception it threw
+		//!
+		template <typename FuncT>
+		future<std::invoke_result_t<FuncT&, StateT&>> ask(FuncT&& function)
+		{
+			using ResultT = std::invoke_result_t<FuncT&, StateT&>;
+			promise<ResultT> result;
+			future<ResultT> answer = result.get_future();
+			send([function = std::forward<FuncT>(function), result = std::move(result)](StateT& state) mutable
+			{
+				try
+				{
+					if constexpr (std::is_void_v<ResultT>)
+					{
+						function(state);
+						result.set_value();
+					}
+					else
+					{
+						result.set_value(function(state));
+					}
+				}
+				catch (...)
+				{
+					result.set_exception(std::current_exception());
+				}
+			});
+			return answer;
+		}
+
+	private:
+		void schedule_drain()
+		{
+			m_executor->submit(unique_function<void()>([this]() { drain(); }));
+		}
+
+		void drain()
+		{
+			const std::size_t ran = m_mailbox.consume([this](Message&& message) { message(m_state); }, m_batch_size);
+
+			// A pushed message may not be visible yet even though it was counted, then it is picked up by the next drain
+			if (m_pending.fetch_sub(ran, std::memory_order_acq_rel) != ran)
+			{
+				schedule_drain();
+			}
+		}
+
+		ExecutorT* m_executor;
+		std::size_t m_batch_size;
+		StateT m_state;
+		mpsc_queue<Message> m_mailbox;
+		alignas(64) std::atomic<std::size_t> m_pending{ 0 };
+	};
+}
@@ -0,0 +1,415 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "gravel/detail/thread_records.hpp"
+#include "gravel/dynamic_value.hpp"
+#include "gravel/spsc_ring.hpp"
+
+namespace gravel
+{
+	enum class log_level : std::uint8_t
+	{
+		debug,
+		info,
+		warning,
+		error
+	};
+
+	namespace detail
+	{
+		//! Room for the captures of a format closure, enough for a handful of arguments and a string_view or two
+		constexpr std::size_t log_record_size = 120;
+
+		class LogRecordBase
+		{
+		public:
+			LogRecordBase() = default;
+			LogRecordBase(const LogRecordBase&) = delete;
+			virtual ~LogRecordBase() = default;
+			virtual void format(std::string& out) = 0;
+		};
+
+		template <typename FuncT>
+		class LogRecordImpl final : public LogRecordBase
+		{
+		public:
+			explicit LogRecordImpl(FuncT&& function)
+				: m_function(std::move(function))
+			{
+			}
+
+			explicit LogRecordImpl(const FuncT& function)
+				: m_function(function)
+			{
+			}
+
+			LogRecordImpl(LogRecordImpl&& other)
+				: m_function(std::move(other.m_function))
+			{
+			}
+
+			void format(std::string& out) override
+			{
+				m_function(out);
+			}
+
+		private:
+			FuncT m_function;
+		};
+
+		using LogRecord = dynamic_value<LogRecordBase, Properties<Attr::Movable, log_record_size>>;
+
+		struct LogEntry
+		{
+			template <typename FuncT>
+			LogEntry(log_level entry_level, FuncT&& function)
+				: level(entry_level)
+				, record(LogRecord::make_emplaced<LogRecordImpl<std::decay_t<FuncT>>>(std::forward<FuncT>(function)))
+			{
+			}
+
+			log_level level;
+			LogRecord record;
+		};
+
+		//!
+		//! The ring of one producing thread, adopted by another thread once it exits
+		//!
+		struct LogProducer
+		{
+			explicit LogProducer(std::size_t capacity)
+				: ring(capacity)
+			{
+			}
+
+			std::atomic<bool> in_use{ true };
+			LogProducer* next = nullptr;
+			spsc_ring<LogEntry> ring;
+		};
+
+		//!
+		//! Registers the process for expedited membarrier calls, once
+		//! @return whether the writer can issue the heavy side of an asymmetric fence, which lets producers get away
+		//!			with a compiler fence
+		//!
+		inline bool membarrier_registered()
+		{
+			static const bool registered = ::syscall(SYS_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) == 0;
+			return registered;
+		}
+
+		//!
+		//! What the producing threads share with the writer thread, lives until the logger and its writer are gone
+		//!
+		class LoggerState
+		{
+		public:
+			LoggerState(int fd, std::size_t capacity)
+				: fd(fd)
+				, capacity(capacity)
+				, asymmetric(membarrier_registered())
+			{
+			}
+
+			LogProducer& acquire_record()
+			{
+				return producers.acquire([this]() { return new LogProducer(capacity); });
+			}
+
+			void release_record(LogProducer& producer)
+			{
+				RecordList<LogProducer>::release(producer);
+			}
+
+			//!
+			//! Wakes the writer if it is asleep, pairs with the fence in async_logger::park: either the writer sees
+			//! the record queued before this, or this sees it asleep
+			//!
+			void wake()
+			{
+				if (asymmetric)
+				{
+					// The membarrier in park puts a full fence here whenever it matters
+					std::atomic_signal_fence(std::memory_order_seq_cst);
+				}
+				else
+				{
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				}
+				// Only the first record after the writer fell asleep pays for the system call
+				if (sleeping.load(std::memory_order_relaxed) && sleeping.exchange(false, std::memory_order_seq_cst))
+				{
+					signal.fetch_add(1, std::memory_order_seq_cst);
+					signal.notify_one();
+				}
+			}
+
+			//!
+			//! The writer side of wake, orders the announcement that it is about to sleep before its last look for records
+			//!
+			void fence_before_sleeping() const
+			{
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (asymmetric)
+				{
+					// Runs a full fence on every running thread of the process, and thereby on every producer
+					::syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0, 0);
+				}
+			}
+
+			const int fd;
+			const std::size_t capacity;
+			//! Whether producers pair with the writer through membarrier instead of a fence of their own
+			const bool asymmetric;
+			RecordList<LogProducer> producers;
+			alignas(64) std::atomic<bool> sleeping{ false };
+			std::atomic<std::uint32_t> signal{ 0 };
+			std::atomic<std::uint64_t> flush_requests{ 0 };
+			std::atomic<std::uint64_t> flushed{ 0 };
+			std::atomic<std::size_t> dropped{ 0 };
+			std::atomic<bool> stopping{ false };
+		};
+	}
+
+	//!
+	//! Logger that defers formatting and writing to a background thread.
+	//!
+	//! The logging thread only constructs a closure, which captures the arguments by value and appends the message to
+	//! an std::string once called, inline in a ring of its own: every thread gets an spsc_ring per logger on its first
+	//! log call, so logging takes no lock and does not allocate. The writer thread drains the rings, formats each
+	//! record into a reused line buffer and writes a batch of lines with a single writev.
+	//!
+	//! Records of one thread are written in order, records of different threads in no particular order.
+	//!
+	//! NOTE: Captures must fit detail::log_record_size bytes and must stay valid until the record is written, so
+	//! capture pointers and string_views only to data that outlives the logger, such as string literals. A thread
+	//! whose ring is full drops the record instead of waiting.
+	//!
+	class async_logger
+	{
+		using State = detail::LoggerState;
+
+	public:
+		//!
+		//! Constructor, starts the writer thread
+		//! @param fd	the file descriptor to write to, stays owned by the caller
+		//! @param ring_capacity	the number of records each logging thread can have queued
+		//!
+		explicit async_logger(int fd = STDERR_FILENO, std::size_t ring_capacity = 1024)
+			: m_state(std::make_shared<State>(fd, ring_capacity))
+		{
+			m_writer = std::thread([state = m_state]() { write(*state); });
+		}
+
+		async_logger(const async_logger&) = delete;
+		async_logger& operator=(const async_logger&) = delete;
+
+		//!
+		//! Destructor, writes all queued records and stops the writer thread
+		//!
+		~async_logger()
+		{
+			m_state->stopping.store(true, std::memory_order_seq_cst);
+			m_state->signal.fetch_add(1, std::memory_order_seq_cst);
+			m_state->signal.notify_one();
+			m_writer.join();
+		}
+
+		//!
+		//! Queues a record
+		//! @param level	the level, written in front of the message
+		//! @param format	callable as void(std::string&), appends the message without a trailing newline
+		//! @return false if the ring of this thread was full and the record was dropped
+		//!
+		template <typename FuncT>
+		bool log(log_level level, FuncT&& format)
+		{
+			static_assert(sizeof(detail::LogRecordImpl<std::decay_t<FuncT>>) <= detail::log_record_size,
+				"the captures of a log record must fit detail::log_record_size");
+			detail::LogProducer& producer = Records::record_for(m_state);
+			if (!producer.ring.try_emplace(level, std::forward<FuncT>(format)))
+			{
+				m_state->dropped.fetch_add(1, std::memory_order_relaxed);
+				return false;
+			}
+			m_state->wake();
+			return true;
+		}
+
+		//!
+		//! Blocks until every record queued before the call, by any thread, has been written
+		//!
+		void flush()
+		{
+			const std::uint64_t target = m_state->flush_requests.fetch_add(1, std::memory_order_seq_cst) + 1;
+			m_state->signal.fetch_add(1, std::memory_order_seq_cst);
+			m_state->signal.notify_one();
+			std::uint64_t flushed = m_state->flushed.load(std::memory_order_acquire);
+			while (flushed < target)
+			{
+				m_state->flushed.wait(flushed, std::memory_order_acquire);
+				flushed = m_state->flushed.load(std::memory_order_acquire);
+			}
+		}
+
+		//!
+		//! The number of records dropped because a ring was full
+		//!
+		std::size_t dropped() const
+		{
+			return m_state->dropped.load(std::memory_order_relaxed);
+		}
+
+	private:
+		using Records = detail::ThreadRecordCache<State, detail::LogProducer>;
+		//! The most lines written with one writev
+		static constexpr std::size_t batch_size = 64;
+
+		static std::string_view level_name(log_level level)
+		{
+			switch (level)
+			{
+			case log_level::debug:
+				return "DEBUG ";
+			case log_level::info:
+				return "INFO ";
+			case log_level::warning:
+				return "WARNING ";
+			default:
+				return "ERROR ";
+			}
+		}
+
+		//!
+		//! The writer thread
+		//!
+		static void write(State& state)
+		{
+			std::array<std::string, batch_size> lines;
+			std::size_t count = 0;
+			auto append = [&](detail::LogEntry&& entry)
+			{
+				std::string& line = lines[count++];
+				line.assign(level_name(entry.level));
+				entry.record->format(line);
+				line.push_back('\n');
+				if (count == batch_size)
+				{
+					write_lines(state.fd, lines.data(), count);
+					count = 0;
+				}
+			};
+
+			while (true)
+			{
+				// A pass drains every record queued before these were read
+				const bool stopping = state.stopping.load(std::memory_order_acquire);
+				const std::uint64_t requested = state.flush_requests.load(std::memory_order_acquire);
+				std::size_t consumed = 0;
+				for (detail::LogProducer* producer = state.producers.head(); producer; producer = producer->next)
+				{
+					consumed += producer->ring.consume(append);
+				}
+				write_lines(state.fd, lines.data(), count);
+				count = 0;
+
+				if (state.flushed.load(std::memory_order_relaxed) != requested)
+				{
+					state.flushed.store(requested, std::memory_order_release);
+					state.flushed.notify_all();
+				}
+				if (consumed > 0)
+				{
+					continue;
+				}
+				if (stopping)
+				{
+					return;
+				}
+				park(state);
+			}
+		}
+
+		static void park(State& state)
+		{
+			// Announce that we are about to sleep before the last look for records, pairs with LoggerState::wake
+			state.sleeping.store(true, std::memory_order_seq_cst);
+			state.fence_before_sleeping();
+			const std::uint32_t signal = state.signal.load(std::memory_order_seq_cst);
+			bool idle = state.flushed.load(std::memory_order_relaxed) == state.flush_requests.load(std::memory_order_seq_cst)
+				&& !state.stopping.load(std::memory_order_seq_cst);
+			for (detail::LogProducer* producer = state.producers.head(); producer && idle; producer = producer->next)
+			{
+				idle = producer->ring.empty();
+			}
+			if (idle)
+			{
+				state.signal.wait(signal, std::memory_order_seq_cst);
+			}
+			state.sleeping.store(false, std::memory_order_relaxed);
+		}
+
+		//!
+		//! Writes lines with as few writev calls as the file descriptor allows, dropping them on errors
+		//!
+		static void write_lines(int fd, const std::string* lines, std::size_t count)
+		{
+			std::array<iovec, batch_size> vectors;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				vectors[i].iov_base = const_cast<char*>(lines[i].data());
+				vectors[i].iov_len = lines[i].size();
+			}
+			iovec* next = vectors.data();
+			std::size_t remaining = count;
+			while (remaining > 0)
+			{
+				ssize_t written = ::writev(fd, next, static_cast<int>(remaining));
+				if (written < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					return;
+				}
+				// Skip what was written, which may end in the middle of a line
+				while (remaining > 0 && static_cast<std::size_t>(written) >= next->iov_len)
+				{
+					written -= static_cast<ssize_t>(next->iov_len);
+					++next;
+					--remaining;
+				}
+				if (remaining > 0)
+				{
+					next->iov_base = static_cast<char*>(next->iov_base) + written;
+					next->iov_len -= static_cast<std::size_t>(written);
+				}
+			}
+		}
+
+		std::shared_ptr<State> m_state;
+		std::thread m_writer;
+	};
+}
+
+#endif
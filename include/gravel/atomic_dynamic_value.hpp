@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+#include "gravel/dynamic_value.hpp"
+#include "gravel/ebr.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Holds a dynamic_value that can be replaced by writers while any number of threads read it concurrently, such as
+	//! a polymorphic policy or configuration that is hot-swapped at runtime.
+	//!
+	//! Readers take a snapshot, which is wait-free and pins the held value so that it stays alive for as long as the
+	//! snapshot does. Writers publish a new value with a single atomic exchange, the replaced value is retired to an
+	//! epoch based reclamation domain and destroyed once no snapshot can still refer to it.
+	//!
+	//! NOTE: atomic_dynamic_value has the following properties:
+	//!
+	//! * It always holds a valid value, just like a dynamic_value.
+	//! * Snapshots only give const access to the value, writers must publish a new value to change it.
+	//! * Snapshots must be released on the thread that took them, and before the domain is destroyed.
+	//! * Every store allocates one node holding the new dynamic_value, reads never allocate.
+	//!
+	//! @tparam BaseT	the Base type that the held dynamic_value shall hold
+	//! @tparam PropertiesT	the properties of the held dynamic_value, see dynamic_value
+	//!
+	template <typename BaseT, typename PropertiesT = Properties<> >
+	class atomic_dynamic_value
+	{
+		struct Node;
+
+	public:
+		using value_type = dynamic_value<BaseT, PropertiesT>;
+
+		//!
+		//! A pinned view of the value held by an atomic_dynamic_value at the time it was taken
+		//!
+		class snapshot
+		{
+		public:
+			const BaseT* operator->() const
+			{
+				return &m_node->value.get();
+			}
+
+			const BaseT& operator*() const
+			{
+				return m_node->value.get();
+			}
+
+			const BaseT& get() const
+			{
+				return m_node->value.get();
+			}
+
+			//!
+			//! Access the dynamic_value the snapshot refers to, for example to copy it
+			//! @return a reference to the pinned dynamic_value
+			//!
+			const value_type& value() const
+			{
+				return m_node->value;
+			}
+
+		private:
+			friend class atomic_dynamic_value;
+
+			snapshot(ebr::guard&& guard, const Node* node)
+				: m_guard(std::move(guard))
+				, m_node(node)
+			{
+			}
+
+			ebr::guard m_guard;
+			const Node* m_node;
+		};
+
+		//!
+		//! Constructor
+		//! @param initial	the initial value to hold
+		//! @param domain	the reclamation domain replaced values are retired to, must outlive this object
+		//!
+		explicit atomic_dynamic_value(value_type&& initial, ebr::domain& domain = ebr::domain::global())
+			: m_domain(&domain)
+			, m_current(new Node(std::move(initial)))
+		{
+		}
+
+		//!
+		//! Constructor, moves or copies an object in as the initial held value
+		//! @tparam	T	the type of the object, must be either the same as BaseT or a child-type of it
+		//! @param initial	the object to hold
+		//! @param domain	the reclamation domain replaced values are retired to, must outlive this object
+		//!
+		template <typename T>
+		explicit atomic_dynamic_value(T&& initial, ebr::domain& domain = ebr::domain::global()) requires IsBaseOf<BaseT, std::decay_t<T>>
+			: m_domain(&domain)
+			, m_current(new Node(value_type(std::forward<T>(initial))))
+		{
+		}
+
+		atomic_dynamic_value(const atomic_dynamic_value&) = delete;
+		atomic_dynamic_value& operator=(const atomic_dynamic_value&) = delete;
+
+		//!
+		//! Destructor, destroys the held value immediately. No snapshot of it may be alive at this point.
+		//!
+		~atomic_dynamic_value()
+		{
+			delete m_current.load(std::memory_order_acquire);
+		}
+
+		//!
+		//! Takes a snapshot of the current value, wait-free
+		//! @return a snapshot pinning the value held at the time of the call
+		//!
+		snapshot load() const
+		{
+			ebr::guard guard = m_domain->pin();
+			const Node* node = m_current.load(std::memory_order_acquire);
+			return snapshot(std::move(guard), node);
+		}
+
+		//!
+		//! Publishes a new value, the replaced value is destroyed once no snapshot refers to it anymore
+		//! @param value	the new value
+		//!
+		void store(value_type&& value)
+		{
+			m_domain->retire(m_current.exchange(new Node(std::move(value)), std::memory_order_seq_cst));
+		}
+
+		//!
+		//! Publishes a new value, constructing it in-place
+		//! @tparam T	the inner type to construct, must be the same as BaseT or a child type of it
+		//! @tparam ArgT	the argument types to pass to T's constructor
+		//! @param	args	the arguments to perfectly forward to T's constructor
+		//!
+		template <typename T, typename... ArgT>
+		void emplace(ArgT&&... arguments) requires IsBaseOf<BaseT, T>&& requires (ArgT&&... args) { T(std::forward<ArgT>(args)...); }
+		{
+			Node* created = new Node(std::in_place_type<T>, std::forward<ArgT>(arguments)...);
+			m_domain->retire(m_current.exchange(created, std::memory_order_seq_cst));
+		}
+
+		//!
+		//! Publishes a new value and returns the replaced one
+		//! @param value	the new value
+		//! @return a snapshot of the replaced value, which stays alive until the snapshot is released
+		//!
+		snapshot exchange(value_type&& value)
+		{
+			ebr::guard guard = m_domain->pin();
+			Node* previous = m_current.exchange(new Node(std::move(value)), std::memory_order_seq_cst);
+			m_domain->retire(previous);
+			return snapshot(std::move(guard), previous);
+		}
+
+		//!
+		//! Publishes a new value only if the held value is still the one in expected, useful for read-modify-write updates
+		//! @param expected	a snapshot of the value that must still be held
+		//! @param desired	the new value, left untouched if the exchange fails
+		//! @return true if desired was published
+		//!
+		bool compare_exchange(const snapshot& expected, value_type&& desired)
+		{
+			if (m_current.load(std::memory_order_acquire) != expected.m_node)
+			{
+				return false;
+			}
+
+			// The snapshot pins expected, so its address cannot be reused by another node while we compare against it
+			Node* created = new Node(std::move(desired));
+			Node* previous = const_cast<Node*>(expected.m_node);
+			if (m_current.compare_exchange_strong(previous, created, std::memory_order_seq_cst))
+			{
+				m_domain->retire(previous);
+				return true;
+			}
+			desired = std::move(created->value);
+			delete created;
+			return false;
+		}
+
+	private:
+		struct Node
+		{
+			explicit Node(value_type&& initial)
+				: value(std::move(initial))
+			{
+			}
+
+			template <typename T, typename... ArgT>
+			explicit Node(std::in_place_type_t<T>, ArgT&&... arguments)
+				: value(value_type::template make_emplaced<T>(std::forward<ArgT>(arguments)...))
+			{
+			}
+
+			value_type value;
+		};
+
+		ebr::domain* m_domain;
+		std::atomic<Node*> m_current;
+	};
+}
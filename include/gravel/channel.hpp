@@ -0,0 +1,378 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <coroutine>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace gravel
+{
+
+	//!
+	//! Bounded multi-producer multi-consumer channel between coroutines, with awaitable send and recv.
+	//!
+	//! A coroutine sending to a full channel or receiving from an empty one is suspended and queued in the channel,
+	//! its thread stays free to run other work. The queue is intrusive, each waiter lives in the awaiter inside the
+	//! coroutine frame, and elements are stored inline in a ring, so neither waiting nor sending allocates. Values
+	//! are handed directly to a waiting receiver, and a sender waiting for room is refilled into the ring by the
+	//! receiver that makes room.
+	//!
+	//! Woken coroutines are resumed on the thread that wakes them, before the waking send, recv or close returns.
+	//! Await the schedule() of an executor after waking to continue elsewhere.
+	//!
+	//! NOTE: The state is guarded by a mutex that is only held for the few instructions moving an element or
+	//! waiter, never while resuming a coroutine. No coroutine may be waiting on the channel when it is destroyed.
+	//!
+	//! @tparam T	the element type, must be move constructible
+	//!
+	template <typename T>
+	class channel
+	{
+		struct Slot
+		{
+			T* value()
+			{
+				return std::launder(reinterpret_cast<T*>(storage.data()));
+			}
+
+			alignas(T) std::array<std::uint8_t, sizeof(T)> storage;
+		};
+
+		//!
+		//! FIFO of suspended awaiters, linked through their next pointers
+		//!
+		template <typename WaiterT>
+		class WaiterList
+		{
+		public:
+			void push(WaiterT* waiter)
+			{
+				waiter->m_next = nullptr;
+				if (m_tail)
+				{
+					m_tail->m_next = waiter;
+				}
+				else
+				{
+					m_head = waiter;
+				}
+				m_tail = waiter;
+			}
+
+			WaiterT* pop()
+			{
+				WaiterT* waiter = m_head;
+				if (waiter)
+				{
+					m_head = waiter->m_next;
+					if (!m_head)
+					{
+						m_tail = nullptr;
+					}
+				}
+				return waiter;
+			}
+
+			WaiterT* take_all()
+			{
+				m_tail = nullptr;
+				return std::exchange(m_head, nullptr);
+			}
+
+		private:
+			WaiterT* m_head = nullptr;
+			WaiterT* m_tail = nullptr;
+		};
+
+		class SendAwaiter
+		{
+		public:
+			SendAwaiter(channel& target, T&& value)
+				: m_channel(&target)
+				, m_value(std::move(value))
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			bool await_suspend(std::coroutine_handle<> sender)
+			{
+				std::unique_lock lock(m_channel->m_mutex);
+				switch (m_channel->offer(m_value, lock))
+				{
+				case Offer::accepted:
+					m_sent = true;
+					return false;
+				case Offer::closed:
+					return false;
+				case Offer::full:
+					break;
+				}
+				m_coroutine = sender;
+				m_channel->m_senders.push(this);
+				return true;
+			}
+
+			//! @return false if the channel was closed, the value is then discarded
+			bool await_resume() const noexcept
+			{
+				return m_sent;
+			}
+
+		private:
+			friend class channel;
+			friend class WaiterList<SendAwaiter>;
+
+			channel* m_channel;
+			T m_value;
+			bool m_sent = false;
+			std::coroutine_handle<> m_coroutine;
+			SendAwaiter* m_next = nullptr;
+		};
+
+		class RecvAwaiter
+		{
+		public:
+			explicit RecvAwaiter(channel& source)
+				: m_channel(&source)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			bool await_suspend(std::coroutine_handle<> receiver)
+			{
+				std::unique_lock lock(m_channel->m_mutex);
+				if (m_channel->take(m_value, lock) || m_channel->m_closed)
+				{
+					return false;
+				}
+				m_coroutine = receiver;
+				m_channel->m_receivers.push(this);
+				return true;
+			}
+
+			//! @return the received value, or nothing if the channel was closed and is empty
+			std::optional<T> await_resume()
+			{
+				return std::move(m_value);
+			}
+
+		private:
+			friend class channel;
+			friend class WaiterList<RecvAwaiter>;
+
+			channel* m_channel;
+			std::optional<T> m_value;
+			std::coroutine_handle<> m_coroutine;
+			RecvAwaiter* m_next = nullptr;
+		};
+
+		enum class Offer
+		{
+			accepted,
+			full,
+			closed
+		};
+
+	public:
+		//!
+		//! Constructor
+		//! @param capacity	the number of elements the channel buffers, at least one
+		//!
+		explicit channel(std::size_t capacity)
+			: m_capacity(std::max<std::size_t>(capacity, 1))
+			, m_slots(new Slot[m_capacity])
+		{
+		}
+
+		channel(const channel&) = delete;
+		channel& operator=(const channel&) = delete;
+
+		//!
+		//! Destructor, destroys any elements still buffered
+		//!
+		~channel()
+		{
+			while (m_size > 0)
+			{
+				pop_front();
+			}
+		}
+
+		//!
+		//! Sends a value, suspending the awaiting coroutine while the channel is full
+		//! @param value	the value to send
+		//! @return an awaitable resuming with true once the value is in the channel, or false if the channel was closed
+		//!
+		SendAwaiter send(T value)
+		{
+			return SendAwaiter(*this, std::move(value));
+		}
+
+		//!
+		//! Receives a value, suspending the awaiting coroutine while the channel is empty
+		//! @return an awaitable resuming with the oldest value, or with nothing once the channel is closed and empty
+		//!
+		RecvAwaiter recv()
+		{
+			return RecvAwaiter(*this);
+		}
+
+		//!
+		//! Sends a value without waiting, may be called from any thread
+		//! @param value	the value to send, left untouched if it was not sent
+		//! @return false if the channel was full or closed
+		//!
+		bool try_send(T&& value)
+		{
+			std::unique_lock lock(m_mutex);
+			return offer(value, lock) == Offer::accepted;
+		}
+
+		//!
+		//! Receives a value without waiting, may be called from any thread
+		//! @return the oldest value, or nothing if the channel was empty
+		//!
+		std::optional<T> try_recv()
+		{
+			std::optional<T> value;
+			std::unique_lock lock(m_mutex);
+			take(value, lock);
+			return value;
+		}
+
+		//!
+		//! Closes the channel, further sends fail while buffered values can still be received. Waiting receivers
+		//! resume with nothing and waiting senders with false, on the calling thread.
+		//!
+		void close()
+		{
+			std::unique_lock lock(m_mutex);
+			m_closed = true;
+			RecvAwaiter* receivers = m_receivers.take_all();
+			SendAwaiter* senders = m_senders.take_all();
+			lock.unlock();
+
+			// Read the next pointer first, a resumed coroutine may destroy its awaiter
+			while (receivers)
+			{
+				std::exchange(receivers, receivers->m_next)->m_coroutine.resume();
+			}
+			while (senders)
+			{
+				std::exchange(senders, senders->m_next)->m_coroutine.resume();
+			}
+		}
+
+		bool closed() const
+		{
+			std::scoped_lock lock(m_mutex);
+			return m_closed;
+		}
+
+		//!
+		//! The number of buffered elements at some point during the call
+		//!
+		std::size_t size() const
+		{
+			std::scoped_lock lock(m_mutex);
+			return m_size;
+		}
+
+		std::size_t capacity() const
+		{
+			return m_capacity;
+		}
+
+	private:
+		//!
+		//! Hands value to a waiting receiver or buffers it, value is only moved from if accepted. Called with the lock
+		//! held, which is released before resuming a receiver.
+		//!
+		Offer offer(T& value, std::unique_lock<std::mutex>& lock)
+		{
+			if (m_closed)
+			{
+				return Offer::closed;
+			}
+			// Receivers only wait while the ring is empty
+			if (RecvAwaiter* receiver = m_receivers.pop())
+			{
+				receiver->m_value.emplace(std::move(value));
+				lock.unlock();
+				receiver->m_coroutine.resume();
+				return Offer::accepted;
+			}
+			if (m_size == m_capacity)
+			{
+				return Offer::full;
+			}
+			push_back(std::move(value));
+			return Offer::accepted;
+		}
+
+		//!
+		//! Moves the oldest element to destination, and the value of the longest waiting sender into the room that
+		//! leaves. Called with the lock held, which is released before resuming a sender.
+		//! @return false if the ring was empty
+		//!
+		bool take(std::optional<T>& destination, std::unique_lock<std::mutex>& lock)
+		{
+			if (m_size == 0)
+			{
+				return false;
+			}
+			destination.emplace(pop_front());
+			if (SendAwaiter* sender = m_senders.pop())
+			{
+				push_back(std::move(sender->m_value));
+				sender->m_sent = true;
+				lock.unlock();
+				sender->m_coroutine.resume();
+			}
+			return true;
+		}
+
+		void push_back(T&& value)
+		{
+			std::size_t index = m_head + m_size;
+			if (index >= m_capacity)
+			{
+				index -= m_capacity;
+			}
+			new (m_slots[index].storage.data()) T(std::move(value));
+			m_size += 1;
+		}
+
+		T pop_front()
+		{
+			T* value = m_slots[m_head].value();
+			T result(std::move(*value));
+			value->~T();
+			m_head = m_head + 1 == m_capacity ? 0 : m_head + 1;
+			m_size -= 1;
+			return result;
+		}
+
+		mutable std::mutex m_mutex;
+		const std::size_t m_capacity;
+		const std::unique_ptr<Slot[]> m_slots;
+		std::size_t m_head = 0;
+		std::size_t m_size = 0;
+		bool m_closed = false;
+		WaiterList<SendAwaiter> m_senders;
+		WaiterList<RecvAwaiter> m_receivers;
+	};
+}
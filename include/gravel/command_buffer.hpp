@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "gravel/detail/closure_arena.hpp"
+
+namespace gravel
+{
+	template <typename Signature>
+	class command_buffer;
+
+	//!
+	//! Records commands to run later, typically many small ones per frame of a render or simulation loop that are
+	//! replayed once and then reset.
+	//!
+	//! Commands are any move constructible callables, unique_function included, appended back to back into one byte
+	//! arena, each behind a header with its operations and size. Recording costs no allocation once the arena has
+	//! grown to fit a frame, and commands take their own size rounded up to 16 bytes rather than a fixed slot.
+	//! reset keeps the arena and does not walk it at all when every recorded command is trivially destructible.
+	//!
+	//! NOTE: Not thread safe. Commands must not record into the buffer that is replaying them.
+	//!
+	template <typename... ArgT>
+	class command_buffer<void(ArgT...)>
+	{
+		using Arena = detail::ClosureArena<ArgT...>;
+
+	public:
+		command_buffer() = default;
+
+		//!
+		//! Constructor
+		//! @param bytes	the arena size to allocate up front
+		//!
+		explicit command_buffer(std::size_t bytes)
+		{
+			reserve(bytes);
+		}
+
+		command_buffer(command_buffer&& other) noexcept
+			: m_commands(std::move(other.m_commands))
+			, m_size(std::exchange(other.m_size, 0))
+		{
+		}
+
+		command_buffer& operator=(command_buffer&& other) noexcept
+		{
+			m_commands = std::move(other.m_commands);
+			m_size = std::exchange(other.m_size, 0);
+			return *this;
+		}
+
+		//!
+		//! Appends a command
+		//! @tparam FuncT	the type of the callable, invocable with lvalues of ArgT...
+		//! @param command	the callable, moved into the arena
+		//!
+		template <typename FuncT>
+		void record(FuncT&& command)
+		{
+			m_commands.emplace(std::forward<FuncT>(command), 0);
+			m_size += 1;
+		}
+
+		//!
+		//! Runs the recorded commands in the order they were recorded, they stay recorded
+		//! @param arguments	passed to every command as lvalues
+		//!
+		void replay(ArgT... arguments)
+		{
+			std::byte* command = m_commands.data();
+			std::byte* const end = command + m_commands.size();
+			while (command != end)
+			{
+				typename Arena::Header& header = *std::launder(reinterpret_cast<typename Arena::Header*>(command));
+				header.operations->invoke(header.closure(), arguments...);
+				command += header.size;
+			}
+		}
+
+		//!
+		//! Destroys the recorded commands, keeping the arena for the next ones
+		//!
+		void reset()
+		{
+			m_commands.clear();
+			m_size = 0;
+		}
+
+		//!
+		//! Grows the arena to at least bytes
+		//!
+		void reserve(std::size_t bytes)
+		{
+			m_commands.reserve((bytes + Arena::alignment - 1) / Arena::alignment * Arena::alignment);
+		}
+
+		//!
+		//! The number of recorded commands
+		//!
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+		//!
+		//! The bytes taken by the recorded commands
+		//!
+		std::size_t bytes() const
+		{
+			return m_commands.size();
+		}
+
+		//!
+		//! The bytes the arena holds
+		//!
+		std::size_t capacity() const
+		{
+			return m_commands.capacity();
+		}
+
+	private:
+		Arena m_commands;
+		std::size_t m_size = 0;
+	};
+}
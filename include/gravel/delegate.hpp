@@ -0,0 +1,159 @@
+#pragma once
+
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace gravel
+{
+	//!
+	//! Names a member function or function at compile time, to construct a delegate with
+	//!
+	template <auto Function>
+	struct method_t
+	{
+	};
+
+	template <auto Function>
+	inline constexpr method_t<Function> method{};
+
+	namespace detail
+	{
+		//!
+		//! The signature of a function pointer or member function pointer, without the object
+		//!
+		template <typename FunctionT>
+		struct BoundSignature;
+
+		template <typename RetT, typename... ArgT>
+		struct BoundSignature<RetT (*)(ArgT...)>
+		{
+			using type = RetT(ArgT...);
+		};
+
+		template <typename RetT, typename... ArgT>
+		struct BoundSignature<RetT (*)(ArgT...) noexcept> : BoundSignature<RetT (*)(ArgT...)>
+		{
+		};
+
+		template <typename ObjectT, typename RetT, typename... ArgT>
+		struct BoundSignature<RetT (ObjectT::*)(ArgT...)>
+		{
+			using type = RetT(ArgT...);
+		};
+
+		template <typename ObjectT, typename RetT, typename... ArgT>
+		struct BoundSignature<RetT (ObjectT::*)(ArgT...) const>
+		{
+			using type = RetT(ArgT...);
+		};
+
+		template <typename ObjectT, typename RetT, typename... ArgT>
+		struct BoundSignature<RetT (ObjectT::*)(ArgT...) noexcept> : BoundSignature<RetT (ObjectT::*)(ArgT...)>
+		{
+		};
+
+		template <typename ObjectT, typename RetT, typename... ArgT>
+		struct BoundSignature<RetT (ObjectT::*)(ArgT...) const noexcept> : BoundSignature<RetT (ObjectT::*)(ArgT...) const>
+		{
+		};
+	}
+
+	template <typename Signature>
+	class delegate;
+
+	//!
+	//! A member function bound to an object, or a function, called through a single indirect call.
+	//!
+	//! The function is a template argument, so the delegate only stores the object pointer and a thunk generated for
+	//! that function which casts the object back and calls it directly. That makes it two pointers, trivially
+	//! copyable and comparable, where putting a lambda calling the member function into a unique_function costs a
+	//! dynamic_value and a virtual call to the wrapper.
+	//!
+	//! Notes:
+	//! * Does not own the object, which must outlive the calls
+	//! * A default constructed delegate is empty and must not be called
+	//!
+	//! @tparam	Signature	the function signature of the delegate, like "bool(int, float)"
+	//!
+	template <typename RetT, typename... ArgT>
+	class delegate<RetT(ArgT...)>
+	{
+	public:
+		delegate() = default;
+
+		//!
+		//! Binds a member function to an object
+		//! @param object	the object to call the member function on
+		//! @param method	the member function, as gravel::method<&T::function>
+		//!
+		template <typename ObjectT, auto Method>
+		delegate(ObjectT* object, method_t<Method>) requires std::is_invocable_r_v<RetT, decltype(Method), ObjectT&, ArgT...>
+			: m_object(const_cast<void*>(static_cast<const void*>(object)))
+			, m_thunk(&member_thunk<ObjectT, Method>)
+		{
+		}
+
+		//!
+		//! Binds a function, or a member function whose object is passed as the first argument of each call
+		//! @param function	the function, as gravel::method<&function>
+		//!
+		template <auto Function>
+		delegate(method_t<Function>) requires std::is_invocable_r_v<RetT, decltype(Function), ArgT...>
+			: m_thunk(&function_thunk<Function>)
+		{
+		}
+
+		RetT operator()(ArgT... arguments) const
+		{
+			return m_thunk(m_object, std::forward<ArgT>(arguments)...);
+		}
+
+		explicit operator bool() const
+		{
+			return m_thunk != nullptr;
+		}
+
+		//!
+		//! Delegates are equal when they call the same function on the same object
+		//!
+		bool operator==(const delegate&) const = default;
+
+	private:
+		template <typename ObjectT, auto Method>
+		static RetT member_thunk(void* object, ArgT... arguments)
+		{
+			return std::invoke(Method, *static_cast<ObjectT*>(object), std::forward<ArgT>(arguments)...);
+		}
+
+		template <auto Function>
+		static RetT function_thunk(void*, ArgT... arguments)
+		{
+			return std::invoke(Function, std::forward<ArgT>(arguments)...);
+		}
+
+		void* m_object = nullptr;
+		RetT (*m_thunk)(void*, ArgT...) = nullptr;
+	};
+
+	//!
+	//! Binds a member function to an object, as a delegate of the signature of the member function
+	//! @tparam Method	the member function, like &T::function
+	//! @param object	the object to call the member function on
+	//!
+	template <auto Method, typename ObjectT>
+	auto bind(ObjectT* object) requires std::is_member_function_pointer_v<decltype(Method)>
+	{
+		return delegate<typename detail::BoundSignature<decltype(Method)>::type>(object, method<Method>);
+	}
+
+	//!
+	//! Binds a function, as a delegate of its signature
+	//! @tparam Function	the function, like &function
+	//!
+	template <auto Function>
+	auto bind() requires std::is_function_v<std::remove_pointer_t<decltype(Function)>>
+	{
+		return delegate<typename detail::BoundSignature<decltype(Function)>::type>(method<Function>);
+	}
+}
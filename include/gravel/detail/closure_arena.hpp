@@ -0,0 +1,297 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "gravel/relocate.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		//!
+		//! How an arena invokes, relocates and destroys a closure of a given type
+		//!
+		template <typename... ArgT>
+		struct ClosureOperations
+		{
+			void (*invoke)(void* closure, std::add_lvalue_reference_t<ArgT>... arguments);
+			void (*relocate)(void* source, void* destination);
+			//! nullptr for trivially destructible closures
+			void (*destroy)(void* closure);
+		};
+
+		template <typename FuncT, typename... ArgT>
+		inline constexpr ClosureOperations<ArgT...> closure_operations = {
+			[](void* closure, std::add_lvalue_reference_t<ArgT>... arguments) { (*static_cast<FuncT*>(closure))(arguments...); },
+			[](void* source, void* destination) { relocate_at(static_cast<FuncT*>(source), static_cast<FuncT*>(destination)); },
+			std::is_trivially_destructible_v<FuncT> ? nullptr : +[](void* closure) { static_cast<FuncT*>(closure)->~FuncT(); }
+		};
+
+		//!
+		//! What is left of a closure that was destroyed before the arena was compacted
+		//!
+		template <typename... ArgT>
+		inline constexpr ClosureOperations<ArgT...> closure_hole = {
+			[](void*, std::add_lvalue_reference_t<ArgT>...) {},
+			[](void*, void*) {},
+			nullptr
+		};
+
+		//!
+		//! Closures of any size stored back to back in one growing allocation, each behind a header with its operations
+		//! and its size, so that they are walked linearly without an allocation or a pointer per closure. Growing and
+		//! compacting relocate the closures.
+		//!
+		template <typename... ArgT>
+		class ClosureArena
+		{
+		public:
+			static constexpr std::size_t alignment = alignof(std::max_align_t);
+			//! The tag of removed closures, which compact drops
+			static constexpr std::uint32_t removed = std::numeric_limits<std::uint32_t>::max();
+
+			struct Header
+			{
+				const ClosureOperations<ArgT...>* operations;
+				//! The bytes taken by the header and the closure, a multiple of the alignment
+				std::uint32_t size;
+				//! Free for the owner of the arena to use
+				std::uint32_t tag;
+
+				void* closure()
+				{
+					return reinterpret_cast<std::byte*>(this) + header_size;
+				}
+			};
+
+			static constexpr std::size_t header_size = (sizeof(Header) + alignment - 1) / alignment * alignment;
+
+			ClosureArena() = default;
+
+			ClosureArena(ClosureArena&& other) noexcept
+				: m_bytes(std::move(other.m_bytes))
+				, m_size(std::exchange(other.m_size, 0))
+				, m_capacity(std::exchange(other.m_capacity, 0))
+				, m_destructible(std::exchange(other.m_destructible, 0))
+			{
+			}
+
+			ClosureArena& operator=(ClosureArena&& other) noexcept
+			{
+				if (this != &other)
+				{
+					clear();
+					m_bytes = std::move(other.m_bytes);
+					m_size = std::exchange(other.m_size, 0);
+					m_capacity = std::exchange(other.m_capacity, 0);
+					m_destructible = std::exchange(other.m_destructible, 0);
+				}
+				return *this;
+			}
+
+			~ClosureArena()
+			{
+				clear();
+			}
+
+			//!
+			//! Constructs a closure at the end, growing the arena if needed
+			//! @return the offset of the closure
+			//!
+			template <typename FuncT>
+			std::size_t emplace(FuncT&& function, std::uint32_t tag)
+			{
+				using BareT = std::decay_t<FuncT>;
+				static_assert(alignof(BareT) <= alignment, "closures may not be over-aligned");
+				static constexpr std::size_t size = header_size + (sizeof(BareT) + alignment - 1) / alignment * alignment;
+				reserve(m_size + size);
+				Header* header = new (m_bytes.get() + m_size) Header{ &closure_operations<BareT, ArgT...>, size, tag };
+				new (header->closure()) BareT(std::forward<FuncT>(function));
+				if constexpr (!std::is_trivially_destructible_v<BareT>)
+				{
+					m_destructible += 1;
+				}
+				return std::exchange(m_size, m_size + size);
+			}
+
+			Header& at(std::size_t offset)
+			{
+				return *std::launder(reinterpret_cast<Header*>(m_bytes.get() + offset));
+			}
+
+			std::byte* data()
+			{
+				return m_bytes.get();
+			}
+
+			//!
+			//! The number of bytes in use, closures live at offsets below it
+			//!
+			std::size_t size() const
+			{
+				return m_size;
+			}
+
+			std::size_t capacity() const
+			{
+				return m_capacity;
+			}
+
+			//!
+			//! Grows the allocation to at least size bytes, relocating the closures
+			//!
+			void reserve(std::size_t size)
+			{
+				if (size > m_capacity)
+				{
+					reallocate(std::max(size, m_capacity * 2));
+				}
+			}
+
+			//!
+			//! Destroys a closure ahead of compaction, leaving a hole that does nothing when invoked
+			//!
+			void destroy(std::size_t offset)
+			{
+				Header& header = at(offset);
+				destroy_closure(header);
+				header.operations = &closure_hole<ArgT...>;
+			}
+
+			//!
+			//! Drops the removed closures, keeping the order of the others
+			//! @param moved	called with the tag and new offset of every kept closure
+			//!
+			template <typename FuncT>
+			void compact(FuncT&& moved)
+			{
+				// Into a new allocation, relocating within the same one could overlap a closure with itself
+				ClosureArena compacted;
+				compacted.reallocate(m_capacity);
+				for (std::size_t offset = 0; offset < m_size;)
+				{
+					Header& header = at(offset);
+					offset += header.size;
+					if (header.tag == removed)
+					{
+						destroy_closure(header);
+					}
+					else
+					{
+						moved(header.tag, compacted.m_size);
+						compacted.relocate_back(header);
+					}
+				}
+				m_size = 0;
+				m_destructible = 0;
+				*this = std::move(compacted);
+			}
+
+			//!
+			//! Relocates the closures of other to the end of this arena and drops the removed ones, leaving other empty
+			//! @param moved	called with the tag and new offset of every kept closure
+			//!
+			template <typename FuncT>
+			void append(ClosureArena& other, FuncT&& moved)
+			{
+				reserve(m_size + other.m_size);
+				for (std::size_t offset = 0; offset < other.m_size;)
+				{
+					Header& header = other.at(offset);
+					offset += header.size;
+					if (header.tag == removed)
+					{
+						other.destroy_closure(header);
+					}
+					else
+					{
+						moved(header.tag, m_size);
+						relocate_back(header);
+					}
+				}
+				other.m_size = 0;
+				other.m_destructible = 0;
+			}
+
+			//!
+			//! Destroys all closures, without walking them if all are trivially destructible, keeps the allocation
+			//!
+			void clear()
+			{
+				for (std::size_t offset = 0; m_destructible > 0 && offset < m_size;)
+				{
+					Header& header = at(offset);
+					offset += header.size;
+					destroy_closure(header);
+				}
+				m_size = 0;
+			}
+
+		private:
+			struct alignas(alignment) Block
+			{
+				std::byte bytes[alignment];
+			};
+
+			struct BlockDeleter
+			{
+				void operator()(std::byte* bytes) const
+				{
+					delete[] reinterpret_cast<Block*>(bytes);
+				}
+			};
+
+			void destroy_closure(Header& header)
+			{
+				if (header.operations->destroy != nullptr)
+				{
+					header.operations->destroy(header.closure());
+					m_destructible -= 1;
+				}
+			}
+
+			//!
+			//! Relocates a closure of another arena to the end of this one, which must have room for it
+			//!
+			void relocate_back(Header& source)
+			{
+				Header* header = new (m_bytes.get() + m_size) Header{ source.operations, source.size, source.tag };
+				source.operations->relocate(source.closure(), header->closure());
+				if (source.operations->destroy != nullptr)
+				{
+					m_destructible += 1;
+				}
+				m_size += source.size;
+			}
+
+			void reallocate(std::size_t capacity)
+			{
+				ClosureArena grown;
+				grown.m_bytes.reset(reinterpret_cast<std::byte*>(new Block[capacity / alignment]));
+				grown.m_capacity = capacity;
+				for (std::size_t offset = 0; offset < m_size;)
+				{
+					Header& header = at(offset);
+					offset += header.size;
+					grown.relocate_back(header);
+				}
+				m_size = 0;
+				m_destructible = 0;
+				*this = std::move(grown);
+			}
+
+			std::unique_ptr<std::byte[], BlockDeleter> m_bytes;
+			std::size_t m_size = 0;
+			std::size_t m_capacity = 0;
+			//! The number of closures with a destructor to run
+			std::size_t m_destructible = 0;
+		};
+	}
+}
@@ -32,8 +32,8 @@ namespace gravel
 						out_local = false;
 						if (!src_local)
 						{
-							std::memcpy(small_buffer.data(), casted_source, sizeof(SubT*));
-							std::memset(src, 0, sizeof(src));
+							// Steals the heap allocation, the owning dynamic_value is responsible for releasing its pointer
+							std::memcpy(small_buffer.data(), &casted_source, sizeof(SubT*));
 						}
 						else
 						{
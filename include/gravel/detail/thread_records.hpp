@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace gravel
+{
+	namespace detail
+	{
+		//!
+		//! Append-only lock-free list of per-thread records, as used by the reclamation domains. Records are never
+		//! unlinked while the list is alive, when a thread exits its record is marked as free and may be adopted by
+		//! another thread.
+		//!
+		//! @tparam RecordT	the record type, must have an std::atomic<bool> in_use and a RecordT* next member
+		//!
+		template <typename RecordT>
+		class RecordList
+		{
+		public:
+			RecordList() = default;
+			RecordList(const RecordList&) = delete;
+
+			~RecordList()
+			{
+				RecordT* record = m_head.load(std::memory_order_acquire);
+				while (record)
+				{
+					RecordT* next = record->next;
+					delete record;
+					record = next;
+				}
+			}
+
+			//!
+			//! Adopts a free record, or creates a new one if there is none
+			//! @param create	called to create a new record if no free one exists, must return a RecordT* allocated with new
+			//! @return	a record owned by the caller until it is released
+			//!
+			template <typename CreateT>
+			RecordT& acquire(CreateT&& create)
+			{
+				for (RecordT* record = head(); record; record = record->next)
+				{
+					if (try_adopt(*record))
+					{
+						return *record;
+					}
+				}
+
+				RecordT* created = create();
+				created->next = m_head.load(std::memory_order_relaxed);
+				while (!m_head.compare_exchange_weak(created->next, created, std::memory_order_release, std::memory_order_relaxed))
+				{
+				}
+				return *created;
+			}
+
+			static bool try_adopt(RecordT& record)
+			{
+				bool expected = false;
+				return !record.in_use.load(std::memory_order_relaxed) && record.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire);
+			}
+
+			static void release(RecordT& record)
+			{
+				record.in_use.store(false, std::memory_order_release);
+			}
+
+			RecordT* head() const
+			{
+				return m_head.load(std::memory_order_acquire);
+			}
+
+		private:
+			std::atomic<RecordT*> m_head{ nullptr };
+		};
+
+		//!
+		//! Maps the domains a thread has participated in to the record it owns in them, and gives the records back
+		//! when the thread exits. Only weak references to the domain states are held, so a state dies with its owner
+		//! and takes its records with it, and the entries of dead states are pruned on the next lookup that misses.
+		//!
+		//! @tparam StateT	the shared state of a domain, must have RecordT& acquire_record() and release_record(RecordT&)
+		//! @tparam RecordT	the per-thread record type
+		//!
+		template <typename StateT, typename RecordT>
+		class ThreadRecordCache
+		{
+		public:
+			~ThreadRecordCache()
+			{
+				for (auto& entry : m_entries)
+				{
+					if (std::shared_ptr<StateT> state = entry.state.lock())
+					{
+						state->release_record(*entry.record);
+					}
+				}
+			}
+
+			static RecordT& record_for(const std::shared_ptr<StateT>& state)
+			{
+				thread_local ThreadRecordCache cache;
+				return cache.find(state);
+			}
+
+		private:
+			struct Entry
+			{
+				std::weak_ptr<StateT> state;
+				RecordT* record;
+
+				//! Compares control blocks, which stay allocated while the entry exists, so a new state that reuses
+				//! the address of a dead one never matches its entry
+				bool refers_to(const std::shared_ptr<StateT>& other) const
+				{
+					return !state.owner_before(other) && !other.owner_before(state);
+				}
+			};
+
+			RecordT& find(const std::shared_ptr<StateT>& state)
+			{
+				if (!m_entries.empty() && m_entries.front().refers_to(state))
+				{
+					return *m_entries.front().record;
+				}
+				// The records of dead states were deleted with them, only the entries are left to drop
+				std::erase_if(m_entries, [](const Entry& entry) { return entry.state.expired(); });
+				for (auto& entry : m_entries)
+				{
+					if (entry.refers_to(state))
+					{
+						// Most threads only use one or two domains, keep the last used one up front
+						std::swap(entry, m_entries.front());
+						return *m_entries.front().record;
+					}
+				}
+				m_entries.insert(m_entries.begin(), Entry{ state, &state->acquire_record() });
+				return *m_entries.front().record;
+			}
+
+			std::vector<Entry> m_entries;
+		};
+	}
+}
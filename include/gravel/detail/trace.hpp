@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace gravel
+{
+	//!
+	//! Type tags of trace events, the values below user are reserved for the instrumentation points of gravel
+	//!
+	enum class trace_event : std::uint16_t
+	{
+		//! A dynamic_value put a value on the heap, unless it is the function of a unique_function, payload: its size and
+		//! the small buffer size
+		dynamic_value_heap = 1,
+		//! A unique_function put a function object on the heap, payload: its size
+		unique_function_heap = 2,
+		//! The first tag free for applications
+		user = 0x100
+	};
+
+	namespace detail
+	{
+		using TraceHook = void (*)(trace_event event, std::uint64_t first, std::uint64_t second);
+
+		//! Where GRAVEL_TRACE sends events, set by flight_recorder::install
+		inline std::atomic<TraceHook> trace_hook{ nullptr };
+
+		//! Types that trace their own heap allocation, so that the dynamic_value holding them does not trace it again
+		template <typename T>
+		concept TracesOwnHeap = T::traces_own_heap;
+	}
+}
+
+//!
+//! Instrumentation point, compiled in when GRAVEL_ENABLE_TRACING is defined and a no-op otherwise
+//!
+#if defined(GRAVEL_ENABLE_TRACING)
+#define GRAVEL_TRACE(event, first, second)                                                                        \
+	do                                                                                                            \
+	{                                                                                                             \
+		if (::gravel::detail::TraceHook gravel_trace_hook = ::gravel::detail::trace_hook.load(std::memory_order_relaxed)) \
+		{                                                                                                         \
+			gravel_trace_hook(event, static_cast<std::uint64_t>(first), static_cast<std::uint64_t>(second));      \
+		}                                                                                                         \
+	} while (false)
+#else
+#define GRAVEL_TRACE(event, first, second) \
+	do                                     \
+	{                                      \
+	} while (false)
+#endif
@@ -8,9 +8,14 @@
 #include "detail/concepts.hpp"
 #include "detail/dynamic_value_properties.hpp"
 #include "detail/operations_table.hpp"
+#include "detail/trace.hpp"
 
 namespace gravel
 {
+	namespace detail
+	{
+		struct DynamicValueAccess;
+	}
 
 	//!
 	//! Supports dynamic object polymorphism in a value-based way leveraging your compilers standard method of handling 
@@ -369,6 +374,7 @@ namespace gravel
 		}
 	private:
 		friend class dynamic_value;
+		friend struct detail::DynamicValueAccess;
 
 		using IOperationsTable = detail::IOperationsTable<BaseT>;
 
@@ -387,6 +393,10 @@ namespace gravel
 		{
 			if constexpr (sizeof(T) > properties::small_buffer_size)
 			{
+				if constexpr (!detail::TracesOwnHeap<T>)
+				{
+					GRAVEL_TRACE(trace_event::dynamic_value_heap, sizeof(T), properties::small_buffer_size);
+				}
 				m_local = false;
 				T* created = new T(std::forward<ArgT>(arguments)...);
 				std::memcpy(m_buffer.data(), &created, sizeof(T*));
@@ -408,6 +418,10 @@ namespace gravel
 			using BareT = std::decay_t<T>;
 			if constexpr (sizeof(T) > properties::small_buffer_size)
 			{
+				if constexpr (!detail::TracesOwnHeap<BareT>)
+				{
+					GRAVEL_TRACE(trace_event::dynamic_value_heap, sizeof(BareT), properties::small_buffer_size);
+				}
 				m_local = false;
 				BareT* created = new BareT(std::forward<T>(value));
 				std::memcpy(m_buffer.data(), &created, sizeof(BareT*));
@@ -435,6 +449,11 @@ namespace gravel
 		{
 			const auto& optable = other.get_op_table();
 			optable.move(std::span<uint8_t>(m_buffer), std::span<uint8_t>(m_op_table), m_local, &other.get(), other.m_local);
+			if (!m_local && !other.m_local)
+			{
+				// The heap allocation was stolen, so other must not delete it when destroyed
+				std::memset(other.m_buffer.data(), 0, sizeof(OtherBaseT*));
+			}
 		}
 
 		const IOperationsTable& get_op_table() const
@@ -460,6 +479,48 @@ namespace gravel
 		bool m_local;
 	};
 
+	namespace detail
+	{
+		//!
+		//! Gives gravels other containers access to the storage of a dynamic_value
+		//!
+		struct DynamicValueAccess
+		{
+			//!
+			//! Takes ownership of the held value if it is stored on the heap, leaving value as if moved from
+			//! @return the released value, or nullptr if it is stored in the small buffer
+			//!
+			template <typename BaseT, typename PropertiesT>
+			static BaseT* release_heap(dynamic_value<BaseT, PropertiesT>& value)
+			{
+				if (value.m_local)
+				{
+					return nullptr;
+				}
+				BaseT* released = *reinterpret_cast<BaseT**>(value.m_buffer.data());
+				std::memset(value.m_buffer.data(), 0, sizeof(BaseT*));
+				return released;
+			}
+
+			//!
+			//! Relocates value into uninitialized storage by copying it byte by byte, if it holds its value on the heap.
+			//! Nothing points into such a dynamic_value, and its operations table only holds a vtable pointer, so the
+			//! copy is valid on all mainstream ABIs. value is left as uninitialized storage.
+			//! @return true if value was relocated, false if it holds its value in the small buffer and was left untouched
+			//!
+			template <typename BaseT, typename PropertiesT>
+			static bool relocate_heap(dynamic_value<BaseT, PropertiesT>& value, dynamic_value<BaseT, PropertiesT>* destination)
+			{
+				if (value.m_local)
+				{
+					return false;
+				}
+				std::memcpy(static_cast<void*>(destination), static_cast<const void*>(&value), sizeof(value));
+				return true;
+			}
+		};
+	}
+
 	//!
 	//! Creates a dynamic value, emplacing it's initial value so that no move or copy is needed
 	//! @tparam	BaseT	the base type of the returned dynamic value
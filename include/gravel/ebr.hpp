@@ -0,0 +1,452 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gravel/dynamic_value.hpp"
+#include "gravel/unique_function.hpp"
+#include "gravel/detail/thread_records.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		struct EbrRetired
+		{
+			void* pointer;
+			void (*reclaim)(void*);
+			std::uint64_t epoch;
+		};
+
+		struct EbrDeferred
+		{
+			unique_function<void()> function;
+			std::uint64_t epoch;
+		};
+
+		//!
+		//! Per-thread participation record of an epoch domain
+		//!
+		struct alignas(64) EbrRecord
+		{
+			//! (epoch << 1) | 1 while pinned, 0 while quiescent
+			std::atomic<std::uint64_t> state{ 0 };
+			std::atomic<bool> in_use{ true };
+			unsigned nesting = 0;
+			//! retired is only collected once it reaches this size, amortizing the scan of all records over a batch
+			std::size_t collect_threshold = 0;
+			std::vector<EbrRetired> retired;
+			std::vector<EbrDeferred> deferred;
+			EbrRecord* next = nullptr;
+
+			std::size_t pending() const
+			{
+				return retired.size() + deferred.size();
+			}
+		};
+
+		class EbrState
+		{
+		public:
+			explicit EbrState(std::size_t batch_size)
+				: m_batch_size(batch_size)
+			{
+			}
+
+			EbrState(const EbrState&) = delete;
+
+			~EbrState()
+			{
+				reclaim_all();
+			}
+
+			EbrRecord& acquire_record()
+			{
+				EbrRecord& record = m_records.acquire([this]()
+				{
+					EbrRecord* created = new EbrRecord();
+					created->collect_threshold = m_batch_size;
+					return created;
+				});
+				if (record.pending() > 0)
+				{
+					m_abandoned.fetch_sub(1, std::memory_order_relaxed);
+				}
+				return record;
+			}
+
+			void release_record(EbrRecord& record)
+			{
+				collect(record);
+				if (record.pending() > 0)
+				{
+					// Left for whichever thread adopts the record, or collects abandoned records, next
+					m_abandoned.fetch_add(1, std::memory_order_relaxed);
+				}
+				m_records.release(record);
+			}
+
+			void pin(EbrRecord& record)
+			{
+				if (record.nesting++ == 0)
+				{
+					const std::uint64_t epoch = m_epoch.load(std::memory_order_relaxed);
+					record.state.store((epoch << 1) | 1, std::memory_order_relaxed);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+				}
+			}
+
+			void unpin(EbrRecord& record)
+			{
+				if (--record.nesting == 0)
+				{
+					record.state.store(0, std::memory_order_release);
+				}
+			}
+
+			void retire(EbrRecord& record, void* pointer, void (*reclaim)(void*))
+			{
+				// The epoch must be read after the pointer was unlinked, which the caller did with a seq_cst operation
+				record.retired.push_back(EbrRetired{ pointer, reclaim, m_epoch.load(std::memory_order_seq_cst) });
+				collect_if_full(record);
+			}
+
+			void defer(EbrRecord& record, unique_function<void()>&& function)
+			{
+				record.deferred.push_back(EbrDeferred{ std::move(function), m_epoch.load(std::memory_order_seq_cst) });
+				collect_if_full(record);
+			}
+
+			//!
+			//! Attempts to advance the global epoch and reclaims everything in record that is at least two epochs old,
+			//! as well as anything left behind by exited threads.
+			//! @return the number of reclaimed objects
+			//!
+			std::size_t collect(EbrRecord& record)
+			{
+				const std::uint64_t epoch = try_advance();
+				std::size_t reclaimed = reclaim(record, epoch);
+				if (m_abandoned.load(std::memory_order_relaxed) > 0)
+				{
+					reclaimed += collect_abandoned(epoch);
+				}
+				return reclaimed;
+			}
+
+			//!
+			//! Reclaims everything retired in this domain, regardless of epoch. Only safe when no thread is pinned.
+			//!
+			void reclaim_all()
+			{
+				for (EbrRecord* record = m_records.head(); record; record = record->next)
+				{
+					reclaim(*record, UINT64_MAX);
+				}
+			}
+
+		private:
+			void collect_if_full(EbrRecord& record)
+			{
+				if (record.pending() >= record.collect_threshold)
+				{
+					collect(record);
+					// Whatever is still pinned stays in the list, wait for another full batch before scanning again
+					record.collect_threshold = record.pending() + m_batch_size;
+				}
+			}
+
+			std::size_t collect_abandoned(std::uint64_t epoch)
+			{
+				std::size_t reclaimed = 0;
+				for (EbrRecord* record = m_records.head(); record; record = record->next)
+				{
+					if (m_records.try_adopt(*record))
+					{
+						if (record->pending() > 0)
+						{
+							reclaimed += reclaim(*record, epoch);
+							if (record->pending() == 0)
+							{
+								m_abandoned.fetch_sub(1, std::memory_order_relaxed);
+							}
+						}
+						m_records.release(*record);
+					}
+				}
+				return reclaimed;
+			}
+
+			std::uint64_t try_advance()
+			{
+				std::uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				for (EbrRecord* record = m_records.head(); record; record = record->next)
+				{
+					const std::uint64_t state = record->state.load(std::memory_order_acquire);
+					if ((state & 1) && (state >> 1) != epoch)
+					{
+						return epoch;
+					}
+				}
+				if (m_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst))
+				{
+					return epoch + 1;
+				}
+				return epoch;
+			}
+
+			static bool is_reclaimable(std::uint64_t retired_epoch, std::uint64_t epoch)
+			{
+				// Anything retired at epoch e may still be read by threads pinned at e or e + 1
+				return epoch == UINT64_MAX || retired_epoch + 2 <= epoch;
+			}
+
+			static std::size_t reclaim(EbrRecord& record, std::uint64_t epoch)
+			{
+				// Reclaiming may retire further objects, so the lists are detached while they are walked
+				std::vector<EbrRetired> retired;
+				retired.swap(record.retired);
+				std::vector<EbrDeferred> deferred;
+				deferred.swap(record.deferred);
+
+				std::size_t reclaimed = 0;
+				for (const EbrRetired& entry : retired)
+				{
+					if (is_reclaimable(entry.epoch, epoch))
+					{
+						entry.reclaim(entry.pointer);
+						++reclaimed;
+					}
+					else
+					{
+						record.retired.push_back(entry);
+					}
+				}
+				for (EbrDeferred& entry : deferred)
+				{
+					if (is_reclaimable(entry.epoch, epoch))
+					{
+						entry.function();
+						++reclaimed;
+					}
+					else
+					{
+						record.deferred.push_back(std::move(entry));
+					}
+				}
+
+				// Keep the allocated capacity around for the next batch
+				if (record.retired.empty())
+				{
+					retired.clear();
+					record.retired.swap(retired);
+				}
+				return reclaimed;
+			}
+
+			const std::size_t m_batch_size;
+			std::atomic<std::uint64_t> m_epoch{ 0 };
+			RecordList<EbrRecord> m_records;
+			std::atomic<std::size_t> m_abandoned{ 0 };
+		};
+	}
+
+	namespace ebr
+	{
+		//!
+		//! Keeps the calling thread pinned in an epoch domain while alive. Anything loaded from a structure protected by
+		//! the domain while pinned is guaranteed to not be reclaimed until the guard is released.
+		//!
+		//! NOTE: Guards are cheap to nest, but must be released on the thread that created them.
+		//!
+		class guard
+		{
+		public:
+			guard(const guard&) = delete;
+
+			guard(guard&& other) noexcept
+				: m_state(std::exchange(other.m_state, nullptr))
+				, m_record(std::exchange(other.m_record, nullptr))
+			{
+			}
+
+			guard& operator=(const guard&) = delete;
+
+			guard& operator=(guard&& other) noexcept
+			{
+				if (this != &other)
+				{
+					release();
+					m_state = std::exchange(other.m_state, nullptr);
+					m_record = std::exchange(other.m_record, nullptr);
+				}
+				return *this;
+			}
+
+			~guard()
+			{
+				release();
+			}
+
+			//!
+			//! Unpins the thread early, the guard is empty afterwards
+			//!
+			void release()
+			{
+				if (m_record)
+				{
+					m_state->unpin(*m_record);
+					m_state = nullptr;
+					m_record = nullptr;
+				}
+			}
+
+		private:
+			friend class domain;
+
+			guard(detail::EbrState& state, detail::EbrRecord& record)
+				: m_state(&state)
+				, m_record(&record)
+			{
+				m_state->pin(*m_record);
+			}
+
+			detail::EbrState* m_state;
+			detail::EbrRecord* m_record;
+		};
+
+		//!
+		//! Epoch based reclamation domain. Readers pin the domain while accessing shared objects, writers retire objects
+		//! after unlinking them, and retired objects are reclaimed once every thread pinned at the time of retiring has
+		//! unpinned.
+		//!
+		//! Every thread keeps its own retire list, which is only scanned once a batch of objects has been retired so that
+		//! the cost of checking the epochs of all threads is amortized over the batch. Anything a thread has not reclaimed
+		//! when it exits is picked up by the other threads of the domain.
+		//!
+		//! NOTE: Destroying a domain reclaims everything retired in it, so no thread may be pinned in it at that time.
+		//!
+		class domain
+		{
+		public:
+			//!
+			//! Constructor
+			//! @param batch_size	the number of objects a thread retires between attempts to reclaim them
+			//!
+			explicit domain(std::size_t batch_size = 64)
+				: m_state(std::make_shared<detail::EbrState>(batch_size))
+			{
+			}
+
+			domain(const domain&) = delete;
+			domain& operator=(const domain&) = delete;
+
+			~domain()
+			{
+				m_state->reclaim_all();
+			}
+
+			//!
+			//! Pins the calling thread in this domain
+			//! @return a guard keeping the thread pinned until it is released or destroyed
+			//!
+			guard pin()
+			{
+				return guard(*m_state, Records::record_for(m_state));
+			}
+
+			//!
+			//! Retires an object that has been unlinked from all shared structures, it will be deleted once no thread
+			//! can still hold a reference to it.
+			//! @tparam	T	the type of the object, it will be deleted as a T
+			//! @param object	the object to retire, must have been allocated with new
+			//!
+			template <typename T>
+			void retire(T* object)
+			{
+				retire(object, [](void* pointer) { delete static_cast<T*>(pointer); });
+			}
+
+			//!
+			//! Retires an object that has been unlinked from all shared structures
+			//! @param pointer	the object to retire
+			//! @param reclaim	called with pointer once no thread can still hold a reference to it
+			//!
+			void retire(void* pointer, void (*reclaim)(void*))
+			{
+				m_state->retire(Records::record_for(m_state), pointer, reclaim);
+			}
+
+			//!
+			//! Retires the value held by a dynamic value, it is destroyed once no thread can still hold a reference to it.
+			//! Values stored on the heap are retired without any allocation, values in the small buffer are moved to the heap.
+			//! @param value	the dynamic value to retire, must not be used afterwards without a new value being assigned to it
+			//!
+			template <typename BaseT, typename PropertiesT>
+			void retire(dynamic_value<BaseT, PropertiesT>&& value)
+			{
+				if (BaseT* released = detail::DynamicValueAccess::release_heap(value))
+				{
+					retire(released);
+				}
+				else
+				{
+					retire(new dynamic_value<BaseT, PropertiesT>(std::move(value)));
+				}
+			}
+
+			//!
+			//! Retires a function that reclaims some resource, it is invoked and then destroyed once no thread pinned at the
+			//! time of retiring is still pinned.
+			//! @param reclaim	the function to invoke
+			//!
+			void retire(unique_function<void()>&& reclaim)
+			{
+				m_state->defer(Records::record_for(m_state), std::move(reclaim));
+			}
+
+			//!
+			//! Tries to advance the epoch and reclaims objects retired by the calling thread that are safe to reclaim,
+			//! regardless of whether a full batch has been retired
+			//! @return the number of objects reclaimed
+			//!
+			std::size_t collect()
+			{
+				return m_state->collect(Records::record_for(m_state));
+			}
+
+			//!
+			//! Blocks until everything the calling thread has retired has been reclaimed.
+			//! NOTE: The calling thread must not be pinned, and other threads must eventually unpin.
+			//!
+			void synchronize()
+			{
+				detail::EbrRecord& record = Records::record_for(m_state);
+				m_state->collect(record);
+				while (record.pending() > 0)
+				{
+					std::this_thread::yield();
+					m_state->collect(record);
+				}
+			}
+
+			//!
+			//! The process-wide default domain
+			//!
+			static domain& global()
+			{
+				static domain instance;
+				return instance;
+			}
+
+		private:
+			using Records = detail::ThreadRecordCache<detail::EbrState, detail::EbrRecord>;
+
+			std::shared_ptr<detail::EbrState> m_state;
+		};
+	}
+}
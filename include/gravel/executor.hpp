@@ -0,0 +1,82 @@
+#pragma once
+
+#include <concepts>
+#include <coroutine>
+#include <utility>
+
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		//!
+		//! Awaitable that resumes the awaiting coroutine as a task of an executor. The task only captures the
+		//! coroutine handle, so it fits inline in a unique_function and hopping never allocates.
+		//!
+		template <typename ExecutorT>
+		class ScheduleAwaiter
+		{
+		public:
+			explicit ScheduleAwaiter(ExecutorT& executor)
+				: m_executor(&executor)
+			{
+			}
+
+			bool await_ready() const noexcept
+			{
+				return false;
+			}
+
+			void await_suspend(std::coroutine_handle<> awaiting)
+			{
+				m_executor->submit(unique_function<void()>([awaiting]() { awaiting.resume(); }));
+			}
+
+			void await_resume() const noexcept
+			{
+			}
+
+		private:
+			ExecutorT* m_executor;
+		};
+	}
+
+	//!
+	//! Something that runs unique_function<void()> tasks, some time after they were submitted and on any thread,
+	//! such as a thread_pool or a strand
+	//!
+	template<typename T>
+	concept Executor = requires (T& executor, unique_function<void()>&& task) { executor.submit(std::move(task)); };
+
+	//!
+	//! Executor that runs every task immediately on the submitting thread
+	//!
+	class inline_executor
+	{
+	public:
+		void submit(unique_function<void()>&& task)
+		{
+			task();
+		}
+
+		//!
+		//! Awaitable that resumes the awaiting coroutine right away
+		//!
+		detail::ScheduleAwaiter<inline_executor> schedule()
+		{
+			return detail::ScheduleAwaiter<inline_executor>(*this);
+		}
+	};
+
+	//!
+	//! Gets an awaitable that resumes the awaiting coroutine as a task of executor, for executors without a schedule
+	//! member of their own
+	//! @param executor	the executor to continue on
+	//!
+	template <Executor ExecutorT>
+	detail::ScheduleAwaiter<ExecutorT> schedule(ExecutorT& executor)
+	{
+		return detail::ScheduleAwaiter<ExecutorT>(executor);
+	}
+}
@@ -0,0 +1,498 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "gravel/mpsc_queue.hpp"
+#include "gravel/thread_pool.hpp"
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		//!
+		//! The submission and completion rings of an io_uring instance, driven through the raw system calls
+		//!
+		class IoUring
+		{
+		public:
+			//!
+			//! Sets up a ring
+			//! @param entries	the number of submission queue entries, rounded up to a power of two by the kernel
+			//! @return the ring, or nothing if the kernel does not allow io_uring or lacks IORING_OP_READ and IORING_OP_WRITE
+			//!
+			static std::unique_ptr<IoUring> create(unsigned entries)
+			{
+				io_uring_params parameters{};
+				const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &parameters));
+				if (fd < 0)
+				{
+					return nullptr;
+				}
+				std::unique_ptr<IoUring> ring(new IoUring(fd, parameters));
+				// IORING_FEAT_RW_CUR_POS came with the kernel that added IORING_OP_READ and IORING_OP_WRITE
+				if (!ring->mapped() || !(parameters.features & IORING_FEAT_RW_CUR_POS))
+				{
+					return nullptr;
+				}
+				return ring;
+			}
+
+			IoUring(const IoUring&) = delete;
+			IoUring& operator=(const IoUring&) = delete;
+
+			~IoUring()
+			{
+				if (m_sqes != MAP_FAILED)
+				{
+					::munmap(m_sqes, m_sqes_size);
+				}
+				if (m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring)
+				{
+					::munmap(m_cq_ring, m_cq_ring_size);
+				}
+				if (m_sq_ring != MAP_FAILED)
+				{
+					::munmap(m_sq_ring, m_sq_ring_size);
+				}
+				::close(m_fd);
+			}
+
+			//!
+			//! Checks if every submission queue entry is taken by an operation the kernel has not consumed yet
+			//!
+			bool full() const
+			{
+				return m_sq_tail - std::atomic_ref<unsigned>(*m_sq_head).load(std::memory_order_acquire) == m_sq_entries;
+			}
+
+			//!
+			//! Fills the next submission queue entry, which the kernel only sees on the next enter
+			//!
+			void push(std::uint8_t opcode, int fd, const void* address, std::uint32_t length, std::uint64_t offset, std::uint64_t user_data)
+			{
+				const unsigned index = m_sq_tail & m_sq_mask;
+				io_uring_sqe& entry = m_entries[index];
+				entry = io_uring_sqe{};
+				entry.opcode = opcode;
+				entry.fd = fd;
+				entry.addr = reinterpret_cast<std::uint64_t>(address);
+				entry.len = length;
+				entry.off = offset;
+				entry.user_data = user_data;
+				m_sq_array[index] = index;
+				m_sq_tail += 1;
+			}
+
+			//!
+			//! Hands all pushed entries to the kernel in one system call
+			//! @param min_complete	the number of completions to wait for
+			//!
+			void enter(unsigned min_complete)
+			{
+				std::atomic_ref<unsigned>(*m_sq_tail_shared).store(m_sq_tail, std::memory_order_release);
+				const unsigned to_submit = m_sq_tail - std::atomic_ref<unsigned>(*m_sq_head).load(std::memory_order_acquire);
+				if (to_submit == 0 && min_complete == 0)
+				{
+					return;
+				}
+				const unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+				if (::syscall(__NR_io_uring_enter, m_fd, to_submit, min_complete, flags, nullptr, 0) < 0
+					&& errno != EINTR && errno != EAGAIN && errno != EBUSY)
+				{
+					throw std::system_error(errno, std::generic_category(), "io_uring_enter");
+				}
+			}
+
+			//!
+			//! Passes the available completions to function, releasing each entry before the call so that function
+			//! may submit and reap again
+			//! @param function	called as void(std::uint64_t user_data, std::int32_t result)
+			//! @return the number of completions
+			//!
+			template <typename FuncT>
+			std::size_t reap(FuncT&& function)
+			{
+				std::atomic_ref<unsigned> head(*m_cq_head);
+				std::atomic_ref<unsigned> tail(*m_cq_tail);
+				std::size_t count = 0;
+				unsigned current = head.load(std::memory_order_relaxed);
+				while (current != tail.load(std::memory_order_acquire))
+				{
+					const io_uring_cqe& entry = m_cqes[current & m_cq_mask];
+					const std::uint64_t user_data = entry.user_data;
+					const std::int32_t result = entry.res;
+					head.store(++current, std::memory_order_release);
+					function(user_data, result);
+					count += 1;
+					current = head.load(std::memory_order_relaxed);
+				}
+				return count;
+			}
+
+			//!
+			//! The number of completion queue entries, the most operations that can be in flight without overflowing
+			//!
+			unsigned completion_entries() const
+			{
+				return m_cq_entries;
+			}
+
+		private:
+			IoUring(int fd, const io_uring_params& parameters)
+				: m_fd(fd)
+				, m_sq_entries(parameters.sq_entries)
+				, m_cq_entries(parameters.cq_entries)
+			{
+				m_sq_ring_size = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+				m_cq_ring_size = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+				const bool single = (parameters.features & IORING_FEAT_SINGLE_MMAP) != 0;
+				if (single)
+				{
+					m_sq_ring_size = m_cq_ring_size = std::max(m_sq_ring_size, m_cq_ring_size);
+				}
+				m_sq_ring = ::mmap(nullptr, m_sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+				m_cq_ring = single ? m_sq_ring : ::mmap(nullptr, m_cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+				m_sqes_size = parameters.sq_entries * sizeof(io_uring_sqe);
+				m_sqes = ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+				if (!mapped())
+				{
+					return;
+				}
+
+				std::byte* sq = static_cast<std::byte*>(m_sq_ring);
+				m_sq_head = reinterpret_cast<unsigned*>(sq + parameters.sq_off.head);
+				m_sq_tail_shared = reinterpret_cast<unsigned*>(sq + parameters.sq_off.tail);
+				m_sq_mask = *reinterpret_cast<unsigned*>(sq + parameters.sq_off.ring_mask);
+				m_sq_array = reinterpret_cast<unsigned*>(sq + parameters.sq_off.array);
+				m_sq_tail = *m_sq_tail_shared;
+				m_entries = static_cast<io_uring_sqe*>(m_sqes);
+
+				std::byte* cq = static_cast<std::byte*>(m_cq_ring);
+				m_cq_head = reinterpret_cast<unsigned*>(cq + parameters.cq_off.head);
+				m_cq_tail = reinterpret_cast<unsigned*>(cq + parameters.cq_off.tail);
+				m_cq_mask = *reinterpret_cast<unsigned*>(cq + parameters.cq_off.ring_mask);
+				m_cqes = reinterpret_cast<io_uring_cqe*>(cq + parameters.cq_off.cqes);
+			}
+
+			bool mapped() const
+			{
+				return m_sq_ring != MAP_FAILED && m_cq_ring != MAP_FAILED && m_sqes != MAP_FAILED;
+			}
+
+			int m_fd;
+			unsigned m_sq_entries;
+			unsigned m_cq_entries;
+			void* m_sq_ring = MAP_FAILED;
+			void* m_cq_ring = MAP_FAILED;
+			void* m_sqes = MAP_FAILED;
+			std::size_t m_sq_ring_size = 0;
+			std::size_t m_cq_ring_size = 0;
+			std::size_t m_sqes_size = 0;
+
+			unsigned* m_sq_head = nullptr;
+			unsigned* m_sq_tail_shared = nullptr;
+			unsigned* m_sq_array = nullptr;
+			unsigned m_sq_mask = 0;
+			//! Entries are published to the kernel by storing this to m_sq_tail_shared
+			unsigned m_sq_tail = 0;
+			io_uring_sqe* m_entries = nullptr;
+
+			unsigned* m_cq_head = nullptr;
+			unsigned* m_cq_tail = nullptr;
+			unsigned m_cq_mask = 0;
+			io_uring_cqe* m_cqes = nullptr;
+		};
+	}
+
+	//!
+	//! Asynchronous reads and writes at offsets of local files, completing through unique_function<void(ssize_t)>
+	//! handlers that receive the number of bytes transferred or a negated errno, like pread and pwrite.
+	//!
+	//! Operations are queued as io_uring submission queue entries and handed to the kernel in one batch by submit,
+	//! poll or wait, with the handlers stored inline in a slot reused once the operation completes. Where the kernel
+	//! does not provide io_uring, or it is disabled by a seccomp filter, the operations run as pread and pwrite tasks
+	//! of a thread_pool instead, which hand their results back through an mpsc_queue.
+	//!
+	//! Either way handlers only run inside poll, wait and drain, on the thread calling them.
+	//!
+	//! NOTE: Not thread safe, intended to be owned by a single thread. Buffers must stay valid until the handler of
+	//! their operation has run. Handlers may start new operations, but must not call poll, wait or drain. Starting
+	//! an operation while io_uring has as many in flight as it has completion queue entries runs completions first.
+	//!
+	class file_io
+	{
+	public:
+		using Handler = unique_function<void(ssize_t)>;
+
+		enum class backend
+		{
+			io_uring,
+			thread_pool
+		};
+
+		//!
+		//! Constructor
+		//! @param fallback	the pool to run pread and pwrite on where io_uring is unavailable
+		//! @param queue_depth	the number of operations that can be queued before submitting, more are submitted as needed
+		//! @param preferred	backend::thread_pool to use the fallback even where io_uring is available
+		//!
+		explicit file_io(gravel::thread_pool& fallback, unsigned queue_depth = 256, backend preferred = backend::io_uring)
+			: m_fallback(fallback)
+		{
+			if (preferred == backend::io_uring)
+			{
+				m_ring = detail::IoUring::create(std::max(queue_depth, 1u));
+			}
+		}
+
+		file_io(const file_io&) = delete;
+		file_io& operator=(const file_io&) = delete;
+
+		//!
+		//! Destructor, waits for the operations in flight and runs their handlers
+		//!
+		~file_io()
+		{
+			drain();
+		}
+
+		//!
+		//! Queues a read
+		//! @param fd	the file to read from
+		//! @param buffer	the bytes to read into
+		//! @param offset	the position in the file to read from
+		//! @param done	called with the number of bytes read, zero at the end of the file, or a negated errno
+		//!
+		void async_read(int fd, std::span<std::byte> buffer, std::uint64_t offset, Handler&& done)
+		{
+			start(false, fd, buffer.data(), buffer.size(), offset, std::move(done));
+		}
+
+		template <typename FuncT>
+		void async_read(int fd, std::span<std::byte> buffer, std::uint64_t offset, FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, Handler>)
+		{
+			async_read(fd, buffer, offset, Handler(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Queues a write
+		//! @param fd	the file to write to
+		//! @param buffer	the bytes to write
+		//! @param offset	the position in the file to write at
+		//! @param done	called with the number of bytes written or a negated errno
+		//!
+		void async_write(int fd, std::span<const std::byte> buffer, std::uint64_t offset, Handler&& done)
+		{
+			start(true, fd, const_cast<std::byte*>(buffer.data()), buffer.size(), offset, std::move(done));
+		}
+
+		template <typename FuncT>
+		void async_write(int fd, std::span<const std::byte> buffer, std::uint64_t offset, FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, Handler>)
+		{
+			async_write(fd, buffer, offset, Handler(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Hands the queued operations to the kernel in one system call
+		//!
+		void submit()
+		{
+			if (m_ring)
+			{
+				m_ring->enter(0);
+			}
+		}
+
+		//!
+		//! Submits the queued operations and runs the handlers of the completed ones, without blocking
+		//! @return the number of handlers run
+		//!
+		std::size_t poll()
+		{
+			submit();
+			return complete();
+		}
+
+		//!
+		//! Submits the queued operations and blocks until at least one completes, unless none is in flight
+		//! @return the number of handlers run
+		//!
+		std::size_t wait()
+		{
+			while (m_in_flight > 0)
+			{
+				if (const std::size_t ran = poll())
+				{
+					return ran;
+				}
+				if (m_ring)
+				{
+					m_ring->enter(1);
+				}
+				else
+				{
+					m_ready.wait(0, std::memory_order_acquire);
+				}
+			}
+			return 0;
+		}
+
+		//!
+		//! Waits until every operation in flight has completed and its handler has run
+		//!
+		void drain()
+		{
+			while (m_in_flight > 0)
+			{
+				wait();
+			}
+		}
+
+		//!
+		//! The number of operations whose handler has not run yet
+		//!
+		std::size_t in_flight() const
+		{
+			return m_in_flight;
+		}
+
+		backend active_backend() const
+		{
+			return m_ring ? backend::io_uring : backend::thread_pool;
+		}
+
+	private:
+		//! The most bytes Linux transfers in one read or write
+		static constexpr std::size_t max_transfer = 0x7ffff000;
+		static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+		struct Slot
+		{
+			std::optional<Handler> handler;
+			//! The operation, read by the pool task of the fallback
+			std::byte* data = nullptr;
+			std::size_t size = 0;
+			std::uint64_t offset = 0;
+			int fd = -1;
+			bool write = false;
+			std::uint32_t next_free = none;
+		};
+
+		struct Completion
+		{
+			std::uint32_t slot;
+			ssize_t result;
+		};
+
+		void start(bool write, int fd, std::byte* data, std::size_t size, std::uint64_t offset, Handler&& done)
+		{
+			if (m_ring)
+			{
+				// Every operation in flight needs a completion queue entry, make room by running completions
+				while (m_in_flight >= m_ring->completion_entries())
+				{
+					wait();
+				}
+				while (m_ring->full())
+				{
+					m_ring->enter(0);
+					if (m_ring->full())
+					{
+						wait();
+					}
+				}
+			}
+
+			const std::uint32_t index = allocate();
+			Slot& slot = m_slots[index];
+			slot.handler.emplace(std::move(done));
+			slot.data = data;
+			slot.size = std::min(size, max_transfer);
+			slot.offset = offset;
+			slot.fd = fd;
+			slot.write = write;
+			m_in_flight += 1;
+
+			if (m_ring)
+			{
+				m_ring->push(write ? IORING_OP_WRITE : IORING_OP_READ, fd, data, static_cast<std::uint32_t>(slot.size), offset, index);
+				return;
+			}
+			m_fallback.submit([this, &slot, index]()
+			{
+				const ssize_t result = slot.write ? ::pwrite(slot.fd, slot.data, slot.size, static_cast<off_t>(slot.offset))
+					: ::pread(slot.fd, slot.data, slot.size, static_cast<off_t>(slot.offset));
+				m_completed.push(Completion{ index, result < 0 ? -errno : result });
+				m_ready.fetch_add(1, std::memory_order_release);
+				m_ready.notify_one();
+			});
+		}
+
+		std::size_t complete()
+		{
+			std::size_t ran = 0;
+			if (m_ring)
+			{
+				ran += m_ring->reap([this](std::uint64_t index, std::int32_t result) { finish(static_cast<std::uint32_t>(index), result); });
+			}
+			if (m_ready.load(std::memory_order_acquire) != 0)
+			{
+				const std::size_t count = m_completed.consume([this](Completion&& completion) { finish(completion.slot, completion.result); });
+				m_ready.fetch_sub(count, std::memory_order_relaxed);
+				ran += count;
+			}
+			return ran;
+		}
+
+		void finish(std::uint32_t index, ssize_t result)
+		{
+			Slot& slot = m_slots[index];
+			Handler handler = std::move(*slot.handler);
+			slot.handler.reset();
+			slot.next_free = std::exchange(m_free, index);
+			m_in_flight -= 1;
+			handler(result);
+		}
+
+		std::uint32_t allocate()
+		{
+			if (m_free != none)
+			{
+				return std::exchange(m_free, m_slots[m_free].next_free);
+			}
+			// A deque never moves its elements, so pool tasks can read their slot while others are added
+			m_slots.emplace_back();
+			return static_cast<std::uint32_t>(m_slots.size() - 1);
+		}
+
+		gravel::thread_pool& m_fallback;
+		std::unique_ptr<detail::IoUring> m_ring;
+		std::deque<Slot> m_slots;
+		std::uint32_t m_free = none;
+		std::size_t m_in_flight = 0;
+		mpsc_queue<Completion> m_completed;
+		alignas(64) std::atomic<std::size_t> m_ready{ 0 };
+	};
+}
+
+#endif
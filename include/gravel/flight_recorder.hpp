@@ -0,0 +1,350 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <system_error>
+#include <vector>
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "gravel/detail/thread_records.hpp"
+#include "gravel/detail/trace.hpp"
+
+namespace gravel
+{
+	//!
+	//! A recorded event as laid out in a dump
+	//!
+	struct flight_event
+	{
+		//! Ticks of the clock named in the dump header
+		std::uint64_t timestamp;
+		std::uint16_t type;
+		std::array<std::uint16_t, 3> reserved;
+		std::array<std::uint64_t, 2> payload;
+	};
+
+	//!
+	//! The start of a dump, followed by thread_count sections of a flight_thread_header and its events, oldest first.
+	//! All fields are in the byte order of the recording machine, so that a dump can be mapped and read in place.
+	//!
+	struct flight_dump_header
+	{
+		static constexpr std::array<char, 8> expected_magic = { 'G', 'R', 'V', 'L', 'F', 'L', 'T', '1' };
+
+		enum clock_type : std::uint32_t
+		{
+			//! Timestamps are rdtsc ticks
+			tsc = 0,
+			//! Timestamps are CLOCK_MONOTONIC nanoseconds
+			monotonic = 1
+		};
+
+		std::array<char, 8> magic;
+		std::uint32_t event_size;
+		std::uint32_t clock;
+		//! Timestamps taken together with CLOCK_REALTIME nanoseconds when the recorder was created and when it was
+		//! dumped, to convert timestamps to wall clock time by interpolation
+		std::uint64_t start_ticks;
+		std::uint64_t start_realtime_ns;
+		std::uint64_t dump_ticks;
+		std::uint64_t dump_realtime_ns;
+		std::uint64_t thread_count;
+	};
+
+	struct flight_thread_header
+	{
+		//! The Linux thread id of the recording thread
+		std::uint64_t thread_id;
+		std::uint64_t event_count;
+	};
+
+	namespace detail
+	{
+		//!
+		//! The ring of one recording thread. Events are claimed before and committed after being written, so that a
+		//! dump taken while the thread keeps recording can tell which of the events it copied were overwritten.
+		//!
+		struct FlightRing
+		{
+			struct Slot
+			{
+				std::atomic<std::uint64_t> timestamp;
+				std::atomic<std::uint64_t> type;
+				std::array<std::atomic<std::uint64_t>, 2> payload;
+			};
+
+			explicit FlightRing(std::size_t capacity)
+				: mask(capacity - 1)
+				, slots(new Slot[capacity])
+			{
+			}
+
+			std::atomic<bool> in_use{ true };
+			FlightRing* next = nullptr;
+
+			const std::uint64_t mask;
+			const std::unique_ptr<Slot[]> slots;
+			std::atomic<std::uint64_t> thread_id{ 0 };
+			//! The first event of the current thread, events before it belong to a thread that exited
+			std::atomic<std::uint64_t> first{ 0 };
+			alignas(64) std::atomic<std::uint64_t> claimed{ 0 };
+			std::atomic<std::uint64_t> committed{ 0 };
+		};
+
+		class FlightState
+		{
+		public:
+			explicit FlightState(std::size_t capacity)
+				: capacity(capacity)
+			{
+			}
+
+			FlightRing& acquire_record()
+			{
+				FlightRing& ring = rings.acquire([this]() { return new FlightRing(capacity); });
+				ring.first.store(ring.committed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+				ring.thread_id.store(static_cast<std::uint64_t>(::syscall(SYS_gettid)), std::memory_order_release);
+				return ring;
+			}
+
+			void release_record(FlightRing& ring)
+			{
+				RecordList<FlightRing>::release(ring);
+			}
+
+			const std::size_t capacity;
+			RecordList<FlightRing> rings;
+		};
+	}
+
+	//!
+	//! Always-on recorder of small binary events for post-mortem analysis.
+	//!
+	//! Every thread records into a fixed-size ring of its own that overwrites its oldest events, so recording is a
+	//! timestamp, a handful of stores and no synchronization with other threads. Timestamps are rdtsc ticks on x86
+	//! and CLOCK_MONOTONIC nanoseconds elsewhere. dump writes the events of all threads in a flat format described by
+	//! flight_dump_header, which can be mapped and read in place, and may be called while threads keep recording.
+	//!
+	//! install makes a recorder the sink of the GRAVEL_TRACE instrumentation points in dynamic_value and
+	//! unique_function, which are compiled in when GRAVEL_ENABLE_TRACING is defined.
+	//!
+	class flight_recorder
+	{
+		using State = detail::FlightState;
+
+	public:
+		//!
+		//! Constructor
+		//! @param events_per_thread	the number of most recent events kept per thread, rounded up to a power of two
+		//!
+		explicit flight_recorder(std::size_t events_per_thread = 4096)
+			: m_state(std::make_shared<State>(std::bit_ceil(std::max<std::size_t>(events_per_thread, 1))))
+			, m_start_ticks(now())
+			, m_start_realtime_ns(realtime_ns())
+		{
+		}
+
+		flight_recorder(const flight_recorder&) = delete;
+		flight_recorder& operator=(const flight_recorder&) = delete;
+
+		//!
+		//! Destructor, uninstalls the recorder if it is installed
+		//!
+		~flight_recorder()
+		{
+			flight_recorder* self = this;
+			if (installed().compare_exchange_strong(self, nullptr, std::memory_order_acq_rel))
+			{
+				detail::trace_hook.store(nullptr, std::memory_order_release);
+			}
+		}
+
+		//!
+		//! Records an event of the calling thread
+		//! @param type	the tag of the event, values of trace_event::user and above are free for applications
+		//! @param first	the first payload word
+		//! @param second	the second payload word
+		//!
+		void record(std::uint16_t type, std::uint64_t first = 0, std::uint64_t second = 0)
+		{
+			detail::FlightRing& ring = Records::record_for(m_state);
+			const std::uint64_t index = ring.claimed.load(std::memory_order_relaxed);
+			ring.claimed.store(index + 1, std::memory_order_relaxed);
+			// Pairs with the fence in copy, a dump that sees any of the stores below also sees the claim
+			std::atomic_thread_fence(std::memory_order_release);
+			detail::FlightRing::Slot& slot = ring.slots[index & ring.mask];
+			slot.timestamp.store(now(), std::memory_order_relaxed);
+			slot.type.store(type, std::memory_order_relaxed);
+			slot.payload[0].store(first, std::memory_order_relaxed);
+			slot.payload[1].store(second, std::memory_order_relaxed);
+			ring.committed.store(index + 1, std::memory_order_release);
+		}
+
+		void record(trace_event type, std::uint64_t first = 0, std::uint64_t second = 0)
+		{
+			record(static_cast<std::uint16_t>(type), first, second);
+		}
+
+		//!
+		//! Writes the recorded events of all threads to a file descriptor
+		//! @param fd	the file descriptor to write to, stays owned by the caller
+		//!
+		void dump(int fd) const
+		{
+			std::vector<std::pair<std::uint64_t, std::vector<flight_event>>> threads;
+			for (detail::FlightRing* ring = m_state->rings.head(); ring; ring = ring->next)
+			{
+				threads.emplace_back(ring->thread_id.load(std::memory_order_acquire), copy(*ring));
+			}
+
+			flight_dump_header header{};
+			header.magic = flight_dump_header::expected_magic;
+			header.event_size = sizeof(flight_event);
+#if defined(__x86_64__) || defined(__i386__)
+			header.clock = flight_dump_header::tsc;
+#else
+			header.clock = flight_dump_header::monotonic;
+#endif
+			header.start_ticks = m_start_ticks;
+			header.start_realtime_ns = m_start_realtime_ns;
+			header.dump_ticks = now();
+			header.dump_realtime_ns = realtime_ns();
+			header.thread_count = threads.size();
+			write_all(fd, &header, sizeof(header));
+			for (const auto& [thread_id, events] : threads)
+			{
+				const flight_thread_header thread{ thread_id, events.size() };
+				write_all(fd, &thread, sizeof(thread));
+				write_all(fd, events.data(), events.size() * sizeof(flight_event));
+			}
+		}
+
+		//!
+		//! Makes this recorder the sink of the GRAVEL_TRACE instrumentation points, replacing any other
+		//!
+		void install()
+		{
+			installed().store(this, std::memory_order_release);
+			detail::trace_hook.store(&trace, std::memory_order_release);
+		}
+
+		//!
+		//! Disconnects the instrumentation points from whichever recorder is installed. Threads inside an
+		//! instrumentation point may still be recording, so only destroy the recorder once they are done.
+		//!
+		static void uninstall()
+		{
+			detail::trace_hook.store(nullptr, std::memory_order_release);
+			installed().store(nullptr, std::memory_order_release);
+		}
+
+		//!
+		//! The current timestamp as recorded
+		//!
+		static std::uint64_t now()
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			return __rdtsc();
+#else
+			timespec time;
+			::clock_gettime(CLOCK_MONOTONIC, &time);
+			return static_cast<std::uint64_t>(time.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(time.tv_nsec);
+#endif
+		}
+
+	private:
+		using Records = detail::ThreadRecordCache<State, detail::FlightRing>;
+
+		static std::atomic<flight_recorder*>& installed()
+		{
+			static std::atomic<flight_recorder*> recorder{ nullptr };
+			return recorder;
+		}
+
+		static void trace(trace_event event, std::uint64_t first, std::uint64_t second)
+		{
+			if (flight_recorder* recorder = installed().load(std::memory_order_acquire))
+			{
+				recorder->record(event, first, second);
+			}
+		}
+
+		static std::uint64_t realtime_ns()
+		{
+			timespec time;
+			::clock_gettime(CLOCK_REALTIME, &time);
+			return static_cast<std::uint64_t>(time.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(time.tv_nsec);
+		}
+
+		//!
+		//! Copies the committed events of a ring that were not overwritten while copying, oldest first
+		//!
+		static std::vector<flight_event> copy(const detail::FlightRing& ring)
+		{
+			const std::uint64_t capacity = ring.mask + 1;
+			const std::uint64_t committed = ring.committed.load(std::memory_order_acquire);
+			const std::uint64_t first = std::max(ring.first.load(std::memory_order_relaxed), committed > capacity ? committed - capacity : 0);
+
+			std::vector<flight_event> events(static_cast<std::size_t>(committed - first));
+			for (std::uint64_t i = first; i < committed; ++i)
+			{
+				const detail::FlightRing::Slot& slot = ring.slots[i & ring.mask];
+				flight_event& event = events[static_cast<std::size_t>(i - first)];
+				event.timestamp = slot.timestamp.load(std::memory_order_relaxed);
+				event.type = static_cast<std::uint16_t>(slot.type.load(std::memory_order_relaxed));
+				event.reserved = {};
+				event.payload = { slot.payload[0].load(std::memory_order_relaxed), slot.payload[1].load(std::memory_order_relaxed) };
+			}
+
+			// Events whose slot has been claimed again meanwhile may be torn, drop them
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const std::uint64_t claimed = ring.claimed.load(std::memory_order_relaxed);
+			const std::uint64_t overwritten = claimed > capacity ? claimed - capacity : 0;
+			if (overwritten > first)
+			{
+				events.erase(events.begin(), events.begin() + static_cast<std::ptrdiff_t>(std::min(overwritten, committed) - first));
+			}
+			return events;
+		}
+
+		static void write_all(int fd, const void* data, std::size_t size)
+		{
+			const char* bytes = static_cast<const char*>(data);
+			while (size > 0)
+			{
+				const ssize_t written = ::write(fd, bytes, size);
+				if (written < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw std::system_error(errno, std::generic_category(), "write");
+				}
+				bytes += written;
+				size -= static_cast<std::size_t>(written);
+			}
+		}
+
+		std::shared_ptr<State> m_state;
+		const std::uint64_t m_start_ticks;
+		const std::uint64_t m_start_realtime_ns;
+	};
+}
+
+#endif
@@ -0,0 +1,658 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+#include "gravel/detail/thread_records.hpp"
+#include "gravel/mpsc_queue.hpp"
+
+namespace gravel
+{
+	template <typename T>
+	class future;
+
+	template <typename T>
+	class promise;
+
+	namespace detail
+	{
+		//!
+		//! The type a future<T> stores its value as, void is stored as std::monostate
+		//!
+		template <typename T>
+		using FutureValue = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+		//!
+		//! The shared state between a promise and a future, or between a future and whatever completes it such as a
+		//! continuation. Holds either a value or an exception once ready, and at most one continuation, which is
+		//! called directly by whoever makes the state ready.
+		//!
+		template <typename T>
+		class FutureState
+		{
+		public:
+			//! Called with the ready state and the context given together with it
+			using Continuation = void (*)(FutureState&, void*);
+
+			explicit FutureState(std::uint32_t references)
+				: m_references(references)
+			{
+			}
+
+			FutureState(const FutureState&) = delete;
+			virtual ~FutureState() = default;
+
+			template <typename... ArgT>
+			void set_value(ArgT&&... arguments)
+			{
+				m_value.emplace(std::forward<ArgT>(arguments)...);
+				complete();
+			}
+
+			void set_error(std::exception_ptr error)
+			{
+				m_error = std::move(error);
+				complete();
+			}
+
+			bool is_ready() const
+			{
+				return m_flags.load(std::memory_order_acquire) & ready;
+			}
+
+			void wait()
+			{
+				std::uint32_t flags = m_flags.load(std::memory_order_acquire);
+				if (flags & ready)
+				{
+					return;
+				}
+				flags = m_flags.fetch_or(waiting, std::memory_order_acq_rel) | waiting;
+				while (!(flags & ready))
+				{
+					m_flags.wait(flags, std::memory_order_acquire);
+					flags = m_flags.load(std::memory_order_acquire);
+				}
+			}
+
+			//!
+			//! Moves the value out of a ready state, or rethrows its exception
+			//!
+			FutureValue<T> take()
+			{
+				if (m_error)
+				{
+					std::rethrow_exception(m_error);
+				}
+				return std::move(*m_value);
+			}
+
+			//!
+			//! Sets the continuation, calling it immediately if the state is already ready. May only be called once.
+			//!
+			void continue_with(Continuation continuation, void* context)
+			{
+				m_continuation = continuation;
+				m_context = context;
+				if (m_flags.fetch_or(continued, std::memory_order_acq_rel) & ready)
+				{
+					continuation(*this, context);
+				}
+			}
+
+			void release()
+			{
+				if (m_references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					recycle();
+				}
+			}
+
+			const std::exception_ptr& error() const
+			{
+				return m_error;
+			}
+
+			FutureValue<T>& value()
+			{
+				return *m_value;
+			}
+
+		protected:
+			//!
+			//! Destroys the state and returns its memory, called when the last reference is released
+			//!
+			virtual void recycle() = 0;
+
+		private:
+			static const std::uint32_t ready = 1;
+			static const std::uint32_t continued = 2;
+			static const std::uint32_t waiting = 4;
+
+			void complete()
+			{
+				const std::uint32_t previous = m_flags.fetch_or(ready, std::memory_order_acq_rel);
+				if (previous & waiting)
+				{
+					m_flags.notify_all();
+				}
+				if (previous & continued)
+				{
+					m_continuation(*this, m_context);
+				}
+			}
+
+			std::atomic<std::uint32_t> m_references;
+			std::atomic<std::uint32_t> m_flags{ 0 };
+			std::optional<FutureValue<T>> m_value;
+			std::exception_ptr m_error;
+			Continuation m_continuation = nullptr;
+			void* m_context = nullptr;
+		};
+
+		//!
+		//! Places a shared state in a block from the node pool shared with mpsc_queue, one pool per state type, so that
+		//! once the pool has warmed up creating a state does not allocate
+		//!
+		template <typename StateT>
+		class PooledState final : public StateT
+		{
+			using Pool = MpscNodePool<PooledState>;
+			using Node = MpscNode<PooledState>;
+
+		public:
+			template <typename... ArgT>
+			static PooledState* create(ArgT&&... arguments)
+			{
+				const std::shared_ptr<Pool>& pool = Pool::instance();
+				Node* node = pool->allocate(ThreadRecordCache<Pool, typename Pool::Record>::record_for(pool));
+				return new (node->storage.data()) PooledState(node, std::forward<ArgT>(arguments)...);
+			}
+
+		private:
+			template <typename... ArgT>
+			explicit PooledState(Node* node, ArgT&&... arguments)
+				: StateT(std::forward<ArgT>(arguments)...)
+				, m_node(node)
+			{
+			}
+
+			void recycle() override
+			{
+				Node* node = m_node;
+				this->~PooledState();
+				Pool::instance()->recycle(node, node);
+			}
+
+			Node* m_node;
+		};
+
+		template <typename T, typename FuncT>
+		struct ThenResultOf : std::invoke_result<FuncT, T&&>
+		{
+		};
+
+		template <typename FuncT>
+		struct ThenResultOf<void, FuncT> : std::invoke_result<FuncT>
+		{
+		};
+
+		template <typename T, typename FuncT>
+		using ThenResult = typename ThenResultOf<T, FuncT>::type;
+
+		//!
+		//! The state of the future returned by then, holds the function to call with the value of the source state
+		//!
+		template <typename T, typename FuncT>
+		class ThenState : public FutureState<ThenResult<T, FuncT>>
+		{
+			using ResultT = ThenResult<T, FuncT>;
+
+		public:
+			explicit ThenState(FuncT&& function)
+				: FutureState<ResultT>(2)
+				, m_function(std::move(function))
+			{
+			}
+
+			static void fire(FutureState<T>& source, void* context)
+			{
+				ThenState& self = *static_cast<ThenState*>(context);
+				if (source.error())
+				{
+					self.set_error(source.error());
+				}
+				else
+				{
+					try
+					{
+						if constexpr (std::is_void_v<T> && std::is_void_v<ResultT>)
+						{
+							self.m_function();
+							self.set_value();
+						}
+						else if constexpr (std::is_void_v<T>)
+						{
+							self.set_value(self.m_function());
+						}
+						else if constexpr (std::is_void_v<ResultT>)
+						{
+							self.m_function(std::move(source.value()));
+							self.set_value();
+						}
+						else
+						{
+							self.set_value(self.m_function(std::move(source.value())));
+						}
+					}
+					catch (...)
+					{
+						self.set_error(std::current_exception());
+					}
+				}
+				source.release();
+				self.release();
+			}
+
+		private:
+			FuncT m_function;
+		};
+
+		template <typename... T>
+		class WhenAllState : public FutureState<std::tuple<FutureValue<T>...>>
+		{
+			template <std::size_t I>
+			using Input = std::tuple_element_t<I, std::tuple<T...>>;
+
+		public:
+			WhenAllState()
+				: FutureState<std::tuple<FutureValue<T>...>>(2)
+			{
+			}
+
+			template <std::size_t I>
+			static void fire(FutureState<Input<I>>& source, void* context)
+			{
+				WhenAllState& self = *static_cast<WhenAllState*>(context);
+				if (source.error())
+				{
+					self.m_errors[I] = source.error();
+				}
+				else
+				{
+					std::get<I>(self.m_values).emplace(std::move(source.value()));
+				}
+				source.release();
+				if (self.m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+				{
+					self.finish();
+				}
+			}
+
+			void finish()
+			{
+				for (const std::exception_ptr& error : m_errors)
+				{
+					if (error)
+					{
+						this->set_error(error);
+						this->release();
+						return;
+					}
+				}
+				std::apply([this](auto&... values) { this->set_value(std::move(*values)...); }, m_values);
+				this->release();
+			}
+
+		private:
+			std::tuple<std::optional<FutureValue<T>>...> m_values;
+			std::array<std::exception_ptr, sizeof...(T)> m_errors;
+			std::atomic<std::size_t> m_remaining{ sizeof...(T) };
+		};
+
+		template <typename... T>
+		class WhenAnyState : public FutureState<std::variant<FutureValue<T>...>>
+		{
+			template <std::size_t I>
+			using Input = std::tuple_element_t<I, std::tuple<T...>>;
+
+		public:
+			//! Referenced by the returned future and the continuation of every input, since all of them fire eventually
+			WhenAnyState()
+				: FutureState<std::variant<FutureValue<T>...>>(sizeof...(T) + 1)
+			{
+			}
+
+			template <std::size_t I>
+			static void fire(FutureState<Input<I>>& source, void* context)
+			{
+				WhenAnyState& self = *static_cast<WhenAnyState*>(context);
+				if (!self.m_decided.exchange(true, std::memory_order_acq_rel))
+				{
+					if (source.error())
+					{
+						self.set_error(source.error());
+					}
+					else
+					{
+						self.set_value(std::in_place_index<I>, std::move(source.value()));
+					}
+				}
+				source.release();
+				self.release();
+			}
+
+		private:
+			std::atomic<bool> m_decided{ false };
+		};
+
+		struct FutureAccess
+		{
+			template <typename T>
+			static FutureState<T>* release_state(future<T>& target)
+			{
+				return std::exchange(target.m_state, nullptr);
+			}
+
+			template <typename T>
+			static future<T> make_future(FutureState<T>* state)
+			{
+				return future<T>(state);
+			}
+		};
+	}
+
+	//!
+	//! The receiving end of a value or exception that is produced asynchronously by a promise, like std::future.
+	//!
+	//! The shared state lives in a block recycled through a pool, so once warmed up neither creating a promise and
+	//! future pair nor chaining continuations allocates, and completing one takes no lock. Continuations added with
+	//! then are called directly by the thread that completes the future, or immediately if it is already complete.
+	//!
+	//! NOTE: get, then and passing the future to when_all/when_any consume the future, leaving it invalid.
+	//!
+	//! @tparam T	the type of the value, may be void
+	//!
+	template <typename T>
+	class future
+	{
+	public:
+		//!
+		//! Constructor, creates an invalid future
+		//!
+		future() = default;
+
+		future(const future&) = delete;
+		future& operator=(const future&) = delete;
+
+		future(future&& other) noexcept
+			: m_state(std::exchange(other.m_state, nullptr))
+		{
+		}
+
+		future& operator=(future&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				m_state = std::exchange(other.m_state, nullptr);
+			}
+			return *this;
+		}
+
+		~future()
+		{
+			reset();
+		}
+
+		//!
+		//! Checks if the future refers to a shared state, that is if it has not been consumed
+		//!
+		bool valid() const
+		{
+			return m_state != nullptr;
+		}
+
+		//!
+		//! Checks if the value or exception is available, get will then not block
+		//!
+		bool is_ready() const
+		{
+			return m_state->is_ready();
+		}
+
+		//!
+		//! Blocks until the value or exception is available
+		//!
+		void wait() const
+		{
+			m_state->wait();
+		}
+
+		//!
+		//! Blocks until the value is available and moves it out, consuming the future
+		//! @return the value
+		//! @throw the exception set by the promise, or std::future_error if the promise was destroyed without a value
+		//!
+		T get()
+		{
+			m_state->wait();
+			struct Release
+			{
+				~Release()
+				{
+					state->release();
+				}
+
+				detail::FutureState<T>* state;
+			} release{ std::exchange(m_state, nullptr) };
+
+			if constexpr (std::is_void_v<T>)
+			{
+				release.state->take();
+			}
+			else
+			{
+				return release.state->take();
+			}
+		}
+
+		//!
+		//! Chains a function to run with the value once it is available, consuming the future. The function runs on
+		//! the thread completing this future, or immediately if it already is complete. If this future holds an
+		//! exception the function is skipped and the exception passed on.
+		//! @tparam FuncT	the type of the function, callable as R(T&&) or R() for future<void>, such as unique_function
+		//! @param function	the function to run
+		//! @return a future of the function's return value, or of the exception it threw
+		//!
+		template <typename FuncT>
+		future<detail::ThenResult<T, std::decay_t<FuncT>>> then(FuncT&& function)
+		{
+			using State = detail::ThenState<T, std::decay_t<FuncT>>;
+			State* next = detail::PooledState<State>::create(std::decay_t<FuncT>(std::forward<FuncT>(function)));
+			std::exchange(m_state, nullptr)->continue_with(&State::fire, next);
+			return detail::FutureAccess::make_future(static_cast<detail::FutureState<detail::ThenResult<T, std::decay_t<FuncT>>>*>(next));
+		}
+
+	private:
+		friend class promise<T>;
+		friend struct detail::FutureAccess;
+
+		explicit future(detail::FutureState<T>* state)
+			: m_state(state)
+		{
+		}
+
+		void reset()
+		{
+			if (m_state)
+			{
+				std::exchange(m_state, nullptr)->release();
+			}
+		}
+
+		detail::FutureState<T>* m_state = nullptr;
+	};
+
+	//!
+	//! The producing end of a future, like std::promise. Destroying a promise without setting a value or exception
+	//! sets an std::future_error with std::future_errc::broken_promise.
+	//!
+	//! @tparam T	the type of the value, may be void
+	//!
+	template <typename T>
+	class promise
+	{
+	public:
+		promise()
+			: m_state(detail::PooledState<detail::FutureState<T>>::create(2))
+		{
+		}
+
+		promise(const promise&) = delete;
+		promise& operator=(const promise&) = delete;
+
+		promise(promise&& other) noexcept
+			: m_state(std::exchange(other.m_state, nullptr))
+			, m_retrieved(other.m_retrieved)
+			, m_satisfied(other.m_satisfied)
+		{
+		}
+
+		promise& operator=(promise&& other) noexcept
+		{
+			if (this != &other)
+			{
+				abandon();
+				m_state = std::exchange(other.m_state, nullptr);
+				m_retrieved = other.m_retrieved;
+				m_satisfied = other.m_satisfied;
+			}
+			return *this;
+		}
+
+		~promise()
+		{
+			abandon();
+		}
+
+		//!
+		//! Gets the future of this promise, may only be called once
+		//!
+		future<T> get_future()
+		{
+			m_retrieved = true;
+			return future<T>(m_state);
+		}
+
+		//!
+		//! Makes the future ready with a value, running its continuation on this thread. May only be called once.
+		//! @param arguments	the arguments to construct the value from, none for promise<void>
+		//!
+		template <typename... ArgT>
+		void set_value(ArgT&&... arguments)
+		{
+			m_satisfied = true;
+			m_state->set_value(std::forward<ArgT>(arguments)...);
+		}
+
+		//!
+		//! Makes the future ready with an exception, running its continuation on this thread. May only be called once.
+		//! @param error	the exception that get rethrows
+		//!
+		void set_exception(std::exception_ptr error)
+		{
+			m_satisfied = true;
+			m_state->set_error(std::move(error));
+		}
+
+	private:
+		void abandon()
+		{
+			if (!m_state)
+			{
+				return;
+			}
+			if (!m_satisfied)
+			{
+				m_state->set_error(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+			}
+			if (!m_retrieved)
+			{
+				m_state->release();
+			}
+			std::exchange(m_state, nullptr)->release();
+		}
+
+		detail::FutureState<T>* m_state;
+		bool m_retrieved = false;
+		bool m_satisfied = false;
+	};
+
+	//!
+	//! Creates a future that already holds a value
+	//! @param arguments	the arguments to construct the value from, none for future<void>
+	//!
+	template <typename T, typename... ArgT>
+	future<T> make_ready_future(ArgT&&... arguments)
+	{
+		promise<T> source;
+		future<T> result = source.get_future();
+		source.set_value(std::forward<ArgT>(arguments)...);
+		return result;
+	}
+
+	//!
+	//! Combines futures into one that is ready when all of them are, consuming them. Uses a single pooled state and
+	//! no other allocations.
+	//! @param futures	the futures to wait for, must be valid
+	//! @return a future of a tuple of all values, with void values as std::monostate, or of the exception of the
+	//!			first future in argument order that holds one
+	//!
+	template <typename... T>
+	future<std::tuple<detail::FutureValue<T>...>> when_all(future<T>&&... futures)
+	{
+		using State = detail::WhenAllState<T...>;
+		State* combined = detail::PooledState<State>::create();
+		future<std::tuple<detail::FutureValue<T>...>> result = detail::FutureAccess::make_future(static_cast<detail::FutureState<std::tuple<detail::FutureValue<T>...>>*>(combined));
+		if constexpr (sizeof...(T) == 0)
+		{
+			combined->finish();
+		}
+		else
+		{
+			[&]<std::size_t... I>(std::index_sequence<I...>)
+			{
+				(detail::FutureAccess::release_state(futures)->continue_with(&State::template fire<I>, combined), ...);
+			}(std::index_sequence_for<T...>());
+		}
+		return result;
+	}
+
+	//!
+	//! Combines futures into one that is ready as soon as the first of them is, consuming them. The values of the
+	//! others are discarded once they arrive. Uses a single pooled state and no other allocations.
+	//! @param futures	the futures to wait for, at least one, must be valid
+	//! @return a future of a variant whose index is the first ready future's position, or of its exception
+	//!
+	template <typename... T>
+	future<std::variant<detail::FutureValue<T>...>> when_any(future<T>&&... futures) requires (sizeof...(T) > 0)
+	{
+		using State = detail::WhenAnyState<T...>;
+		State* combined = detail::PooledState<State>::create();
+		future<std::variant<detail::FutureValue<T>...>> result = detail::FutureAccess::make_future(static_cast<detail::FutureState<std::variant<detail::FutureValue<T>...>>*>(combined));
+		[&]<std::size_t... I>(std::index_sequence<I...>)
+		{
+			(detail::FutureAccess::release_state(futures)->continue_with(&State::template fire<I>, combined), ...);
+		}(std::index_sequence_for<T...>());
+		return result;
+	}
+}
@@ -0,0 +1,498 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gravel/dynamic_value.hpp"
+#include "gravel/detail/thread_records.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		struct HazardRetired
+		{
+			void* pointer;
+			void (*reclaim)(void*);
+		};
+
+		struct HazardChunk
+		{
+			static const std::size_t size = 8;
+
+			std::array<std::atomic<void*>, size> slots{};
+			std::atomic<HazardChunk*> next{ nullptr };
+		};
+
+		//!
+		//! Per-thread record of a hazard pointer domain, owning the thread's hazard slots and retire list. Only the
+		//! owning thread touches anything but the slots, which are read by every scanning thread.
+		//!
+		struct alignas(64) HazardRecord
+		{
+			HazardRecord() = default;
+			HazardRecord(const HazardRecord&) = delete;
+
+			~HazardRecord()
+			{
+				HazardChunk* chunk = slots.next.load(std::memory_order_acquire);
+				while (chunk)
+				{
+					HazardChunk* next = chunk->next.load(std::memory_order_relaxed);
+					delete chunk;
+					chunk = next;
+				}
+			}
+
+			std::atomic<bool> in_use{ true };
+			HazardChunk slots;
+			std::vector<std::atomic<void*>*> free_slots;
+			std::vector<HazardRetired> retired;
+			//! Mirrors retired.size() so that other threads can read it
+			std::atomic<std::size_t> pending{ 0 };
+			//! Scratch space for the hazards collected during a scan, kept to avoid allocating on every scan
+			std::vector<void*> hazards;
+			HazardRecord* next = nullptr;
+		};
+
+		class HazardState
+		{
+		public:
+			explicit HazardState(std::size_t batch_size)
+				: m_batch_size(batch_size)
+			{
+			}
+
+			HazardState(const HazardState&) = delete;
+
+			~HazardState()
+			{
+				reclaim_all();
+			}
+
+			HazardRecord& acquire_record()
+			{
+				HazardRecord& record = m_records.acquire([this]()
+				{
+					HazardRecord* created = new HazardRecord();
+					add_free_slots(*created, created->slots);
+					return created;
+				});
+				if (record.pending.load(std::memory_order_relaxed) > 0)
+				{
+					m_abandoned.fetch_sub(1, std::memory_order_relaxed);
+				}
+				return record;
+			}
+
+			void release_record(HazardRecord& record)
+			{
+				scan(record);
+				if (record.pending.load(std::memory_order_relaxed) > 0)
+				{
+					// Left for whichever thread adopts the record, or collects abandoned records, next
+					m_abandoned.fetch_add(1, std::memory_order_relaxed);
+				}
+				m_records.release(record);
+			}
+
+			std::atomic<void*>& acquire_slot(HazardRecord& record)
+			{
+				if (record.free_slots.empty())
+				{
+					HazardChunk* last = &record.slots;
+					while (HazardChunk* next = last->next.load(std::memory_order_relaxed))
+					{
+						last = next;
+					}
+					HazardChunk* created = new HazardChunk();
+					last->next.store(created, std::memory_order_release);
+					add_free_slots(record, *created);
+				}
+				std::atomic<void*>* slot = record.free_slots.back();
+				record.free_slots.pop_back();
+				return *slot;
+			}
+
+			static void release_slot(HazardRecord& record, std::atomic<void*>& slot)
+			{
+				slot.store(nullptr, std::memory_order_release);
+				record.free_slots.push_back(&slot);
+			}
+
+			void retire(HazardRecord& record, void* pointer, void (*reclaim)(void*))
+			{
+				record.retired.push_back(HazardRetired{ pointer, reclaim });
+				record.pending.store(record.retired.size(), std::memory_order_relaxed);
+
+				// Every scan leaves at most one object per hazard slot behind, so scanning once the list is twice the
+				// number of slots reclaims at least half of it, which amortizes the scan to O(1) per retired object
+				if (record.retired.size() >= std::max(m_batch_size, 2 * m_slot_count.load(std::memory_order_relaxed)))
+				{
+					scan(record);
+				}
+			}
+
+			//!
+			//! Reclaims everything retired in record that is not protected, as well as anything left behind by exited threads
+			//! @return the number of reclaimed objects
+			//!
+			std::size_t scan(HazardRecord& record)
+			{
+				if (m_abandoned.load(std::memory_order_relaxed) > 0)
+				{
+					adopt_abandoned(record);
+				}
+
+				// The hazards must be collected after adopting: a reader may have protected an adopted object after
+				// any earlier snapshot, up until the exited thread unlinked and retired it
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				collect_hazards(record.hazards);
+				return reclaim(record, record.hazards);
+			}
+
+			//!
+			//! Reclaims everything retired in this domain, regardless of protection. Only safe when no thread holds a hazard.
+			//!
+			void reclaim_all()
+			{
+				const std::vector<void*> none;
+				for (HazardRecord* record = m_records.head(); record; record = record->next)
+				{
+					reclaim(*record, none);
+				}
+			}
+
+			std::size_t pending() const
+			{
+				std::size_t total = 0;
+				for (HazardRecord* record = m_records.head(); record; record = record->next)
+				{
+					total += record->pending.load(std::memory_order_relaxed);
+				}
+				return total;
+			}
+
+		private:
+			void add_free_slots(HazardRecord& record, HazardChunk& chunk)
+			{
+				for (auto& slot : chunk.slots)
+				{
+					record.free_slots.push_back(&slot);
+				}
+				m_slot_count.fetch_add(HazardChunk::size, std::memory_order_relaxed);
+			}
+
+			//!
+			//! Moves the retire lists left behind by exited threads into record
+			//!
+			void adopt_abandoned(HazardRecord& record)
+			{
+				for (HazardRecord* other = m_records.head(); other; other = other->next)
+				{
+					if (m_records.try_adopt(*other))
+					{
+						if (other->pending.load(std::memory_order_relaxed) > 0)
+						{
+							record.retired.insert(record.retired.end(), other->retired.begin(), other->retired.end());
+							record.pending.store(record.retired.size(), std::memory_order_relaxed);
+							other->retired.clear();
+							other->pending.store(0, std::memory_order_relaxed);
+							m_abandoned.fetch_sub(1, std::memory_order_relaxed);
+						}
+						m_records.release(*other);
+					}
+				}
+			}
+
+			void collect_hazards(std::vector<void*>& hazards) const
+			{
+				hazards.clear();
+				for (HazardRecord* record = m_records.head(); record; record = record->next)
+				{
+					for (const HazardChunk* chunk = &record->slots; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+					{
+						for (const auto& slot : chunk->slots)
+						{
+							if (void* hazard = slot.load(std::memory_order_acquire))
+							{
+								hazards.push_back(hazard);
+							}
+						}
+					}
+				}
+				std::sort(hazards.begin(), hazards.end());
+			}
+
+			static std::size_t reclaim(HazardRecord& record, const std::vector<void*>& hazards)
+			{
+				// Reclaiming may retire further objects, so the list is detached while it is walked
+				std::vector<HazardRetired> retired;
+				retired.swap(record.retired);
+
+				std::size_t reclaimed = 0;
+				for (const HazardRetired& entry : retired)
+				{
+					if (std::binary_search(hazards.begin(), hazards.end(), entry.pointer))
+					{
+						record.retired.push_back(entry);
+					}
+					else
+					{
+						entry.reclaim(entry.pointer);
+						++reclaimed;
+					}
+				}
+
+				// Keep the allocated capacity around for the next batch
+				if (record.retired.empty())
+				{
+					retired.clear();
+					record.retired.swap(retired);
+				}
+				record.pending.store(record.retired.size(), std::memory_order_relaxed);
+				return reclaimed;
+			}
+
+			const std::size_t m_batch_size;
+			std::atomic<std::size_t> m_slot_count{ 0 };
+			RecordList<HazardRecord> m_records;
+			std::atomic<std::size_t> m_abandoned{ 0 };
+		};
+	}
+
+	namespace hazard_pointer
+	{
+		//!
+		//! Owns a hazard slot of a domain. While a pointer is protected by the guard, an object at that address
+		//! retired to the domain will not be reclaimed.
+		//!
+		//! NOTE: Guards must be destroyed on the thread that created them.
+		//!
+		class guard
+		{
+		public:
+			guard(const guard&) = delete;
+
+			guard(guard&& other) noexcept
+				: m_record(std::exchange(other.m_record, nullptr))
+				, m_slot(std::exchange(other.m_slot, nullptr))
+			{
+			}
+
+			guard& operator=(const guard&) = delete;
+
+			guard& operator=(guard&& other) noexcept
+			{
+				if (this != &other)
+				{
+					release();
+					m_record = std::exchange(other.m_record, nullptr);
+					m_slot = std::exchange(other.m_slot, nullptr);
+				}
+				return *this;
+			}
+
+			~guard()
+			{
+				release();
+			}
+
+			//!
+			//! Loads a pointer from source and protects it, retrying until the protected pointer is still the one held
+			//! by source, at which point it can safely be dereferenced.
+			//! @param source	the shared location to load the pointer from
+			//! @return the protected pointer, stays valid until the protection is reset or the guard destroyed
+			//!
+			template <typename T>
+			T* protect(const std::atomic<T*>& source)
+			{
+				T* pointer = source.load(std::memory_order_relaxed);
+				while (!try_protect(pointer, source))
+				{
+				}
+				return pointer;
+			}
+
+			//!
+			//! Attempts to protect pointer, which succeeds if source still holds it after the protection was published
+			//! @param pointer	the pointer to protect, on failure it is updated to the current value of source
+			//! @param source	the shared location pointer was loaded from
+			//! @return true if pointer is protected
+			//!
+			template <typename T>
+			bool try_protect(T*& pointer, const std::atomic<T*>& source)
+			{
+				T* expected = pointer;
+				m_slot->store(const_cast<std::remove_cv_t<T>*>(expected), std::memory_order_seq_cst);
+				pointer = source.load(std::memory_order_seq_cst);
+				if (pointer != expected)
+				{
+					m_slot->store(nullptr, std::memory_order_release);
+					return false;
+				}
+				return true;
+			}
+
+			//!
+			//! Protects a pointer that is known to be alive by other means, for example held by another guard
+			//! @param pointer	the pointer to protect
+			//!
+			template <typename T>
+			void reset_protection(T* pointer)
+			{
+				m_slot->store(const_cast<std::remove_cv_t<T>*>(pointer), std::memory_order_seq_cst);
+			}
+
+			//!
+			//! Stops protecting the currently protected pointer, if any
+			//!
+			void reset_protection()
+			{
+				m_slot->store(nullptr, std::memory_order_release);
+			}
+
+		private:
+			friend class domain;
+
+			guard(detail::HazardRecord& record, std::atomic<void*>& slot)
+				: m_record(&record)
+				, m_slot(&slot)
+			{
+			}
+
+			void release()
+			{
+				if (m_slot)
+				{
+					detail::HazardState::release_slot(*m_record, *m_slot);
+					m_record = nullptr;
+					m_slot = nullptr;
+				}
+			}
+
+			detail::HazardRecord* m_record;
+			std::atomic<void*>* m_slot;
+		};
+
+		//!
+		//! Hazard pointer reclamation domain. Readers protect the exact objects they access with guards, writers retire
+		//! objects after unlinking them, and retired objects are reclaimed as soon as no guard protects them.
+		//!
+		//! Unlike epoch based reclamation a stalled reader only keeps the objects it protects alive, so the number of
+		//! retired but unreclaimed objects is bounded by the number of hazard slots plus twice that per thread.
+		//! Retire lists are kept per thread and scanned once they reach twice the number of hazard slots in the
+		//! domain, so the cost of a scan is amortized over the objects it reclaims.
+		//!
+		//! NOTE: Destroying a domain reclaims everything retired in it, so no guard may protect anything at that time.
+		//!
+		class domain
+		{
+		public:
+			//!
+			//! Constructor
+			//! @param batch_size	the least number of objects a thread retires between scans
+			//!
+			explicit domain(std::size_t batch_size = 16)
+				: m_state(std::make_shared<detail::HazardState>(batch_size))
+			{
+			}
+
+			domain(const domain&) = delete;
+			domain& operator=(const domain&) = delete;
+
+			~domain()
+			{
+				m_state->reclaim_all();
+			}
+
+			//!
+			//! Acquires a hazard slot for the calling thread
+			//! @return a guard owning the slot, initially protecting nothing
+			//!
+			guard make_guard()
+			{
+				detail::HazardRecord& record = Records::record_for(m_state);
+				return guard(record, m_state->acquire_slot(record));
+			}
+
+			//!
+			//! Retires an object that has been unlinked from all shared structures, it will be deleted once no guard
+			//! protects it.
+			//! @tparam	T	the type of the object, it will be deleted as a T
+			//! @param object	the object to retire, must have been allocated with new
+			//!
+			template <typename T>
+			void retire(T* object)
+			{
+				retire(const_cast<std::remove_cv_t<T>*>(object), [](void* pointer) { delete static_cast<T*>(pointer); });
+			}
+
+			//!
+			//! Retires an object that has been unlinked from all shared structures
+			//! @param pointer	the object to retire
+			//! @param reclaim	called with pointer once no guard protects it
+			//!
+			void retire(void* pointer, void (*reclaim)(void*))
+			{
+				m_state->retire(Records::record_for(m_state), pointer, reclaim);
+			}
+
+			//!
+			//! Retires the value held by a dynamic value. Readers protect the address of values spilled to the heap,
+			//! which is retired as is without any allocation. Values in the small buffer cannot have been protected by
+			//! address, they are moved to the heap and reclaimed by the next scan.
+			//! @param value	the dynamic value to retire, must not be used afterwards without a new value being assigned to it
+			//!
+			template <typename BaseT, typename PropertiesT>
+			void retire(dynamic_value<BaseT, PropertiesT>&& value)
+			{
+				if (BaseT* released = detail::DynamicValueAccess::release_heap(value))
+				{
+					retire(released);
+				}
+				else
+				{
+					retire(new dynamic_value<BaseT, PropertiesT>(std::move(value)));
+				}
+			}
+
+			//!
+			//! Scans the hazard slots and reclaims everything the calling thread has retired that is not protected,
+			//! regardless of whether a full batch has been retired
+			//! @return the number of objects reclaimed
+			//!
+			std::size_t collect()
+			{
+				return m_state->scan(Records::record_for(m_state));
+			}
+
+			//!
+			//! The number of objects retired to this domain that have not yet been reclaimed, across all threads
+			//!
+			std::size_t pending() const
+			{
+				return m_state->pending();
+			}
+
+			//!
+			//! The process-wide default domain
+			//!
+			static domain& global()
+			{
+				static domain instance;
+				return instance;
+			}
+
+		private:
+			using Records = detail::ThreadRecordCache<detail::HazardState, detail::HazardRecord>;
+
+			std::shared_ptr<detail::HazardState> m_state;
+		};
+	}
+}
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		//!
+		//! Either the producer of a lazy value or the value itself, sharing their storage. The owner tracks which one
+		//! is alive and destroys it.
+		//!
+		template <typename T>
+		class LazyStorage
+		{
+		public:
+			using Producer = unique_function<T()>;
+
+			static_assert(std::is_nothrow_move_constructible_v<T>, "the value replaces its producer by a move, which must not throw");
+
+			explicit LazyStorage(Producer&& producer)
+				: m_producer(std::move(producer))
+			{
+			}
+
+			//!
+			//! Moves the value of other if it is ready, its producer otherwise
+			//!
+			LazyStorage(LazyStorage&& other, bool ready)
+			{
+				if (ready)
+				{
+					new (&m_value) T(std::move(other.m_value));
+				}
+				else
+				{
+					new (&m_producer) Producer(std::move(other.m_producer));
+				}
+			}
+
+			LazyStorage(const LazyStorage&) = delete;
+
+			~LazyStorage()
+			{
+			}
+
+			//!
+			//! Runs the producer and replaces it with its result. If the producer throws, it stays in place.
+			//!
+			void compute()
+			{
+				T value = m_producer();
+				m_producer.~Producer();
+				new (&m_value) T(std::move(value));
+			}
+
+			void destroy(bool ready)
+			{
+				if (ready)
+				{
+					m_value.~T();
+				}
+				else
+				{
+					m_producer.~Producer();
+				}
+			}
+
+			Producer& producer()
+			{
+				return m_producer;
+			}
+
+			T& value()
+			{
+				return m_value;
+			}
+
+		private:
+			union
+			{
+				Producer m_producer;
+				T m_value;
+			};
+		};
+	}
+
+	//!
+	//! A value computed on first access, for expensive derived values that are rarely read. Holds the producer, a
+	//! unique_function<T()>, until then and replaces it in place with the value it returns: both share the same
+	//! storage, so a lazy is the larger of the two plus a flag.
+	//!
+	//! NOTE: Not thread safe, see atomic_lazy. If the producer throws, the exception propagates out of get and the
+	//! next get calls the producer again.
+	//!
+	//! @tparam T	the type of the value, must be nothrow move constructible
+	//!
+	template <typename T>
+	class lazy
+	{
+	public:
+		using Producer = unique_function<T()>;
+
+		explicit lazy(Producer&& producer)
+			: m_storage(std::move(producer))
+		{
+		}
+
+		//!
+		//! Constructor
+		//! @tparam FuncT	the type of the producer, callable as T()
+		//! @param producer	computes the value on first access
+		//!
+		template <typename FuncT>
+		explicit lazy(FuncT&& producer) requires (!std::is_same_v<std::decay_t<FuncT>, Producer> && !std::is_same_v<std::decay_t<FuncT>, lazy>)
+			: m_storage(Producer(std::decay_t<FuncT>(std::forward<FuncT>(producer))))
+		{
+		}
+
+		lazy(const lazy&) = delete;
+		lazy& operator=(const lazy&) = delete;
+
+		//!
+		//! Move constructor, moves the value if it was computed and the producer otherwise
+		//!
+		lazy(lazy&& other)
+			: m_storage(std::move(other.m_storage), other.m_ready)
+			, m_ready(other.m_ready)
+		{
+		}
+
+		~lazy()
+		{
+			m_storage.destroy(m_ready);
+		}
+
+		//!
+		//! The value, computed by the producer if this is the first access
+		//!
+		T& get()
+		{
+			return value();
+		}
+
+		const T& get() const
+		{
+			return value();
+		}
+
+		T& operator*()
+		{
+			return get();
+		}
+
+		const T& operator*() const
+		{
+			return get();
+		}
+
+		T* operator->()
+		{
+			return &get();
+		}
+
+		const T* operator->() const
+		{
+			return &get();
+		}
+
+		bool is_ready() const
+		{
+			return m_ready;
+		}
+
+	private:
+		//!
+		//! Computing the value is not an observable change, so it may happen through a const lazy
+		//!
+		T& value() const
+		{
+			if (!m_ready)
+			{
+				m_storage.compute();
+				m_ready = true;
+			}
+			return m_storage.value();
+		}
+
+		mutable detail::LazyStorage<T> m_storage;
+		mutable bool m_ready = false;
+	};
+
+	//!
+	//! A lazy whose value may be accessed from several threads. The first access runs the producer while the others
+	//! wait for it; once the value is there, an access is a single acquire load.
+	//!
+	//! NOTE: Only the computation is synchronized, the value itself is shared like any other object. If the producer
+	//! throws, the exception propagates out of get on the thread that ran it and the producer runs again on the
+	//! next access.
+	//!
+	//! @tparam T	the type of the value, must be nothrow move constructible
+	//!
+	template <typename T>
+	class atomic_lazy
+	{
+	public:
+		using Producer = unique_function<T()>;
+
+		explicit atomic_lazy(Producer&& producer)
+			: m_storage(std::move(producer))
+		{
+		}
+
+		//!
+		//! Constructor
+		//! @tparam FuncT	the type of the producer, callable as T()
+		//! @param producer	computes the value on first access
+		//!
+		template <typename FuncT>
+		explicit atomic_lazy(FuncT&& producer) requires (!std::is_same_v<std::decay_t<FuncT>, Producer> && !std::is_same_v<std::decay_t<FuncT>, atomic_lazy>)
+			: m_storage(Producer(std::decay_t<FuncT>(std::forward<FuncT>(producer))))
+		{
+		}
+
+		atomic_lazy(const atomic_lazy&) = delete;
+		atomic_lazy& operator=(const atomic_lazy&) = delete;
+
+		~atomic_lazy()
+		{
+			m_storage.destroy(m_state.load(std::memory_order_acquire) & ready);
+		}
+
+		//!
+		//! The value, computed by the producer if this is the first access
+		//!
+		T& get()
+		{
+			return value();
+		}
+
+		const T& get() const
+		{
+			return value();
+		}
+
+		T& operator*()
+		{
+			return get();
+		}
+
+		const T& operator*() const
+		{
+			return get();
+		}
+
+		T* operator->()
+		{
+			return &get();
+		}
+
+		const T* operator->() const
+		{
+			return &get();
+		}
+
+		bool is_ready() const
+		{
+			return m_state.load(std::memory_order_acquire) & ready;
+		}
+
+	private:
+		static const std::uint32_t pending = 0;
+		static const std::uint32_t running = 1;
+		static const std::uint32_t waiting = 2;
+		static const std::uint32_t ready = 4;
+
+		T& value() const
+		{
+			if (m_state.load(std::memory_order_acquire) & ready)
+			{
+				return m_storage.value();
+			}
+			return compute();
+		}
+
+		T& compute() const
+		{
+			std::uint32_t state = m_state.load(std::memory_order_acquire);
+			while (!(state & ready))
+			{
+				if (!(state & running))
+				{
+					// Keeps the waiting flag, which may be left from a producer that threw
+					if (m_state.compare_exchange_weak(state, state | running, std::memory_order_acquire))
+					{
+						run_producer();
+						break;
+					}
+				}
+				else
+				{
+					state = m_state.fetch_or(waiting, std::memory_order_acq_rel) | waiting;
+					if (state & running)
+					{
+						m_state.wait(state, std::memory_order_acquire);
+						state = m_state.load(std::memory_order_acquire);
+					}
+				}
+			}
+			return m_storage.value();
+		}
+
+		void run_producer() const
+		{
+			try
+			{
+				m_storage.compute();
+			}
+			catch (...)
+			{
+				// Let a waiting thread try again
+				if (m_state.exchange(pending, std::memory_order_release) & waiting)
+				{
+					m_state.notify_all();
+				}
+				throw;
+			}
+			if (m_state.exchange(ready, std::memory_order_acq_rel) & waiting)
+			{
+				m_state.notify_all();
+			}
+		}
+
+		mutable detail::LazyStorage<T> m_storage;
+		mutable std::atomic<std::uint32_t> m_state{ pending };
+	};
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace gravel
+{
+
+	//!
+	//! Bounded lock-free multi-producer multi-consumer queue, intended as the shared task queue of a pool of workers
+	//! handing each other unique_function<void()>.
+	//!
+	//! Every slot holds its element inline next to a sequence number that tells producers and consumers which lap
+	//! of the ring the slot is ready for, so the try operations only contend on a single index and the slot they
+	//! claimed. The ring is allocated once at construction.
+	//!
+	//! The blocking push and pop take a ticket for a position and wait for its slot with std::atomic::wait, so
+	//! blocked threads sleep without spinning and are served in ticket order. Threads that do not block never make a
+	//! system call unless another thread is waiting.
+	//!
+	//! @tparam T	the element type, must be move constructible
+	//!
+	template <typename T>
+	class mpmc_queue
+	{
+		struct Slot
+		{
+			T* value()
+			{
+				return reinterpret_cast<T*>(storage.data());
+			}
+
+			//! Equals the position a producer may fill the slot at, or the position plus one once it has been filled
+			std::atomic<std::size_t> sequence;
+			alignas(T) std::array<std::uint8_t, sizeof(T)> storage;
+		};
+
+	public:
+		//!
+		//! Constructor
+		//! @param capacity	the smallest number of elements the queue must be able to hold, rounded up to a power of two
+		//!					of at least two, since a single slot could not tell a filled slot from one ready for the next lap
+		//!
+		explicit mpmc_queue(std::size_t capacity)
+			: m_mask(std::bit_ceil(std::max<std::size_t>(capacity, 2)) - 1)
+			, m_slots(new Slot[m_mask + 1])
+		{
+			for (std::size_t i = 0; i <= m_mask; ++i)
+			{
+				m_slots[i].sequence.store(i, std::memory_order_relaxed);
+			}
+		}
+
+		mpmc_queue(const mpmc_queue&) = delete;
+		mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+		//!
+		//! Destructor, destroys any elements still in the queue. No other thread may be using the queue at this point.
+		//!
+		~mpmc_queue()
+		{
+			while (try_pop())
+			{
+			}
+		}
+
+		//!
+		//! Constructs an element at the back of the queue if there is room, may be called from any thread
+		//! @tparam ArgT	the argument types to pass to T's constructor
+		//! @param	args	the arguments to perfectly forward to T's constructor
+		//! @return false if the queue was full, in which case nothing was constructed
+		//!
+		template <typename... ArgT>
+		bool try_emplace(ArgT&&... arguments)
+		{
+			std::size_t position = m_tail.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Slot& slot = m_slots[position & m_mask];
+				const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+				const auto lap = static_cast<std::ptrdiff_t>(sequence - position);
+				if (lap == 0)
+				{
+					if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						fill(slot, position, std::forward<ArgT>(arguments)...);
+						return true;
+					}
+				}
+				else if (lap < 0)
+				{
+					// The slot still holds the element from the previous lap
+					return false;
+				}
+				else
+				{
+					position = m_tail.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		//!
+		//! Moves an element to the back of the queue if there is room, may be called from any thread
+		//! @param value	the element to push, left untouched if the queue was full
+		//! @return false if the queue was full
+		//!
+		bool try_push(T&& value)
+		{
+			return try_emplace(std::move(value));
+		}
+
+		//!
+		//! Pops the front element if there is one, may be called from any thread
+		//! @return the popped element, or nothing if the queue was empty
+		//!
+		std::optional<T> try_pop()
+		{
+			std::size_t position = m_head.load(std::memory_order_relaxed);
+			for (;;)
+			{
+				Slot& slot = m_slots[position & m_mask];
+				const std::size_t sequence = slot.sequence.load(std::memory_order_acquire);
+				const auto lap = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+				if (lap == 0)
+				{
+					if (m_head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					{
+						return empty_slot(slot, position);
+					}
+				}
+				else if (lap < 0)
+				{
+					// The slot has not been filled for this lap yet
+					return std::nullopt;
+				}
+				else
+				{
+					position = m_head.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		//!
+		//! Constructs an element at the back of the queue, waiting for room if it is full
+		//! @tparam ArgT	the argument types to pass to T's constructor
+		//! @param	args	the arguments to perfectly forward to T's constructor
+		//!
+		template <typename... ArgT>
+		void emplace(ArgT&&... arguments)
+		{
+			const std::size_t position = m_tail.fetch_add(1, std::memory_order_relaxed);
+			Slot& slot = m_slots[position & m_mask];
+			wait_for(slot, position);
+			fill(slot, position, std::forward<ArgT>(arguments)...);
+		}
+
+		//!
+		//! Moves an element to the back of the queue, waiting for room if it is full
+		//! @param value	the element to push
+		//!
+		void push(T&& value)
+		{
+			emplace(std::move(value));
+		}
+
+		//!
+		//! Pops the front element, waiting for one if the queue is empty
+		//! @return the popped element
+		//!
+		T pop()
+		{
+			const std::size_t position = m_head.fetch_add(1, std::memory_order_relaxed);
+			Slot& slot = m_slots[position & m_mask];
+			wait_for(slot, position + 1);
+			return empty_slot(slot, position);
+		}
+
+		//!
+		//! The number of elements in the queue at some point during the call, negative if threads are blocked in pop
+		//!
+		std::ptrdiff_t size() const
+		{
+			return static_cast<std::ptrdiff_t>(m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_relaxed));
+		}
+
+		std::size_t capacity() const
+		{
+			return m_mask + 1;
+		}
+
+	private:
+		template <typename... ArgT>
+		void fill(Slot& slot, std::size_t position, ArgT&&... arguments)
+		{
+			new (slot.value()) T(std::forward<ArgT>(arguments)...);
+			publish(slot, position + 1);
+		}
+
+		T empty_slot(Slot& slot, std::size_t position)
+		{
+			T* value = std::launder(slot.value());
+			T result(std::move(*value));
+			value->~T();
+			// Ready for the producer of the next lap
+			publish(slot, position + m_mask + 1);
+			return result;
+		}
+
+		void publish(Slot& slot, std::size_t sequence)
+		{
+			// seq_cst orders the store before reading m_waiting, pairing with the increment in wait_for, so that a
+			// thread that goes to sleep either sees the new sequence or is seen here
+			slot.sequence.store(sequence, std::memory_order_seq_cst);
+			if (m_waiting.load(std::memory_order_seq_cst) > 0)
+			{
+				slot.sequence.notify_all();
+			}
+		}
+
+		void wait_for(Slot& slot, std::size_t sequence)
+		{
+			std::size_t current = slot.sequence.load(std::memory_order_acquire);
+			for (int spin = 0; current != sequence && spin < 64; ++spin)
+			{
+				current = slot.sequence.load(std::memory_order_acquire);
+			}
+			if (current == sequence)
+			{
+				return;
+			}
+
+			m_waiting.fetch_add(1, std::memory_order_seq_cst);
+			while ((current = slot.sequence.load(std::memory_order_seq_cst)) != sequence)
+			{
+				slot.sequence.wait(current, std::memory_order_acquire);
+			}
+			m_waiting.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		alignas(64) const std::size_t m_mask;
+		const std::unique_ptr<Slot[]> m_slots;
+		alignas(64) std::atomic<std::size_t> m_tail{ 0 };
+		alignas(64) std::atomic<std::size_t> m_head{ 0 };
+		//! The number of threads sleeping in a blocking push or pop
+		alignas(64) std::atomic<std::size_t> m_waiting{ 0 };
+	};
+}
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "gravel/detail/thread_records.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		template <typename T>
+		struct MpscNode
+		{
+			T& value()
+			{
+				return *std::launder(reinterpret_cast<T*>(storage.data()));
+			}
+
+			std::atomic<MpscNode*> next{ nullptr };
+			alignas(T) std::array<std::uint8_t, sizeof(T)> storage;
+		};
+
+		template <typename T>
+		struct alignas(64) MpscProducerRecord
+		{
+			std::atomic<bool> in_use{ true };
+			//! Free nodes owned by this producer, linked through their next pointers
+			MpscNode<T>* cache = nullptr;
+			MpscProducerRecord* next = nullptr;
+		};
+
+		//!
+		//! Recycles the nodes of all mpsc_queues of the same element type. Consumers push consumed nodes onto a shared
+		//! free stack, and producers take the whole stack at once into a thread-local cache whenever theirs runs dry.
+		//! Since producers never pop single nodes off the shared stack it is not subject to ABA.
+		//!
+		//! The pool is shared between queues so that each thread only keeps one cache per element type, no matter how
+		//! many queues it pushes to.
+		//!
+		template <typename T>
+		class MpscNodePool
+		{
+		public:
+			using Node = MpscNode<T>;
+			using Record = MpscProducerRecord<T>;
+
+			MpscNodePool() = default;
+			MpscNodePool(const MpscNodePool&) = delete;
+
+			~MpscNodePool()
+			{
+				free_chain(m_free.exchange(nullptr, std::memory_order_acquire));
+				for (Record* record = m_records.head(); record; record = record->next)
+				{
+					free_chain(std::exchange(record->cache, nullptr));
+				}
+			}
+
+			static const std::shared_ptr<MpscNodePool>& instance()
+			{
+				static const std::shared_ptr<MpscNodePool> pool = std::make_shared<MpscNodePool>();
+				return pool;
+			}
+
+			Record& acquire_record()
+			{
+				return m_records.acquire([]() { return new Record(); });
+			}
+
+			void release_record(Record& record)
+			{
+				m_records.release(record);
+			}
+
+			Node* allocate(Record& record)
+			{
+				if (!record.cache)
+				{
+					record.cache = m_free.exchange(nullptr, std::memory_order_acquire);
+					if (!record.cache)
+					{
+						return new Node();
+					}
+				}
+				Node* node = record.cache;
+				record.cache = node->next.load(std::memory_order_relaxed);
+				return node;
+			}
+
+			//!
+			//! Gives a node taken by allocate back to the cache of the producer, for when it could not be used
+			//!
+			void deallocate(Record& record, Node* node)
+			{
+				node->next.store(record.cache, std::memory_order_relaxed);
+				record.cache = node;
+			}
+
+			//!
+			//! Returns a chain of nodes, linked from first to last through their next pointers, to the pool
+			//!
+			void recycle(Node* first, Node* last)
+			{
+				Node* head = m_free.load(std::memory_order_relaxed);
+				do
+				{
+					last->next.store(head, std::memory_order_relaxed);
+				} while (!m_free.compare_exchange_weak(head, first, std::memory_order_release, std::memory_order_relaxed));
+			}
+
+		private:
+			static void free_chain(Node* node)
+			{
+				while (node)
+				{
+					delete std::exchange(node, node->next.load(std::memory_order_relaxed));
+				}
+			}
+
+			alignas(64) std::atomic<Node*> m_free{ nullptr };
+			RecordList<Record> m_records;
+		};
+	}
+
+	//!
+	//! Unbounded lock-free multi-producer single-consumer queue, intended to hand work such as unique_function<void()>
+	//! to an event loop from other threads.
+	//!
+	//! Every element is stored inline in a queue node, so emplacing a unique_function constructs it directly in its
+	//! node without boxing it. Nodes are recycled through a pool shared by all queues of the same element type, once
+	//! it has grown to the largest number of elements in flight neither pushing nor popping allocates. The consumer
+	//! drains elements in batches and returns the consumed nodes to the producers once per batch.
+	//!
+	//! NOTE: Pushing is wait-free, a single atomic exchange. An element whose producer was preempted between that
+	//! exchange and linking the node becomes visible to the consumer once the producer resumes, elements pushed
+	//! after it by other producers are not visible until then either.
+	//!
+	//! @tparam T	the element type, must be move constructible
+	//!
+	template <typename T>
+	class mpsc_queue
+	{
+		using Pool = detail::MpscNodePool<T>;
+		using Node = detail::MpscNode<T>;
+
+	public:
+		mpsc_queue()
+			: m_pool(Pool::instance())
+		{
+			// The queue always holds a node without a value, which the consumer's head points to
+			Node* stub = m_pool->allocate(Records::record_for(m_pool));
+			stub->next.store(nullptr, std::memory_order_relaxed);
+			m_head = stub;
+			m_tail.store(stub, std::memory_order_relaxed);
+		}
+
+		mpsc_queue(const mpsc_queue&) = delete;
+		mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+		//!
+		//! Destructor, destroys any elements still in the queue. No producer may be active at this point.
+		//!
+		~mpsc_queue()
+		{
+			consume([](T&&) {});
+			m_head->next.store(nullptr, std::memory_order_relaxed);
+			m_pool->recycle(m_head, m_head);
+		}
+
+		//!
+		//! Constructs an element at the back of the queue, may be called from any thread. If T's constructor throws,
+		//! nothing is pushed and the node taken for it goes back to the pool.
+		//! @tparam ArgT	the argument types to pass to T's constructor
+		//! @param	args	the arguments to perfectly forward to T's constructor
+		//!
+		template <typename... ArgT>
+		void emplace(ArgT&&... arguments)
+		{
+			typename Pool::Record& record = Records::record_for(m_pool);
+			Node* node = m_pool->allocate(record);
+			try
+			{
+				new (node->storage.data()) T(std::forward<ArgT>(arguments)...);
+			}
+			catch (...)
+			{
+				m_pool->deallocate(record, node);
+				throw;
+			}
+			node->next.store(nullptr, std::memory_order_relaxed);
+
+			Node* previous = m_tail.exchange(node, std::memory_order_acq_rel);
+			previous->next.store(node, std::memory_order_release);
+		}
+
+		//!
+		//! Moves an element to the back of the queue, may be called from any thread
+		//! @param value	the element to push
+		//!
+		void push(T&& value)
+		{
+			emplace(std::move(value));
+		}
+
+		//!
+		//! Pops the front element, may only be called from the consumer
+		//! @return the popped element, or nothing if the queue was empty
+		//!
+		std::optional<T> try_pop()
+		{
+			std::optional<T> result;
+			consume([&result](T&& value) { result.emplace(std::move(value)); }, 1);
+			return result;
+		}
+
+		//!
+		//! Passes up to max_count elements from the front of the queue to function, in order, may only be called from
+		//! the consumer. Consumed nodes are recycled once the whole batch has been processed.
+		//! If function throws, the element it was called with is still destroyed and counts as consumed, the nodes
+		//! consumed so far are recycled and the exception propagates.
+		//! @param function	called with T&& for each consumed element, the element is destroyed after the call
+		//! @param max_count	the largest number of elements to consume
+		//! @return the number of consumed elements
+		//!
+		template <typename FuncT>
+		std::size_t consume(FuncT&& function, std::size_t max_count = SIZE_MAX)
+		{
+			struct Batch
+			{
+				Pool& pool;
+				Node* const first;
+				Node* last = nullptr;
+
+				~Batch()
+				{
+					if (last)
+					{
+						pool.recycle(first, last);
+					}
+				}
+			} batch{ *m_pool, m_head };
+
+			struct Destroy
+			{
+				T& value;
+
+				~Destroy()
+				{
+					value.~T();
+				}
+			};
+
+			std::size_t count = 0;
+			while (count < max_count)
+			{
+				Node* next = m_head->next.load(std::memory_order_acquire);
+				if (!next)
+				{
+					break;
+				}
+
+				// next becomes the new valueless head before its value is handed out, so that it is never handed out twice
+				batch.last = m_head;
+				m_head = next;
+				++count;
+
+				Destroy destroy{ next->value() };
+				function(std::move(destroy.value));
+			}
+			return count;
+		}
+
+		//!
+		//! Checks if there is an element to consume, may only be called from the consumer
+		//!
+		bool empty() const
+		{
+			return m_head->next.load(std::memory_order_acquire) == nullptr;
+		}
+
+	private:
+		using Records = detail::ThreadRecordCache<Pool, typename Pool::Record>;
+
+		alignas(64) std::atomic<Node*> m_tail;
+		alignas(64) Node* m_head;
+		std::shared_ptr<Pool> m_pool;
+	};
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+#include "gravel/thread_pool.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		//!
+		//! The automatic grain size, gives every worker about eight chunks so that stealing can even out chunks that
+		//! take longer than others, without splitting finer than min_grain
+		//!
+		inline std::size_t auto_grain(const thread_pool& pool, std::size_t size, std::size_t min_grain)
+		{
+			return std::max<std::size_t>({ 1, min_grain, size / (pool.size() * 8) });
+		}
+
+		//!
+		//! Runs first on a task of the pool and second on the calling thread, and returns once both are done. The task
+		//! only captures a pointer to a frame on the caller's stack, so it fits inline in a unique_function and forking
+		//! never allocates.
+		//!
+		//! Exceptions from either half are caught so that the frame outlives the task and no exception escapes into
+		//! the pool, and rethrown once both are done. If both throw the one from second is rethrown.
+		//!
+		template <typename FirstT, typename SecondT>
+		void fork_join(thread_pool& pool, FirstT&& first, SecondT&& second)
+		{
+			struct Frame
+			{
+				std::remove_reference_t<FirstT>* function;
+				std::exception_ptr error{ nullptr };
+				std::atomic<bool> done{ false };
+			} frame{ &first };
+
+			pool.submit([&frame]()
+			{
+				try
+				{
+					(*frame.function)();
+				}
+				catch (...)
+				{
+					frame.error = std::current_exception();
+				}
+				frame.done.store(true, std::memory_order_release);
+			});
+			std::exception_ptr error;
+			try
+			{
+				second();
+			}
+			catch (...)
+			{
+				error = std::current_exception();
+			}
+			pool.run_until([&frame]() { return frame.done.load(std::memory_order_acquire); });
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+			if (frame.error)
+			{
+				std::rethrow_exception(frame.error);
+			}
+		}
+
+		//!
+		//! Splits [begin, end) in halves until they are at most grain long, and calls body(begin, end) for each part
+		//!
+		template <typename BodyT>
+		void split_range(thread_pool& pool, std::size_t begin, std::size_t end, std::size_t grain, BodyT& body)
+		{
+			if (end - begin <= grain)
+			{
+				body(begin, end);
+				return;
+			}
+			const std::size_t middle = begin + (end - begin) / 2;
+			fork_join(pool,
+				[&pool, middle, end, grain, &body]() { split_range(pool, middle, end, grain, body); },
+				[&pool, begin, middle, grain, &body]() { split_range(pool, begin, middle, grain, body); });
+		}
+
+		template <typename IteratorT, typename T, typename OperationT, typename TransformT>
+		T reduce_range(thread_pool& pool, IteratorT first, std::size_t size, std::size_t grain, OperationT& operation, TransformT& transform)
+		{
+			if (size <= grain)
+			{
+				T result = transform(*first);
+				for (std::size_t i = 1; i < size; ++i)
+				{
+					result = operation(std::move(result), transform(first[i]));
+				}
+				return result;
+			}
+			const std::size_t half = size / 2;
+			std::optional<T> right;
+			std::optional<T> left;
+			fork_join(pool,
+				[&]() { right.emplace(reduce_range<IteratorT, T>(pool, first + half, size - half, grain, operation, transform)); },
+				[&]() { left.emplace(reduce_range<IteratorT, T>(pool, first, half, grain, operation, transform)); });
+			return operation(std::move(*left), std::move(*right));
+		}
+
+		//!
+		//! Quicksorts [first, last) in parallel. Like introsort, once depth partitions deep the range is left to
+		//! std::sort, so that inputs defeating the median of three cannot make the sort quadratic.
+		//!
+		template <typename IteratorT, typename CompareT>
+		void sort_range(thread_pool& pool, IteratorT first, IteratorT last, std::size_t grain, std::size_t depth, CompareT& compare)
+		{
+			const std::size_t size = static_cast<std::size_t>(last - first);
+			if (size <= grain || depth == 0)
+			{
+				std::sort(first, last, compare);
+				return;
+			}
+
+			// Median of three as pivot, parked at the back while partitioning so that it is never moved meanwhile
+			IteratorT middle = first + size / 2;
+			IteratorT back = last - 1;
+			if (compare(*middle, *first))
+			{
+				std::iter_swap(middle, first);
+			}
+			if (compare(*back, *middle))
+			{
+				std::iter_swap(back, middle);
+				if (compare(*middle, *first))
+				{
+					std::iter_swap(middle, first);
+				}
+			}
+			std::iter_swap(middle, back);
+
+			IteratorT pivot = std::partition(first, back, [&](const auto& value) { return compare(value, *back); });
+			std::iter_swap(pivot, back);
+			// Keep elements equal to the pivot out of both halves, so that many equal elements cannot degrade the split
+			IteratorT equal_end = std::partition(pivot + 1, last, [&](const auto& value) { return !compare(*pivot, value); });
+
+			fork_join(pool,
+				[&pool, equal_end, last, grain, depth, &compare]() { sort_range(pool, equal_end, last, grain, depth - 1, compare); },
+				[&pool, first, pivot, grain, depth, &compare]() { sort_range(pool, first, pivot, grain, depth - 1, compare); });
+		}
+	}
+
+	//!
+	//! Calls function(i) for every index in [begin, end) on the pool, returns once all calls have returned.
+	//! If function throws, the chunks already started still finish, the remaining indices of the throwing chunk and
+	//! of some other chunks are skipped, and one of the exceptions is rethrown.
+	//! @param pool	the pool to run on, may be called both from its workers and other threads
+	//! @param begin	the first index
+	//! @param end	one past the last index
+	//! @param function	callable as void(IndexT), called concurrently from several threads
+	//! @param min_grain	the smallest number of indices to run as one chunk, 0 for automatic
+	//!
+	template <std::integral IndexT, typename FuncT>
+	void parallel_for(thread_pool& pool, IndexT begin, IndexT end, FuncT&& function, std::size_t min_grain = 0)
+	{
+		if (end <= begin)
+		{
+			return;
+		}
+		const std::size_t size = static_cast<std::size_t>(end - begin);
+		auto body = [begin, &function](std::size_t chunk_begin, std::size_t chunk_end)
+		{
+			for (std::size_t i = chunk_begin; i < chunk_end; ++i)
+			{
+				function(static_cast<IndexT>(begin + static_cast<IndexT>(i)));
+			}
+		};
+		detail::split_range(pool, 0, size, detail::auto_grain(pool, size, min_grain), body);
+	}
+
+	//!
+	//! Calls function(element) for every element in [first, last) on the pool, returns once all calls have returned.
+	//! If function throws, some elements may be skipped, and one of the exceptions is rethrown once all running calls
+	//! have returned.
+	//! @param function	callable with a reference to an element, called concurrently from several threads
+	//! @param min_grain	the smallest number of elements to run as one chunk, 0 for automatic
+	//!
+	template <std::random_access_iterator IteratorT, typename FuncT>
+	void parallel_for(thread_pool& pool, IteratorT first, IteratorT last, FuncT&& function, std::size_t min_grain = 0)
+	{
+		const std::size_t size = static_cast<std::size_t>(last - first);
+		auto body = [first, &function](std::size_t chunk_begin, std::size_t chunk_end)
+		{
+			std::for_each(first + chunk_begin, first + chunk_end, std::ref(function));
+		};
+		detail::split_range(pool, 0, size, detail::auto_grain(pool, size, min_grain), body);
+	}
+
+	//!
+	//! Writes function(element) for every element in [first, last) to the corresponding element of output.
+	//! If function throws, some elements may be left unwritten, and one of the exceptions is rethrown once all running
+	//! calls have returned.
+	//! @param output	the first element to write to, may be the same as first
+	//! @param function	callable with a const reference to an element, called concurrently from several threads
+	//! @param min_grain	the smallest number of elements to run as one chunk, 0 for automatic
+	//! @return the element after the last written one
+	//!
+	template <std::random_access_iterator IteratorT, std::random_access_iterator OutputT, typename FuncT>
+	OutputT parallel_transform(thread_pool& pool, IteratorT first, IteratorT last, OutputT output, FuncT&& function, std::size_t min_grain = 0)
+	{
+		const std::size_t size = static_cast<std::size_t>(last - first);
+		auto body = [first, output, &function](std::size_t chunk_begin, std::size_t chunk_end)
+		{
+			std::transform(first + chunk_begin, first + chunk_end, output + chunk_begin, std::ref(function));
+		};
+		detail::split_range(pool, 0, size, detail::auto_grain(pool, size, min_grain), body);
+		return output + size;
+	}
+
+	//!
+	//! Combines init and transform(element) for all elements in [first, last) with operation, in an unspecified order
+	//! and grouping, without storing the transformed elements. If operation or transform throws, one of the exceptions
+	//! is rethrown once all running calls have returned.
+	//! @param init	the value to start from
+	//! @param operation	callable as T(T, T), must be associative and commutative
+	//! @param transform	callable with a const reference to an element, returning something convertible to T
+	//! @param min_grain	the smallest number of elements to reduce as one chunk, 0 for automatic
+	//! @return the combined value
+	//!
+	template <std::random_access_iterator IteratorT, typename T, typename OperationT, typename TransformT>
+	T parallel_transform_reduce(thread_pool& pool, IteratorT first, IteratorT last, T init, OperationT operation, TransformT transform, std::size_t min_grain = 0)
+	{
+		const std::size_t size = static_cast<std::size_t>(last - first);
+		if (size == 0)
+		{
+			return init;
+		}
+		T reduced = detail::reduce_range<IteratorT, T>(pool, first, size, detail::auto_grain(pool, size, min_grain), operation, transform);
+		return operation(std::move(init), std::move(reduced));
+	}
+
+	//!
+	//! Combines init and all elements in [first, last) with operation, in an unspecified order and grouping. If
+	//! operation throws, one of the exceptions is rethrown once all running calls have returned.
+	//! @param init	the value to start from
+	//! @param operation	callable as T(T, T), must be associative and commutative
+	//! @param min_grain	the smallest number of elements to reduce as one chunk, 0 for automatic
+	//! @return the combined value
+	//!
+	template <std::random_access_iterator IteratorT, typename T, typename OperationT = std::plus<>>
+	T parallel_reduce(thread_pool& pool, IteratorT first, IteratorT last, T init, OperationT operation = {}, std::size_t min_grain = 0)
+	{
+		return parallel_transform_reduce(pool, first, last, std::move(init), std::move(operation), std::identity(), min_grain);
+	}
+
+	//!
+	//! Sorts [first, last) with a parallel quicksort, the parts are sorted with std::sort once they are small enough
+	//! or have been partitioned too deep. Like std::sort it is not stable, does not allocate and takes O(n log n) time.
+	//! If compare throws, one of the exceptions is rethrown once all running comparisons have returned, and the range
+	//! is left in an unspecified order.
+	//! @param compare	the less than comparison to sort by
+	//! @param min_grain	the smallest number of elements to sort as one chunk, 0 for automatic
+	//!
+	template <std::random_access_iterator IteratorT, typename CompareT = std::less<>>
+	void parallel_sort(thread_pool& pool, IteratorT first, IteratorT last, CompareT compare = {}, std::size_t min_grain = 0)
+	{
+		const std::size_t size = static_cast<std::size_t>(last - first);
+		detail::sort_range(pool, first, last, detail::auto_grain(pool, size, std::max<std::size_t>(min_grain, 256)), 2 * std::bit_width(size), compare);
+	}
+}
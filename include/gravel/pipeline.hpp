@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+	namespace detail
+	{
+		//!
+		//! Stages fused into a single function object, each called with the result of the one before
+		//!
+		template <typename... StageT>
+		class Composed
+		{
+		public:
+			template <typename... FuncT>
+			explicit Composed(FuncT&&... stages)
+				: m_stages(std::forward<FuncT>(stages)...)
+			{
+			}
+
+			template <typename... ArgT>
+			decltype(auto) operator()(ArgT&&... arguments)
+			{
+				return apply<0>(m_stages, std::forward<ArgT>(arguments)...);
+			}
+
+			template <typename... ArgT>
+			decltype(auto) operator()(ArgT&&... arguments) const
+			{
+				return apply<0>(m_stages, std::forward<ArgT>(arguments)...);
+			}
+
+		private:
+			template <std::size_t Index, typename TupleT, typename... ArgT>
+			static decltype(auto) apply(TupleT& stages, ArgT&&... arguments)
+			{
+				if constexpr (Index + 1 == sizeof...(StageT))
+				{
+					return std::get<Index>(stages)(std::forward<ArgT>(arguments)...);
+				}
+				else
+				{
+					return apply<Index + 1>(stages, std::get<Index>(stages)(std::forward<ArgT>(arguments)...));
+				}
+			}
+
+			std::tuple<StageT...> m_stages;
+		};
+	}
+
+	//!
+	//! Fuses stages into a single function object, which calls the first stage with its arguments and every other
+	//! stage with the result of the stage before it, returning the result of the last. compose(f, g, h)(x) is h(g(f(x))).
+	//!
+	//! The stages are members of one closure type, so the compiler sees through the whole chain and can inline it,
+	//! and it fits in one unique_function instead of one per stage.
+	//! @param stages	the function objects, in the order they are applied, copied or moved into the result
+	//!
+	template <typename... FuncT>
+	auto compose(FuncT&&... stages) requires (sizeof...(FuncT) > 0)
+	{
+		return detail::Composed<std::decay_t<FuncT>...>(std::forward<FuncT>(stages)...);
+	}
+
+	//!
+	//! A chain of T(T) stages built at runtime, as a pipeline whose stages are chosen by configuration would be.
+	//!
+	//! Every call to then erases its stages into one unique_function, fusing them with compose when there are
+	//! several, so that stages known together at compile time cost a single indirect call and buffer. Only stages
+	//! added by separate calls to then are chained at runtime.
+	//!
+	//! @tparam	T	the type flowing through the pipeline
+	//!
+	template <typename T>
+	class pipeline
+	{
+	public:
+		using Stage = unique_function<T(T)>;
+
+		//!
+		//! Appends stages, fused into one
+		//! @param stages	the function objects, in the order they are applied, each callable as T(T)
+		//! @return this pipeline, to chain calls
+		//!
+		template <typename... FuncT>
+		pipeline& then(FuncT&&... stages) requires (sizeof...(FuncT) > 0)
+		{
+			if constexpr (sizeof...(FuncT) == 1)
+			{
+				// unique_function only takes rvalues, so stages passed as lvalues are copied first
+				m_stages.emplace_back(std::decay_t<FuncT>(std::forward<FuncT>(stages))...);
+			}
+			else
+			{
+				m_stages.emplace_back(compose(std::forward<FuncT>(stages)...));
+			}
+			return *this;
+		}
+
+		//!
+		//! Runs value through all stages
+		//! @return the result of the last stage, or value if there are no stages
+		//!
+		T operator()(T value)
+		{
+			for (Stage& stage : m_stages)
+			{
+				value = stage(std::move(value));
+			}
+			return value;
+		}
+
+		//!
+		//! The number of stages run one after the other, each of which may be fused from several
+		//!
+		std::size_t size() const
+		{
+			return m_stages.size();
+		}
+
+	private:
+		std::vector<Stage> m_stages;
+	};
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <optional>
+#include <system_error>
+#include <utility>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "gravel/mpsc_queue.hpp"
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Minimal Linux event loop around epoll, calling a unique_function<void(std::uint32_t)> with the ready epoll
+	//! events whenever a registered file descriptor becomes ready.
+	//!
+	//! Handlers are stored inline in a slot map whose index and generation are the epoll user data, so dispatching an
+	//! event is an index lookup, and events for a descriptor removed earlier in the same batch are recognized and
+	//! dropped. Other threads hand work to the loop with post, which pushes onto an mpsc_queue and only writes the
+	//! eventfd when the queue goes from empty to non-empty, so a burst of posts costs a single wake up.
+	//!
+	//! NOTE: Only post and stop may be called from other threads, everything else belongs to the thread running the
+	//! loop. Handlers may add, modify and remove registrations, including their own. System call failures other than
+	//! interruptions throw std::system_error.
+	//!
+	class reactor
+	{
+		static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+		//! The epoll user data of the eventfd
+		static constexpr std::uint64_t wake_key = std::numeric_limits<std::uint64_t>::max();
+
+	public:
+		using Handler = unique_function<void(std::uint32_t)>;
+
+		//!
+		//! Identifies a registered file descriptor
+		//!
+		class handle
+		{
+		public:
+			handle() = default;
+
+			bool operator==(const handle&) const = default;
+
+		private:
+			friend class reactor;
+
+			handle(std::uint32_t index, std::uint32_t generation)
+				: m_index(index)
+				, m_generation(generation)
+			{
+			}
+
+			std::uint32_t m_index = none;
+			std::uint32_t m_generation = 0;
+		};
+
+		//!
+		//! Constructor, creates the epoll instance and the eventfd to wake it up with
+		//!
+		reactor()
+			: m_epoll(check(::epoll_create1(EPOLL_CLOEXEC), "epoll_create1"))
+			, m_wake(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+		{
+			if (m_wake < 0)
+			{
+				const int error = errno;
+				::close(m_epoll);
+				throw std::system_error(error, std::generic_category(), "eventfd");
+			}
+			epoll_event event{};
+			event.events = EPOLLIN;
+			event.data.u64 = wake_key;
+			if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &event) < 0)
+			{
+				const int error = errno;
+				::close(m_wake);
+				::close(m_epoll);
+				throw std::system_error(error, std::generic_category(), "epoll_ctl");
+			}
+		}
+
+		reactor(const reactor&) = delete;
+		reactor& operator=(const reactor&) = delete;
+
+		//!
+		//! Destructor, destroys the handlers and tasks still posted without running them. The registered file
+		//! descriptors are not closed.
+		//!
+		~reactor()
+		{
+			::close(m_wake);
+			::close(m_epoll);
+		}
+
+		//!
+		//! Registers a file descriptor
+		//! @param fd	the file descriptor, which stays owned by the caller and must be removed before it is closed
+		//! @param events	the epoll events to wait for, such as EPOLLIN | EPOLLET
+		//! @param handler	called on the loop thread with the ready events
+		//! @return the handle to modify or remove the registration with
+		//!
+		handle add(int fd, std::uint32_t events, Handler&& handler)
+		{
+			const std::uint32_t index = allocate();
+			Entry& entry = m_entries[index];
+			epoll_event event{};
+			event.events = events;
+			event.data.u64 = key(index, entry.generation);
+			if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+			{
+				const int error = errno;
+				release(index);
+				throw std::system_error(error, std::generic_category(), "epoll_ctl");
+			}
+			entry.fd = fd;
+			entry.handler.emplace(std::move(handler));
+			return handle(index, entry.generation);
+		}
+
+		//!
+		//! Registers a file descriptor with a function object as handler
+		//! @tparam FuncT	the type of the function object, callable as void(std::uint32_t)
+		//!
+		template <typename FuncT>
+		handle add(int fd, std::uint32_t events, FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, Handler>)
+		{
+			return add(fd, events, Handler(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Changes the events a registration waits for
+		//! @return false if the handle is stale
+		//!
+		bool modify(handle registration, std::uint32_t events)
+		{
+			if (!valid(registration))
+			{
+				return false;
+			}
+			epoll_event event{};
+			event.events = events;
+			event.data.u64 = key(registration.m_index, registration.m_generation);
+			check(::epoll_ctl(m_epoll, EPOLL_CTL_MOD, m_entries[registration.m_index].fd, &event), "epoll_ctl");
+			return true;
+		}
+
+		//!
+		//! Removes a registration and destroys its handler, after it returns if it is the one running
+		//! @return false if the handle is stale
+		//!
+		bool remove(handle registration)
+		{
+			if (!valid(registration))
+			{
+				return false;
+			}
+			Entry& entry = m_entries[registration.m_index];
+			check(::epoll_ctl(m_epoll, EPOLL_CTL_DEL, entry.fd, nullptr), "epoll_ctl");
+			if (registration.m_index == m_running)
+			{
+				// Stale from now on, but the handler is destroyed only once it has returned
+				entry.generation += 1;
+				m_running_removed = true;
+			}
+			else
+			{
+				release(registration.m_index);
+			}
+			return true;
+		}
+
+		//!
+		//! Runs a task on the loop thread, may be called from any thread
+		//! @param task	the task to run
+		//!
+		void post(unique_function<void()>&& task)
+		{
+			// Count before pushing, so that the loop never consumes more tasks than it knows of
+			const bool idle = m_posted.fetch_add(1, std::memory_order_acq_rel) == 0;
+			m_posted_tasks.push(std::move(task));
+			if (idle)
+			{
+				wake();
+			}
+		}
+
+		//!
+		//! Posts a function object as a task
+		//! @tparam FuncT	the type of the function object, callable as void()
+		//!
+		template <typename FuncT>
+		void post(FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, unique_function<void()>>)
+		{
+			post(unique_function<void()>(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Waits once for events and runs the handlers of all ready file descriptors and the posted tasks
+		//! @param timeout_ms	the longest time to wait in milliseconds, -1 to wait indefinitely and 0 not at all
+		//! @return the number of handlers and tasks run
+		//!
+		std::size_t run_once(int timeout_ms = -1)
+		{
+			std::array<epoll_event, 64> events;
+			const int count = ::epoll_wait(m_epoll, events.data(), static_cast<int>(events.size()), timeout_ms);
+			if (count < 0)
+			{
+				if (errno == EINTR)
+				{
+					return 0;
+				}
+				throw std::system_error(errno, std::generic_category(), "epoll_wait");
+			}
+
+			std::size_t ran = 0;
+			for (int i = 0; i < count; ++i)
+			{
+				const std::uint64_t data = events[i].data.u64;
+				if (data == wake_key)
+				{
+					ran += run_posted();
+					continue;
+				}
+				const std::uint32_t index = static_cast<std::uint32_t>(data);
+				Entry& entry = m_entries[index];
+				if (entry.generation != static_cast<std::uint32_t>(data >> 32) || !entry.handler)
+				{
+					// Removed by a handler earlier in this batch
+					continue;
+				}
+				m_running = index;
+				(*entry.handler)(events[i].events);
+				m_running = none;
+				if (std::exchange(m_running_removed, false))
+				{
+					release(index);
+				}
+				ran += 1;
+			}
+			return ran;
+		}
+
+		//!
+		//! Runs the loop until stop is called
+		//!
+		void run()
+		{
+			while (!m_stopped.load(std::memory_order_acquire))
+			{
+				run_once();
+			}
+			m_stopped.store(false, std::memory_order_relaxed);
+		}
+
+		//!
+		//! Makes run return after the current iteration, may be called from any thread
+		//!
+		void stop()
+		{
+			m_stopped.store(true, std::memory_order_release);
+			wake();
+		}
+
+		//!
+		//! The number of registered file descriptors
+		//!
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+	private:
+		struct Entry
+		{
+			std::optional<Handler> handler;
+			int fd = -1;
+			std::uint32_t generation = 0;
+			std::uint32_t next_free = none;
+		};
+
+		static int check(int result, const char* operation)
+		{
+			if (result < 0)
+			{
+				throw std::system_error(errno, std::generic_category(), operation);
+			}
+			return result;
+		}
+
+		static std::uint64_t key(std::uint32_t index, std::uint32_t generation)
+		{
+			return (static_cast<std::uint64_t>(generation) << 32) | index;
+		}
+
+		bool valid(handle registration) const
+		{
+			return registration.m_index < m_entries.size() && m_entries[registration.m_index].generation == registration.m_generation
+				&& m_entries[registration.m_index].handler;
+		}
+
+		std::uint32_t allocate()
+		{
+			m_size += 1;
+			if (m_free != none)
+			{
+				return std::exchange(m_free, m_entries[m_free].next_free);
+			}
+			// A deque never moves its elements, so a running handler survives registrations made from inside it
+			m_entries.emplace_back();
+			return static_cast<std::uint32_t>(m_entries.size() - 1);
+		}
+
+		void release(std::uint32_t index)
+		{
+			Entry& entry = m_entries[index];
+			entry.handler.reset();
+			entry.fd = -1;
+			entry.generation += 1;
+			entry.next_free = std::exchange(m_free, index);
+			m_size -= 1;
+		}
+
+		void wake()
+		{
+			const std::uint64_t one = 1;
+			while (::write(m_wake, &one, sizeof(one)) < 0 && errno == EINTR)
+			{
+			}
+		}
+
+		std::size_t run_posted()
+		{
+			std::uint64_t value;
+			while (::read(m_wake, &value, sizeof(value)) < 0 && errno == EINTR)
+			{
+			}
+
+			// Only the tasks counted so far, so that a task posting itself cannot starve the file descriptors
+			const std::size_t known = m_posted.load(std::memory_order_acquire);
+			const std::size_t ran = m_posted_tasks.consume([](unique_function<void()>&& task) { task(); }, known);
+			// Tasks posted meanwhile, or counted but not pushed yet, are picked up on the next iteration
+			if (m_posted.fetch_sub(ran, std::memory_order_acq_rel) != ran)
+			{
+				wake();
+			}
+			return ran;
+		}
+
+		int m_epoll;
+		int m_wake;
+		std::deque<Entry> m_entries;
+		std::uint32_t m_free = none;
+		std::size_t m_size = 0;
+		std::uint32_t m_running = none;
+		bool m_running_removed = false;
+		mpsc_queue<unique_function<void()>> m_posted_tasks;
+		alignas(64) std::atomic<std::size_t> m_posted{ 0 };
+		std::atomic<bool> m_stopped{ false };
+	};
+}
+
+#endif
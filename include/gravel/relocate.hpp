@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "gravel/dynamic_value.hpp"
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Controls which types may be relocated byte by byte, ending the lifetime of the source without running its
+	//! destructor. Defaults to std::is_trivially_copyable.
+	//!
+	//! Types that do not point into themselves, such as std::unique_ptr or most containers, can opt in by
+	//! specializing this trait.
+	//!
+	template <typename T>
+	struct is_trivially_relocatable
+	{
+		static const bool value = std::is_trivially_copyable<T>::value;
+	};
+
+	//!
+	//! Relocates an object into uninitialized storage, source is left as uninitialized storage and must not be
+	//! destroyed afterwards. Trivially relocatable types are copied byte by byte, other types are moved and the source
+	//! destroyed.
+	//! @param source	the object to relocate
+	//! @param destination	uninitialized storage for a T
+	//!
+	template <typename T>
+	void relocate_at(T* source, T* destination)
+	{
+		if constexpr (is_trivially_relocatable<T>::value)
+		{
+			std::memcpy(static_cast<void*>(destination), static_cast<const void*>(source), sizeof(T));
+		}
+		else
+		{
+			new (destination) T(std::move(*source));
+			source->~T();
+		}
+	}
+
+	//!
+	//! Relocates a dynamic_value. Values held on the heap are relocated by copying the pointer and operations table,
+	//! without calling into the held value at all. Values held in the small buffer are moved by their move constructor.
+	//!
+	template <typename BaseT, typename PropertiesT>
+	void relocate_at(dynamic_value<BaseT, PropertiesT>* source, dynamic_value<BaseT, PropertiesT>* destination)
+	{
+		if (!detail::DynamicValueAccess::relocate_heap(*source, destination))
+		{
+			new (destination) dynamic_value<BaseT, PropertiesT>(std::move(*source));
+			source->~dynamic_value();
+		}
+	}
+
+	//!
+	//! Relocates a unique_function, see the dynamic_value overload
+	//!
+	template <typename RetT, typename... ArgT>
+	void relocate_at(unique_function<RetT(ArgT...)>* source, unique_function<RetT(ArgT...)>* destination)
+	{
+		if (!detail::DynamicValueAccess::relocate_heap(source->m_function, &destination->m_function))
+		{
+			new (destination) unique_function<RetT(ArgT...)>(std::move(*source));
+			source->~unique_function();
+		}
+	}
+
+	//!
+	//! Relocates count contiguous objects into uninitialized storage, see relocate_at
+	//! @param source	the first object to relocate
+	//! @param count	the number of objects
+	//! @param destination	uninitialized storage for count objects, must not overlap source
+	//!
+	template <typename T>
+	void relocate_n(T* source, std::size_t count, T* destination)
+	{
+		if constexpr (is_trivially_relocatable<T>::value)
+		{
+			std::memcpy(static_cast<void*>(destination), static_cast<const void*>(source), count * sizeof(T));
+		}
+		else
+		{
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				relocate_at(source + i, destination + i);
+			}
+		}
+	}
+}
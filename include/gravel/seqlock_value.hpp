@@ -0,0 +1,247 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#include "gravel/dynamic_value.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Controls which types may be copied byte by byte by a seqlock_value. Defaults to std::is_trivially_copyable.
+	//!
+	//! Polymorphic types are never trivially copyable, since copying them has to set up their vtable pointer. Types
+	//! whose only non-trivial part is their vtable pointer, with no user provided copy constructor or destructor
+	//! and only trivially copyable members, can opt in by specializing this trait. Copying those byte by byte is
+	//! implementation defined, but works on all mainstream ABIs.
+	//!
+	template <typename T>
+	struct is_bitwise_copyable
+	{
+		static const bool value = std::is_trivially_copyable<T>::value;
+	};
+
+	//!
+	//! Holds a small polymorphic value that a single writer may replace while any number of readers copy it
+	//! concurrently, without any atomic read-modify-write operations or memory reclamation.
+	//!
+	//! The value is stored as raw words together with a word identifying its type, guarded by a sequence counter.
+	//! Readers copy the words optimistically and retry if the writer was active meanwhile, so reads are cheap as long
+	//! as writes are rare. Only subtypes that are bitwise copyable (see is_bitwise_copyable) and fit in the small
+	//! buffer can be stored. Subtypes that are not trivially destructible can only be stored if BaseT has a virtual
+	//! destructor, which is run on the held value when it is replaced and when the seqlock_value is destroyed.
+	//! Snapshots are discarded without running it.
+	//!
+	//! NOTE: Only one thread may write at a time, concurrent writers must be serialized by the caller.
+	//!
+	//! @tparam BaseT	the Base type of the held values
+	//! @tparam PropertiesT	a specialization of gravel::Properties, only the small buffer size is used
+	//!
+	template <typename BaseT, typename PropertiesT = Properties<> >
+	class seqlock_value
+	{
+	public:
+		using properties = DynamicValProperties<BaseT, PropertiesT>;
+
+		//!
+		//! Types that can be stored in the seqlock_value
+		//!
+		template <typename T>
+		static constexpr bool storable = IsBaseOf<BaseT, T> && is_bitwise_copyable<T>::value && !std::is_abstract<T>::value
+			&& (std::is_trivially_destructible_v<T> || std::has_virtual_destructor_v<BaseT>)
+			&& sizeof(T) <= properties::small_buffer_size && alignof(T) <= alignof(std::uintptr_t);
+
+	private:
+		static const std::size_t word_count = (properties::small_buffer_size + sizeof(std::uintptr_t) - 1) / sizeof(std::uintptr_t);
+
+		using CopyOut = dynamic_value<BaseT, PropertiesT> (*)(const BaseT&);
+
+		struct Words
+		{
+			alignas(BaseT) std::array<std::uintptr_t, word_count> value;
+			CopyOut copy_out;
+		};
+
+	public:
+		//!
+		//! A consistent copy of the value held by a seqlock_value at the time it was taken
+		//!
+		class snapshot
+		{
+		public:
+			const BaseT* operator->() const
+			{
+				return &get();
+			}
+
+			const BaseT& operator*() const
+			{
+				return get();
+			}
+
+			const BaseT& get() const
+			{
+				return *std::launder(reinterpret_cast<const BaseT*>(m_words.value.data()));
+			}
+
+			//!
+			//! Copies the value into a dynamic_value, using the copy constructor of its actual type
+			//! @return the created dynamic_value
+			//!
+			dynamic_value<BaseT, PropertiesT> to_dynamic_value() const requires properties::copyable
+			{
+				return m_words.copy_out(get());
+			}
+
+		private:
+			friend class seqlock_value;
+
+			snapshot() = default;
+
+			Words m_words;
+		};
+
+		//!
+		//! Constructor, copies an object in as the initial value
+		//! @tparam	T	the type of the object, must be storable
+		//! @param initial	the object to hold
+		//!
+		template <typename T>
+		explicit seqlock_value(const T& initial) requires storable<T>
+		{
+			write(to_words<T>(initial), 0);
+		}
+
+		seqlock_value(const seqlock_value&) = delete;
+		seqlock_value& operator=(const seqlock_value&) = delete;
+
+		//!
+		//! Destructor, destroys the held value
+		//!
+		~seqlock_value()
+		{
+			Words words = held();
+			destroy(words);
+		}
+
+		//!
+		//! Copies the current value, retrying while the writer is active
+		//! @return a snapshot holding a consistent copy of the value
+		//!
+		snapshot load() const
+		{
+			snapshot result;
+			std::array<std::uintptr_t, word_count + 1> words;
+			for (;;)
+			{
+				const std::uint64_t before = m_sequence.load(std::memory_order_acquire);
+				if (before & 1)
+				{
+					continue;
+				}
+				for (std::size_t i = 0; i < words.size(); ++i)
+				{
+					words[i] = m_words[i].load(std::memory_order_relaxed);
+				}
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (m_sequence.load(std::memory_order_relaxed) == before)
+				{
+					break;
+				}
+			}
+			std::memcpy(result.m_words.value.data(), words.data(), sizeof(result.m_words.value));
+			std::memcpy(&result.m_words.copy_out, &words[word_count], sizeof(CopyOut));
+			return result;
+		}
+
+		//!
+		//! Replaces the held value with a copy of value
+		//! @tparam	T	the type of the object, must be storable
+		//! @param value	the object to copy in
+		//!
+		template <typename T>
+		void store(const T& value) requires storable<T>
+		{
+			Words replaced = held();
+			write(to_words<T>(value), m_sequence.load(std::memory_order_relaxed));
+			destroy(replaced);
+		}
+
+		//!
+		//! Replaces the held value, constructing the new one from arguments
+		//! @tparam T	the inner type to construct, must be storable
+		//! @tparam ArgT	the argument types to pass to T's constructor
+		//! @param	args	the arguments to perfectly forward to T's constructor
+		//!
+		template <typename T, typename... ArgT>
+		void emplace(ArgT&&... arguments) requires storable<T> && requires (ArgT&&... args) { T(std::forward<ArgT>(args)...); }
+		{
+			store(T(std::forward<ArgT>(arguments)...));
+		}
+
+	private:
+		template <typename T>
+		static Words to_words(const T& value)
+		{
+			Words words = {};
+			new (words.value.data()) T(value);
+			if constexpr (properties::copyable)
+			{
+				words.copy_out = [](const BaseT& copied) { return dynamic_value<BaseT, PropertiesT>(static_cast<const T&>(copied)); };
+			}
+			return words;
+		}
+
+		//!
+		//! Copies the held value out without checking the sequence, which is consistent as only the writer changes it
+		//!
+		Words held() const
+		{
+			Words words = {};
+			if constexpr (!std::is_trivially_destructible_v<BaseT>)
+			{
+				for (std::size_t i = 0; i < word_count; ++i)
+				{
+					words.value[i] = m_words[i].load(std::memory_order_relaxed);
+				}
+			}
+			return words;
+		}
+
+		//!
+		//! Runs the destructor of a value copied out by held, only non-trivial if BaseT has a virtual destructor
+		//!
+		static void destroy(Words& words)
+		{
+			if constexpr (!std::is_trivially_destructible_v<BaseT>)
+			{
+				std::launder(reinterpret_cast<BaseT*>(words.value.data()))->~BaseT();
+			}
+		}
+
+		void write(const Words& words, std::uint64_t sequence)
+		{
+			std::array<std::uintptr_t, word_count + 1> raw;
+			std::memcpy(raw.data(), words.value.data(), sizeof(words.value));
+			std::memcpy(&raw[word_count], &words.copy_out, sizeof(CopyOut));
+
+			m_sequence.store(sequence + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			for (std::size_t i = 0; i < raw.size(); ++i)
+			{
+				m_words[i].store(raw[i], std::memory_order_relaxed);
+			}
+			m_sequence.store(sequence + 2, std::memory_order_release);
+		}
+
+		static_assert(sizeof(CopyOut) == sizeof(std::uintptr_t));
+
+		std::atomic<std::uint64_t> m_sequence{ 0 };
+		std::array<std::atomic<std::uintptr_t>, word_count + 1> m_words;
+	};
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "gravel/detail/closure_arena.hpp"
+
+namespace gravel
+{
+	template <typename Signature>
+	class signal;
+
+	//!
+	//! Calls every connected slot with the arguments it is emitted with, in the order the slots were connected.
+	//!
+	//! Slots are any move constructible callables, unique_function included, stored back to back in a single arena
+	//! with their own size rather than behind a pointer each, so that emitting walks one contiguous block of memory.
+	//! Connections are an index into a table holding the offset of their slot and a generation, so disconnecting is
+	//! O(1) and disconnecting through a stale connection does nothing.
+	//!
+	//! Emitting is reentrant: slots may connect, disconnect and emit again. Slots connected during an emit are first
+	//! called by the next one, slots disconnected during an emit are not called anymore but only destroyed once the
+	//! outermost emit returns.
+	//!
+	//! NOTE: Not thread safe. Slots must not throw, they are invoked with the arguments as lvalues so that every slot
+	//! sees the same values.
+	//!
+	template <typename... ArgT>
+	class signal<void(ArgT...)>
+	{
+		using Arena = detail::ClosureArena<ArgT...>;
+		static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+
+	public:
+		//!
+		//! Identifies a connected slot, to disconnect it
+		//!
+		class connection
+		{
+		public:
+			connection() = default;
+
+			bool operator==(const connection&) const = default;
+
+		private:
+			friend class signal;
+
+			connection(std::uint32_t index, std::uint32_t generation)
+				: m_index(index)
+				, m_generation(generation)
+			{
+			}
+
+			std::uint32_t m_index = none;
+			std::uint32_t m_generation = 0;
+		};
+
+		signal() = default;
+		signal(const signal&) = delete;
+		signal& operator=(const signal&) = delete;
+
+		//!
+		//! Connects a slot
+		//! @tparam FuncT	the type of the callable, invocable with lvalues of ArgT...
+		//! @param function	the callable, moved into the arena
+		//! @return the connection to disconnect the slot with
+		//!
+		template <typename FuncT>
+		connection connect(FuncT&& function)
+		{
+			const std::uint32_t index = allocate();
+			// Growing the arena would move slots that are running, so slots connected while emitting wait aside
+			Entry& entry = m_connections[index];
+			entry.pending = m_emitting > 0;
+			m_deferred = m_deferred || entry.pending;
+			entry.offset = (entry.pending ? m_pending : m_slots).emplace(std::forward<FuncT>(function), index);
+			m_size += 1;
+			return connection(index, entry.generation);
+		}
+
+		//!
+		//! Disconnects a slot, which is destroyed immediately unless an emit is running
+		//! @return false if the slot was already disconnected
+		//!
+		bool disconnect(connection slot)
+		{
+			if (slot.m_index >= m_connections.size() || m_connections[slot.m_index].generation != slot.m_generation
+				|| m_connections[slot.m_index].offset == dead_offset)
+			{
+				return false;
+			}
+			const std::size_t offset = m_connections[slot.m_index].offset;
+			typename Arena::Header& header = (m_connections[slot.m_index].pending ? m_pending : m_slots).at(offset);
+			header.tag = Arena::removed;
+			m_dead_bytes += header.size;
+			release(slot.m_index);
+			m_size -= 1;
+			// The slot may be running while emitting, then it is destroyed by the compaction after the emit
+			m_deferred = m_deferred || m_emitting > 0;
+			if (m_emitting == 0)
+			{
+				m_slots.destroy(offset);
+				if (m_dead_bytes * 2 > m_slots.size())
+				{
+					compact();
+				}
+			}
+			return true;
+		}
+
+		//!
+		//! Calls all connected slots
+		//! @param arguments	passed to every slot as lvalues
+		//!
+		void emit(ArgT... arguments)
+		{
+			m_emitting += 1;
+			// Slots connected meanwhile go to the pending arena and nothing is compacted, so the arena stays put
+			std::byte* slot = m_slots.data();
+			std::byte* const end = slot + m_slots.size();
+			while (slot != end)
+			{
+				typename Arena::Header& header = *std::launder(reinterpret_cast<typename Arena::Header*>(slot));
+				if (header.tag != Arena::removed)
+				{
+					header.operations->invoke(header.closure(), arguments...);
+				}
+				slot += header.size;
+			}
+			m_emitting -= 1;
+
+			if (m_emitting == 0 && m_deferred)
+			{
+				compact();
+			}
+		}
+
+		void operator()(ArgT... arguments)
+		{
+			emit(arguments...);
+		}
+
+		//!
+		//! The number of connected slots
+		//!
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+	private:
+		static constexpr std::size_t dead_offset = std::numeric_limits<std::size_t>::max();
+
+		struct Entry
+		{
+			std::size_t offset = dead_offset;
+			std::uint32_t generation = 0;
+			std::uint32_t next_free = none;
+			bool pending = false;
+		};
+
+		std::uint32_t allocate()
+		{
+			if (m_free != none)
+			{
+				return std::exchange(m_free, m_connections[m_free].next_free);
+			}
+			m_connections.emplace_back();
+			return static_cast<std::uint32_t>(m_connections.size() - 1);
+		}
+
+		void release(std::uint32_t index)
+		{
+			Entry& entry = m_connections[index];
+			entry.offset = dead_offset;
+			entry.generation += 1;
+			entry.next_free = std::exchange(m_free, index);
+		}
+
+		//!
+		//! Destroys disconnected slots and moves the pending ones behind the others
+		//!
+		void compact()
+		{
+			auto moved = [this](std::uint32_t index, std::size_t offset)
+			{
+				m_connections[index].offset = offset;
+				m_connections[index].pending = false;
+			};
+			m_slots.compact(moved);
+			m_slots.append(m_pending, moved);
+			m_dead_bytes = 0;
+			m_deferred = false;
+		}
+
+		Arena m_slots;
+		std::uint32_t m_emitting = 0;
+		//! Whether slots were connected or disconnected while emitting
+		bool m_deferred = false;
+		Arena m_pending;
+		std::vector<Entry> m_connections;
+		std::uint32_t m_free = none;
+		std::size_t m_size = 0;
+		std::size_t m_dead_bytes = 0;
+	};
+}
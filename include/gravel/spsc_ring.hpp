@@ -0,0 +1,262 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "gravel/relocate.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Bounded wait-free single-producer single-consumer ring buffer, intended to pass messages such as
+	//! dynamic_value<Msg> or unique_function<void()> between two pipeline stages running on their own threads.
+	//!
+	//! Elements are stored inline in the ring, which is allocated once at construction. The producer and consumer
+	//! each keep their index on their own cache line together with a cached copy of the other side's index, and
+	//! only read the other side's cache line when the cached index leaves too few slots for an operation.
+	//!
+	//! The bulk operations push_n and pop_n relocate elements (see relocate_at), so passing a batch of dynamic_values
+	//! or unique_functions that hold their value on the heap copies a few words per element without calling into the
+	//! held values. Values held inline in their small buffer are not relocated byte by byte, but moved by their move
+	//! constructor and then destroyed, as are elements that are neither of those nor trivially relocatable.
+	//!
+	//! NOTE: Only one thread may push and only one thread may pop at a time.
+	//!
+	//! @tparam T	the element type, must be move constructible
+	//!
+	template <typename T>
+	class spsc_ring
+	{
+		struct Slot
+		{
+			T* value()
+			{
+				return reinterpret_cast<T*>(storage.data());
+			}
+
+			alignas(T) std::array<std::uint8_t, sizeof(T)> storage;
+		};
+
+	public:
+		//!
+		//! Constructor
+		//! @param capacity	the smallest number of elements the ring must be able to hold, rounded up to a power of two
+		//!
+		explicit spsc_ring(std::size_t capacity)
+			: m_mask(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1)
+			, m_slots(new Slot[m_mask + 1])
+		{
+		}
+
+		spsc_ring(const spsc_ring&) = delete;
+		spsc_ring& operator=(const spsc_ring&) = delete;
+
+		//!
+		//! Destructor, destroys any elements still in the ring
+		//!
+		~spsc_ring()
+		{
+			consume([](T&&) {});
+		}
+
+		//!
+		//! Constructs an element at the back of the ring, may only be called from the producer
+		//! @tparam ArgT	the argument types to pass to T's constructor
+		//! @param	args	the arguments to perfectly forward to T's constructor
+		//! @return false if the ring was full, in which case nothing was constructed
+		//!
+		template <typename... ArgT>
+		bool try_emplace(ArgT&&... arguments)
+		{
+			const std::size_t tail = m_producer.tail.load(std::memory_order_relaxed);
+			if (free_slots(tail, 1) == 0)
+			{
+				return false;
+			}
+			new (slot(tail)) T(std::forward<ArgT>(arguments)...);
+			m_producer.tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		//!
+		//! Moves an element to the back of the ring, may only be called from the producer
+		//! @param value	the element to push, left untouched if the ring was full
+		//! @return false if the ring was full
+		//!
+		bool try_push(T&& value)
+		{
+			return try_emplace(std::move(value));
+		}
+
+		//!
+		//! Relocates as many elements as fit from source to the back of the ring, may only be called from the producer
+		//! @param source	the elements to push, the pushed ones are left as uninitialized storage and must not be destroyed
+		//! @param count	the number of elements in source
+		//! @return the number of pushed elements, always the first ones in source
+		//!
+		std::size_t push_n(T* source, std::size_t count)
+		{
+			const std::size_t tail = m_producer.tail.load(std::memory_order_relaxed);
+			const std::size_t pushed = std::min(count, free_slots(tail, count));
+			const std::size_t first = tail & m_mask;
+			const std::size_t before_wrap = std::min(pushed, m_mask + 1 - first);
+			relocate_n(source, before_wrap, m_slots[first].value());
+			relocate_n(source + before_wrap, pushed - before_wrap, m_slots[0].value());
+			m_producer.tail.store(tail + pushed, std::memory_order_release);
+			return pushed;
+		}
+
+		//!
+		//! Pops the front element, may only be called from the consumer
+		//! @return the popped element, or nothing if the ring was empty
+		//!
+		std::optional<T> try_pop()
+		{
+			std::optional<T> result;
+			consume([&result](T&& value) { result.emplace(std::move(value)); }, 1);
+			return result;
+		}
+
+		//!
+		//! Relocates up to max_count elements from the front of the ring into destination, may only be called from the
+		//! consumer
+		//! @param destination	uninitialized storage for max_count elements, the popped ones must be destroyed by the caller
+		//! @param max_count	the largest number of elements to pop
+		//! @return the number of popped elements
+		//!
+		std::size_t pop_n(T* destination, std::size_t max_count)
+		{
+			const std::size_t head = m_consumer.head.load(std::memory_order_relaxed);
+			const std::size_t popped = std::min(max_count, used_slots(head, max_count));
+			const std::size_t first = head & m_mask;
+			const std::size_t before_wrap = std::min(popped, m_mask + 1 - first);
+			relocate_n(m_slots[first].value(), before_wrap, destination);
+			relocate_n(m_slots[0].value(), popped - before_wrap, destination + before_wrap);
+			m_consumer.head.store(head + popped, std::memory_order_release);
+			return popped;
+		}
+
+		//!
+		//! Passes up to max_count elements from the front of the ring to function, in order, may only be called from the
+		//! consumer. The slots are handed back to the producer once the whole batch has been processed.
+		//! If function throws, the element it was called with is still destroyed and counts as consumed, the slots
+		//! consumed so far are handed back and the exception propagates.
+		//! @param function	called with T&& for each consumed element, the element is destroyed after the call
+		//! @param max_count	the largest number of elements to consume
+		//! @return the number of consumed elements
+		//!
+		template <typename FuncT>
+		std::size_t consume(FuncT&& function, std::size_t max_count = SIZE_MAX)
+		{
+			struct Publish
+			{
+				std::atomic<std::size_t>& head;
+				const std::size_t first;
+				std::size_t consumed = 0;
+
+				~Publish()
+				{
+					if (consumed > 0)
+					{
+						head.store(first + consumed, std::memory_order_release);
+					}
+				}
+			} publish{ m_consumer.head, m_consumer.head.load(std::memory_order_relaxed) };
+
+			struct Destroy
+			{
+				T& value;
+
+				~Destroy()
+				{
+					value.~T();
+				}
+			};
+
+			const std::size_t count = std::min(max_count, used_slots(publish.first, max_count));
+			while (publish.consumed < count)
+			{
+				// Counted before the element is handed out, so that it is never handed out twice
+				Destroy destroy{ *std::launder(slot(publish.first + publish.consumed)) };
+				++publish.consumed;
+				function(std::move(destroy.value));
+			}
+			return count;
+		}
+
+		//!
+		//! Checks if there is an element to consume, may only be called from the consumer
+		//!
+		bool empty() const
+		{
+			const std::size_t head = m_consumer.head.load(std::memory_order_relaxed);
+			return m_consumer.cached_tail == head && m_producer.tail.load(std::memory_order_acquire) == head;
+		}
+
+		std::size_t capacity() const
+		{
+			return m_mask + 1;
+		}
+
+	private:
+		T* slot(std::size_t index)
+		{
+			return m_slots[index & m_mask].value();
+		}
+
+		//!
+		//! The number of slots the producer may fill, only reads the consumer's index if the cached one has too few
+		//!
+		std::size_t free_slots(std::size_t tail, std::size_t wanted)
+		{
+			std::size_t free = m_mask + 1 - (tail - m_producer.cached_head);
+			if (free < wanted)
+			{
+				m_producer.cached_head = m_consumer.head.load(std::memory_order_acquire);
+				free = m_mask + 1 - (tail - m_producer.cached_head);
+			}
+			return free;
+		}
+
+		//!
+		//! The number of slots the consumer may take, only reads the producer's index if the cached one has too few
+		//!
+		std::size_t used_slots(std::size_t head, std::size_t wanted)
+		{
+			std::size_t used = m_consumer.cached_tail - head;
+			if (used < wanted)
+			{
+				m_consumer.cached_tail = m_producer.tail.load(std::memory_order_acquire);
+				used = m_consumer.cached_tail - head;
+			}
+			return used;
+		}
+
+		struct alignas(64) Producer
+		{
+			std::atomic<std::size_t> tail{ 0 };
+			//! The consumer's head as last seen by the producer, at most as far as the actual head
+			std::size_t cached_head = 0;
+		};
+
+		struct alignas(64) Consumer
+		{
+			std::atomic<std::size_t> head{ 0 };
+			//! The producer's tail as last seen by the consumer, at most as far as the actual tail
+			std::size_t cached_tail = 0;
+		};
+
+		alignas(64) const std::size_t m_mask;
+		const std::unique_ptr<Slot[]> m_slots;
+		Producer m_producer;
+		Consumer m_consumer;
+	};
+}
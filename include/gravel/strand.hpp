@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "gravel/executor.hpp"
+#include "gravel/mpsc_queue.hpp"
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Serializes tasks on top of another executor: tasks submitted to a strand run in submission order and never
+	//! concurrently with each other, though possibly on different threads of the underlying executor. State only
+	//! touched from tasks of one strand thus needs no locking.
+	//!
+	//! Tasks are queued in a lock-free mpsc_queue, whose nodes hold each unique_function inline. The strand submits
+	//! a single drain task to the underlying executor when it goes from idle to busy, which runs up to batch_size
+	//! tasks and then either goes idle or resubmits itself so that other work on the executor gets a turn.
+	//!
+	//! NOTE: The executor must keep running tasks until the strand has been destroyed.
+	//!
+	//! @tparam ExecutorT	the underlying executor
+	//!
+	template <Executor ExecutorT>
+	class strand
+	{
+	public:
+		//!
+		//! Constructor
+		//! @param executor	the executor to run the tasks on
+		//! @param batch_size	the largest number of tasks to run before giving the executor back
+		//!
+		explicit strand(ExecutorT& executor, std::size_t batch_size = 64)
+			: m_executor(&executor)
+			, m_batch_size(batch_size)
+		{
+		}
+
+		strand(const strand&) = delete;
+		strand& operator=(const strand&) = delete;
+
+		//!
+		//! Destructor, waits until all submitted tasks have run and the strand has let go of the executor
+		//!
+		~strand()
+		{
+			while (m_pending.load(std::memory_order_acquire) != 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		//!
+		//! Queues a task, it runs after all tasks submitted before it have finished, may be called from any thread
+		//! @param task	the task to run
+		//!
+		void submit(unique_function<void()>&& task)
+		{
+			// Count before pushing, so that a drain never consumes more tasks than it knows of
+			const bool idle = m_pending.fetch_add(1, std::memory_order_acq_rel) == 0;
+			m_tasks.push(std::move(task));
+			if (idle)
+			{
+				// Nobody else is draining the strand
+				schedule_drain();
+			}
+		}
+
+		//!
+		//! Queues a function object as a task
+		//! @tparam FuncT	the type of the function object, callable as void()
+		//! @param function	the function object to run
+		//!
+		template <typename FuncT>
+		void submit(FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, unique_function<void()>>)
+		{
+			submit(unique_function<void()>(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Runs function immediately if called from a task of this strand, and queues it otherwise
+		//! @tparam FuncT	the type of the function object, callable as void()
+		//! @param function	the function object to run
+		//!
+		template <typename FuncT>
+		void dispatch(FuncT&& function)
+		{
+			if (running_in_this_thread())
+			{
+				function();
+			}
+			else
+			{
+				submit(std::forward<FuncT>(function));
+			}
+		}
+
+		//!
+		//! Awaitable that resumes the awaiting coroutine as a task of this strand
+		//!
+		detail::ScheduleAwaiter<strand> schedule()
+		{
+			return detail::ScheduleAwaiter<strand>(*this);
+		}
+
+		//!
+		//! Checks if the calling thread is running a task of this strand
+		//!
+		bool running_in_this_thread() const
+		{
+			return current() == this;
+		}
+
+	private:
+		static const strand*& current()
+		{
+			thread_local const strand* running = nullptr;
+			return running;
+		}
+
+		void schedule_drain()
+		{
+			m_executor->submit(unique_function<void()>([this]() { drain(); }));
+		}
+
+		void drain()
+		{
+			const strand* outer = std::exchange(current(), this);
+			const std::size_t ran = m_tasks.consume([](unique_function<void()>&& task) { task(); }, m_batch_size);
+			current() = outer;
+
+			// A pushed task may not be visible yet even though it was counted, then it is picked up by the next drain
+			if (m_pending.fetch_sub(ran, std::memory_order_acq_rel) != ran)
+			{
+				schedule_drain();
+			}
+		}
+
+		ExecutorT* m_executor;
+		std::size_t m_batch_size;
+		mpsc_queue<unique_function<void()>> m_tasks;
+		alignas(64) std::atomic<std::size_t> m_pending{ 0 };
+	};
+}
@@ -0,0 +1,395 @@
+#pragma once
+
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "gravel/detail/thread_records.hpp"
+#include "gravel/future.hpp"
+#include "gravel/mpsc_queue.hpp"
+
+namespace gravel
+{
+	template <typename T>
+	class task;
+
+	namespace detail
+	{
+		//! Frames up to this size come from a pool, larger ones from the global operator new
+		inline constexpr std::size_t largest_pooled_frame = 4096;
+
+		template <std::size_t Size>
+		struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) FrameBlock
+		{
+			std::array<std::byte, Size> bytes;
+		};
+
+		//!
+		//! Allocates a coroutine frame from the pool of the smallest size class, a power of two from 64 bytes, that
+		//! fits it. The pools are the node pools also used by mpsc_queue, so frames may be freed on any thread.
+		//!
+		template <std::size_t Size = 64>
+		void* allocate_frame(std::size_t size)
+		{
+			if constexpr (Size > largest_pooled_frame)
+			{
+				return ::operator new(size);
+			}
+			else
+			{
+				if (size > Size)
+				{
+					return allocate_frame<Size * 2>(size);
+				}
+				using Pool = MpscNodePool<FrameBlock<Size>>;
+				const std::shared_ptr<Pool>& pool = Pool::instance();
+				return pool->allocate(ThreadRecordCache<Pool, typename Pool::Record>::record_for(pool))->storage.data();
+			}
+		}
+
+		//!
+		//! Returns a frame allocated with allocate_frame, size must be the size it was allocated with
+		//!
+		template <std::size_t Size = 64>
+		void deallocate_frame(void* frame, std::size_t size)
+		{
+			if constexpr (Size > largest_pooled_frame)
+			{
+				::operator delete(frame);
+			}
+			else
+			{
+				if (size > Size)
+				{
+					deallocate_frame<Size * 2>(frame, size);
+					return;
+				}
+				using Node = MpscNode<FrameBlock<Size>>;
+				Node* node = reinterpret_cast<Node*>(static_cast<std::byte*>(frame) - offsetof(Node, storage));
+				MpscNodePool<FrameBlock<Size>>::instance()->recycle(node, node);
+			}
+		}
+
+		//!
+		//! Base of every coroutine promise of gravel, places the frames in the pooled size classes
+		//!
+		class PooledFramePromise
+		{
+		public:
+			static void* operator new(std::size_t size)
+			{
+				return allocate_frame(size);
+			}
+
+			static void operator delete(void* frame, std::size_t size)
+			{
+				deallocate_frame(frame, size);
+			}
+		};
+
+		class TaskPromiseBase : public PooledFramePromise
+		{
+			//!
+			//! Resumes the coroutine awaiting the finished task by symmetric transfer, so that chains of awaited tasks
+			//! do not grow the stack
+			//!
+			struct FinalAwaiter
+			{
+				bool await_ready() const noexcept
+				{
+					return false;
+				}
+
+				template <typename PromiseT>
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<PromiseT> finished) noexcept
+				{
+					std::coroutine_handle<> continuation = finished.promise().m_continuation;
+					return continuation ? continuation : std::noop_coroutine();
+				}
+
+				void await_resume() const noexcept
+				{
+				}
+			};
+
+		public:
+			std::suspend_always initial_suspend() const noexcept
+			{
+				return {};
+			}
+
+			FinalAwaiter final_suspend() const noexcept
+			{
+				return {};
+			}
+
+			void unhandled_exception()
+			{
+				m_error = std::current_exception();
+			}
+
+			void set_continuation(std::coroutine_handle<> continuation)
+			{
+				m_continuation = continuation;
+			}
+
+		protected:
+			void rethrow_error() const
+			{
+				if (m_error)
+				{
+					std::rethrow_exception(m_error);
+				}
+			}
+
+		private:
+			std::coroutine_handle<> m_continuation;
+			std::exception_ptr m_error;
+		};
+
+		template <typename T>
+		class TaskPromise : public TaskPromiseBase
+		{
+		public:
+			task<T> get_return_object();
+
+			template <typename ValueT>
+			void return_value(ValueT&& value)
+			{
+				m_value.emplace(std::forward<ValueT>(value));
+			}
+
+			T result()
+			{
+				rethrow_error();
+				return std::move(*m_value);
+			}
+
+		private:
+			std::optional<T> m_value;
+		};
+
+		template <>
+		class TaskPromise<void> : public TaskPromiseBase
+		{
+		public:
+			task<void> get_return_object();
+
+			void return_void() const noexcept
+			{
+			}
+
+			void result() const
+			{
+				rethrow_error();
+			}
+		};
+
+		//!
+		//! Coroutine that starts right away and destroys itself when done, used to drive a task from outside of
+		//! coroutines
+		//!
+		struct DetachedCoroutine
+		{
+			struct promise_type : PooledFramePromise
+			{
+				DetachedCoroutine get_return_object() const noexcept
+				{
+					return {};
+				}
+
+				std::suspend_never initial_suspend() const noexcept
+				{
+					return {};
+				}
+
+				std::suspend_never final_suspend() const noexcept
+				{
+					return {};
+				}
+
+				void return_void() const noexcept
+				{
+				}
+
+				void unhandled_exception() const noexcept
+				{
+					std::terminate();
+				}
+			};
+		};
+
+		template <typename T>
+		DetachedCoroutine complete_promise(task<T> work, promise<T> result)
+		{
+			try
+			{
+				if constexpr (std::is_void_v<T>)
+				{
+					co_await std::move(work);
+					result.set_value();
+				}
+				else
+				{
+					result.set_value(co_await std::move(work));
+				}
+			}
+			catch (...)
+			{
+				result.set_exception(std::current_exception());
+			}
+		}
+	}
+
+	//!
+	//! Lazily started coroutine producing a T, which starts running once awaited and resumes its awaiter when done.
+	//!
+	//! Finishing a task transfers control directly to the awaiting coroutine instead of calling it, so arbitrarily
+	//! deep chains of awaited tasks run in constant stack space, as long as the compiler turns the transfer into a
+	//! tail call. GCC only does so with optimizations enabled and without address sanitizer.
+	//!
+	//! Frames come from pools of size classes up to 4 KiB, so once warmed up calling a task does not allocate. To
+	//! continue on another thread, await the schedule() of an executor such as a thread_pool or strand, or
+	//! gravel::schedule(executor) for other executors.
+	//!
+	//! NOTE: A task can be awaited once. Destroying a task that has not finished destroys its frame, so a started
+	//! task must be awaited until done.
+	//!
+	//! @tparam T	the type of the result, may be void
+	//!
+	template <typename T = void>
+	class task
+	{
+	public:
+		using promise_type = detail::TaskPromise<T>;
+
+		task(const task&) = delete;
+		task& operator=(const task&) = delete;
+
+		task(task&& other) noexcept
+			: m_coroutine(std::exchange(other.m_coroutine, nullptr))
+		{
+		}
+
+		task& operator=(task&& other) noexcept
+		{
+			if (this != &other)
+			{
+				reset();
+				m_coroutine = std::exchange(other.m_coroutine, nullptr);
+			}
+			return *this;
+		}
+
+		~task()
+		{
+			reset();
+		}
+
+		//!
+		//! Checks if the task refers to a coroutine
+		//!
+		bool valid() const
+		{
+			return static_cast<bool>(m_coroutine);
+		}
+
+		//!
+		//! Checks if the coroutine has run to completion
+		//!
+		bool done() const
+		{
+			return m_coroutine.done();
+		}
+
+		//!
+		//! Starts the task and suspends the awaiting coroutine until it finishes
+		//! @return the value the task returned
+		//! @throw whatever the task threw
+		//!
+		auto operator co_await() && noexcept
+		{
+			struct Awaiter
+			{
+				bool await_ready() const noexcept
+				{
+					return coroutine.done();
+				}
+
+				std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+				{
+					coroutine.promise().set_continuation(awaiting);
+					return coroutine;
+				}
+
+				T await_resume()
+				{
+					return coroutine.promise().result();
+				}
+
+				std::coroutine_handle<promise_type> coroutine;
+			};
+			return Awaiter{ m_coroutine };
+		}
+
+	private:
+		friend class detail::TaskPromise<T>;
+
+		explicit task(std::coroutine_handle<promise_type> coroutine)
+			: m_coroutine(coroutine)
+		{
+		}
+
+		void reset()
+		{
+			if (m_coroutine)
+			{
+				std::exchange(m_coroutine, nullptr).destroy();
+			}
+		}
+
+		std::coroutine_handle<promise_type> m_coroutine;
+	};
+
+	template <typename T>
+	task<T> detail::TaskPromise<T>::get_return_object()
+	{
+		return task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+	}
+
+	inline task<void> detail::TaskPromise<void>::get_return_object()
+	{
+		return task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+	}
+
+	//!
+	//! Starts a task from outside of coroutines, it runs on the calling thread until it first suspends
+	//! @param work	the task to start
+	//! @return a future of the task's result, completed on whichever thread the task finishes on
+	//!
+	template <typename T>
+	future<T> start(task<T>&& work)
+	{
+		promise<T> result;
+		future<T> completion = result.get_future();
+		detail::complete_promise(std::move(work), std::move(result));
+		return completion;
+	}
+
+	//!
+	//! Starts a task and blocks until it has finished
+	//! @param work	the task to run
+	//! @return the task's result
+	//! @throw whatever the task threw
+	//!
+	template <typename T>
+	T sync_wait(task<T>&& work)
+	{
+		return start(std::move(work)).get();
+	}
+}
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <vector>
+
+#include "gravel/thread_pool.hpp"
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! A directed acyclic graph of tasks that runs on a thread_pool, every task starting as soon as all tasks it
+	//! depends on have finished.
+	//!
+	//! Every node holds its task as a unique_function<void()> together with an atomic count of the predecessors it
+	//! still waits for. A finishing node decrements the count of each successor, submits those that reach zero to the
+	//! pool and runs one of them directly. Counts re-arm themselves as their node starts, so a built graph can be run
+	//! any number of times without allocating or resetting anything.
+	//!
+	//! NOTE: The graph must not be modified or destroyed while it runs, and must not contain cycles.
+	//!
+	class task_graph
+	{
+		struct Node;
+
+	public:
+		//!
+		//! Handle to a node of a task_graph, valid for the lifetime of the graph
+		//!
+		class node
+		{
+		public:
+			//!
+			//! Makes this node run before other
+			//! @param other	a node of the same graph
+			//! @return this node, to chain calls
+			//!
+			node& precede(node other)
+			{
+				m_node->successors.push_back(other.m_node);
+				other.m_node->predecessors += 1;
+				m_node->graph->m_sources_dirty = true;
+				return *this;
+			}
+
+			//!
+			//! Makes this node run after other
+			//! @param other	a node of the same graph
+			//! @return this node, to chain calls
+			//!
+			node& succeed(node other)
+			{
+				other.precede(*this);
+				return *this;
+			}
+
+		private:
+			friend class task_graph;
+
+			explicit node(Node* target)
+				: m_node(target)
+			{
+			}
+
+			Node* m_node;
+		};
+
+		task_graph() = default;
+		task_graph(const task_graph&) = delete;
+		task_graph& operator=(const task_graph&) = delete;
+
+		//!
+		//! Adds a node
+		//! @tparam FuncT	the type of the task, callable as void() any number of times
+		//! @param task	the task to run each time the graph runs
+		//! @return the added node
+		//!
+		template <typename FuncT>
+		node emplace(FuncT&& task)
+		{
+			m_nodes.emplace_back(this, unique_function<void()>(std::forward<FuncT>(task)));
+			m_sources_dirty = true;
+			return node(&m_nodes.back());
+		}
+
+		//!
+		//! Runs every task once, and returns when all have finished. The calling thread runs tasks meanwhile, see
+		//! thread_pool::run_until.
+		//! @param pool	the pool to run the tasks on
+		//!
+		void run(thread_pool& pool)
+		{
+			if (m_sources_dirty)
+			{
+				m_sources.clear();
+				for (Node& candidate : m_nodes)
+				{
+					candidate.pending.store(candidate.predecessors, std::memory_order_relaxed);
+					if (candidate.predecessors == 0)
+					{
+						m_sources.push_back(&candidate);
+					}
+				}
+				m_sources_dirty = false;
+			}
+			if (m_nodes.empty())
+			{
+				return;
+			}
+
+			m_pool = &pool;
+			m_remaining.store(m_nodes.size(), std::memory_order_relaxed);
+			for (Node* source : m_sources)
+			{
+				submit(source);
+			}
+			pool.run_until([this]() { return m_remaining.load(std::memory_order_acquire) == 0; });
+		}
+
+		//!
+		//! The number of nodes
+		//!
+		std::size_t size() const
+		{
+			return m_nodes.size();
+		}
+
+	private:
+		struct Node
+		{
+			Node(task_graph* owner, unique_function<void()>&& function)
+				: graph(owner)
+				, task(std::move(function))
+			{
+			}
+
+			task_graph* graph;
+			unique_function<void()> task;
+			std::atomic<std::size_t> pending{ 0 };
+			std::size_t predecessors = 0;
+			std::vector<Node*> successors;
+		};
+
+		void submit(Node* target)
+		{
+			m_pool->submit([target]() { target->graph->execute(target); });
+		}
+
+		void execute(Node* target)
+		{
+			while (target)
+			{
+				// Every predecessor has finished, so nothing else touches the count until the next run
+				target->pending.store(target->predecessors, std::memory_order_relaxed);
+				target->task();
+
+				Node* next = nullptr;
+				for (Node* successor : target->successors)
+				{
+					if (successor->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+					{
+						// Run the first ready successor on this thread instead of going through the pool
+						if (next)
+						{
+							submit(successor);
+						}
+						else
+						{
+							next = successor;
+						}
+					}
+				}
+				m_remaining.fetch_sub(1, std::memory_order_release);
+				target = next;
+			}
+		}
+
+		std::deque<Node> m_nodes;
+		std::vector<Node*> m_sources;
+		//! Set when nodes or edges were added, the sources and predecessor counts are then updated by the next run
+		bool m_sources_dirty = false;
+		thread_pool* m_pool = nullptr;
+		std::atomic<std::size_t> m_remaining{ 0 };
+	};
+}
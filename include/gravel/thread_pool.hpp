@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gravel/executor.hpp"
+#include "gravel/mpmc_queue.hpp"
+#include "gravel/unique_function.hpp"
+#include "gravel/work_stealing_deque.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Work stealing thread pool running unique_function<void()> tasks.
+	//!
+	//! Every worker owns a work_stealing_deque. Tasks submitted from a worker go to the bottom of its own deque and
+	//! are run newest first, so fork-join style work stays cache local, while idle workers steal the oldest tasks
+	//! from randomly chosen victims. Tasks submitted from other threads go through a shared mpmc_queue. Workers that
+	//! find nothing to do park on an std::atomic::wait, and submitting only wakes one up if some worker is parked.
+	//!
+	//! Waiting for tasks is done with run_until, which runs other tasks while waiting instead of blocking the
+	//! thread, so tasks may wait for tasks they submitted themselves.
+	//!
+	//! NOTE: Tasks must not throw. Captures larger than the small buffer of unique_function are heap allocated.
+	//!
+	class thread_pool
+	{
+		using Task = unique_function<void()>;
+
+	public:
+		//!
+		//! Constructor, starts the workers
+		//! @param thread_count	the number of workers, at least one
+		//! @param deque_capacity	the number of tasks each worker can hold in its own deque, tasks submitted from a
+		//!							worker whose deque is full go to the shared queue
+		//!
+		explicit thread_pool(std::size_t thread_count = std::thread::hardware_concurrency(), std::size_t deque_capacity = 1024)
+			: m_injected(4096)
+		{
+			thread_count = std::max<std::size_t>(thread_count, 1);
+			m_workers.reserve(thread_count);
+			for (std::size_t i = 0; i < thread_count; ++i)
+			{
+				m_workers.push_back(std::make_unique<Worker>(deque_capacity, i));
+			}
+			for (auto& worker : m_workers)
+			{
+				worker->thread = std::thread([this, worker = worker.get()]() { work(*worker); });
+			}
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		//!
+		//! Destructor, runs all submitted tasks, including the ones they submit, and then stops the workers.
+		//! Must not be called from a task of this pool.
+		//!
+		~thread_pool()
+		{
+			m_stopping.store(true, std::memory_order_seq_cst);
+			m_signal.fetch_add(1, std::memory_order_seq_cst);
+			m_signal.notify_all();
+			for (auto& worker : m_workers)
+			{
+				worker->thread.join();
+			}
+		}
+
+		//!
+		//! Submits a task, from a worker of this pool it is pushed to the worker's own deque
+		//! @param task	the task to run
+		//!
+		void submit(Task&& task)
+		{
+			Worker* worker = current_worker();
+			if (worker)
+			{
+				if (!worker->deque.try_push(std::move(task)) && !m_injected.try_push(std::move(task)))
+				{
+					// Both are full, the caller is a worker so waiting for room could deadlock
+					task();
+					return;
+				}
+			}
+			else
+			{
+				m_injected.push(std::move(task));
+			}
+			wake_one();
+		}
+
+		//!
+		//! Submits a function object as a task
+		//! @tparam FuncT	the type of the function object, callable as void()
+		//! @param function	the function object to run
+		//!
+		template <typename FuncT>
+		void submit(FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, Task>)
+		{
+			submit(Task(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Awaitable that resumes the awaiting coroutine as a task of this pool, without allocating
+		//!
+		detail::ScheduleAwaiter<thread_pool> schedule()
+		{
+			return detail::ScheduleAwaiter<thread_pool>(*this);
+		}
+
+		//!
+		//! Runs tasks of this pool until done returns true, may be called from any thread. Threads that are not workers
+		//! of this pool take tasks from the shared queue and steal from the workers.
+		//! @param done	callable as bool(), checked before every task
+		//!
+		template <typename PredicateT>
+		void run_until(PredicateT&& done)
+		{
+			Worker* worker = current_worker();
+			while (!done())
+			{
+				if (std::optional<Task> task = find_task(worker))
+				{
+					(*task)();
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+
+		//!
+		//! The number of workers
+		//!
+		std::size_t size() const
+		{
+			return m_workers.size();
+		}
+
+		//!
+		//! Checks if the calling thread is one of this pool's workers
+		//!
+		bool in_worker() const
+		{
+			return current_worker() != nullptr;
+		}
+
+	private:
+		struct alignas(64) Worker
+		{
+			Worker(std::size_t deque_capacity, std::size_t index)
+				: deque(deque_capacity)
+				, random_state(static_cast<std::uint32_t>(index) * 2654435761u + 1)
+			{
+			}
+
+			//! xorshift32, for choosing victims
+			std::uint32_t next_random()
+			{
+				random_state ^= random_state << 13;
+				random_state ^= random_state >> 17;
+				random_state ^= random_state << 5;
+				return random_state;
+			}
+
+			work_stealing_deque<Task> deque;
+			std::uint32_t random_state;
+			std::thread thread;
+		};
+
+		struct CurrentWorker
+		{
+			const thread_pool* pool = nullptr;
+			Worker* worker = nullptr;
+		};
+
+		static CurrentWorker& current()
+		{
+			thread_local CurrentWorker current;
+			return current;
+		}
+
+		Worker* current_worker() const
+		{
+			const CurrentWorker& here = current();
+			return here.pool == this ? here.worker : nullptr;
+		}
+
+		std::optional<Task> find_task(Worker* worker)
+		{
+			if (worker)
+			{
+				if (std::optional<Task> task = worker->deque.pop())
+				{
+					return task;
+				}
+			}
+			if (std::optional<Task> task = m_injected.try_pop())
+			{
+				return task;
+			}
+
+			// Try every other worker once, starting at a random one
+			const std::size_t count = m_workers.size();
+			thread_local std::uint32_t outsider_random = 0x9e3779b9u;
+			std::uint32_t start = worker ? worker->next_random() : (outsider_random = outsider_random * 1664525u + 1013904223u);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				Worker& victim = *m_workers[(start + i) % count];
+				if (&victim == worker)
+				{
+					continue;
+				}
+				if (std::optional<Task> task = victim.deque.steal())
+				{
+					return task;
+				}
+			}
+			return std::nullopt;
+		}
+
+		void work(Worker& worker)
+		{
+			current() = CurrentWorker{ this, &worker };
+			for (;;)
+			{
+				if (std::optional<Task> task = find_task(&worker))
+				{
+					(*task)();
+					continue;
+				}
+
+				// Announce that we are about to sleep before the last look for work, pairs with wake_one
+				m_sleeping.fetch_add(1, std::memory_order_seq_cst);
+				const std::uint32_t signal = m_signal.load(std::memory_order_seq_cst);
+				if (std::optional<Task> task = find_task(&worker))
+				{
+					m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+					(*task)();
+					continue;
+				}
+				if (m_stopping.load(std::memory_order_seq_cst))
+				{
+					m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+					return;
+				}
+				m_signal.wait(signal, std::memory_order_seq_cst);
+				m_sleeping.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+
+		void wake_one()
+		{
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_sleeping.load(std::memory_order_relaxed) > 0)
+			{
+				m_signal.fetch_add(1, std::memory_order_seq_cst);
+				m_signal.notify_one();
+			}
+		}
+
+		std::vector<std::unique_ptr<Worker>> m_workers;
+		mpmc_queue<Task> m_injected;
+		alignas(64) std::atomic<std::size_t> m_sleeping{ 0 };
+		std::atomic<std::uint32_t> m_signal{ 0 };
+		std::atomic<bool> m_stopping{ false };
+	};
+}
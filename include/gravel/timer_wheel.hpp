@@ -0,0 +1,368 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "gravel/unique_function.hpp"
+
+namespace gravel
+{
+
+	//!
+	//! Hierarchical timer wheel running unique_function<void()> callbacks once their tick has been reached.
+	//!
+	//! Time is counted in ticks, whose length is up to the user, for example milliseconds of a steady_clock. The
+	//! wheel has levels of 64 slots, a timer sits in the lowest level whose slot covers its expiry and moves down a
+	//! level whenever the time reaches the start of its slot, so scheduling and cancelling are O(1) and every timer
+	//! moves at most once per level. Occupancy bitmaps let advance skip empty slots at every level.
+	//!
+	//! Timers live in a slab that is reused as they expire or get cancelled, with callbacks stored inline when their
+	//! captures fit the small buffer of unique_function, so once the slab has grown scheduling does not allocate.
+	//! Handles are an index and a generation, cancelling through a stale handle does nothing.
+	//!
+	//! NOTE: Not thread safe, intended to be owned by a single event loop thread. Callbacks may schedule and cancel
+	//! timers, including ones of the same batch.
+	//!
+	class timer_wheel
+	{
+		static constexpr std::size_t slot_bits = 6;
+		static constexpr std::size_t slots_per_level = std::size_t(1) << slot_bits;
+		//! Enough levels to cover every 64-bit tick
+		static constexpr std::size_t levels = (64 + slot_bits - 1) / slot_bits;
+		//! Lists are the slots of all levels followed by the batch currently expiring
+		static constexpr std::size_t expiring_list = levels * slots_per_level;
+		static constexpr std::uint32_t none = std::numeric_limits<std::uint32_t>::max();
+		static constexpr std::uint16_t no_list = std::numeric_limits<std::uint16_t>::max();
+
+	public:
+		//!
+		//! Identifies a scheduled timer, to cancel it
+		//!
+		class handle
+		{
+		public:
+			handle() = default;
+
+			bool operator==(const handle&) const = default;
+
+		private:
+			friend class timer_wheel;
+
+			handle(std::uint32_t index, std::uint32_t generation)
+				: m_index(index)
+				, m_generation(generation)
+			{
+			}
+
+			std::uint32_t m_index = none;
+			std::uint32_t m_generation = 0;
+		};
+
+		//!
+		//! Constructor
+		//! @param now	the tick the wheel starts at
+		//!
+		explicit timer_wheel(std::uint64_t now = 0)
+			: m_now(now)
+		{
+			m_heads.fill(none);
+		}
+
+		timer_wheel(const timer_wheel&) = delete;
+		timer_wheel& operator=(const timer_wheel&) = delete;
+
+		//!
+		//! Schedules a callback
+		//! @param delay	the number of ticks from now after which to run the callback, at least one
+		//! @param callback	the callback, run from advance
+		//! @return the handle to cancel the timer with
+		//!
+		handle schedule(std::uint64_t delay, unique_function<void()>&& callback)
+		{
+			const std::uint64_t expiry = m_now + std::max<std::uint64_t>(delay, 1);
+			const std::uint32_t index = allocate();
+			Timer& timer = m_timers[index];
+			timer.callback.emplace(std::move(callback));
+			timer.expiry = expiry < m_now ? std::numeric_limits<std::uint64_t>::max() : expiry;
+			place(index);
+			m_size += 1;
+			return handle(index, timer.generation);
+		}
+
+		//!
+		//! Schedules a function object as a callback
+		//! @tparam FuncT	the type of the function object, callable as void()
+		//!
+		template <typename FuncT>
+		handle schedule(std::uint64_t delay, FuncT&& function) requires (!std::is_same_v<std::decay_t<FuncT>, unique_function<void()>>)
+		{
+			return schedule(delay, unique_function<void()>(std::forward<FuncT>(function)));
+		}
+
+		//!
+		//! Cancels a timer, destroying its callback
+		//! @param timer	the handle returned when scheduling it
+		//! @return false if the timer already ran or was cancelled
+		//!
+		bool cancel(handle timer)
+		{
+			if (timer.m_index >= m_timers.size())
+			{
+				return false;
+			}
+			Timer& target = m_timers[timer.m_index];
+			if (target.generation != timer.m_generation || target.list == no_list)
+			{
+				return false;
+			}
+			unlink(timer.m_index);
+			release(timer.m_index);
+			m_size -= 1;
+			return true;
+		}
+
+		//!
+		//! Moves the time forward and runs the callbacks of all timers that expire on the way, in order of expiry
+		//! @param ticks	the number of ticks to move forward
+		//! @return the number of callbacks run
+		//!
+		std::size_t advance(std::uint64_t ticks)
+		{
+			return advance_to(m_now + ticks);
+		}
+
+		//!
+		//! Moves the time forward to target and runs the callbacks of all timers that expire on the way
+		//! @param target	the tick to move to, nothing happens if it is not after the current one
+		//! @return the number of callbacks run
+		//!
+		std::size_t advance_to(std::uint64_t target)
+		{
+			std::size_t ran = 0;
+			while (m_now < target)
+			{
+				// Step straight to the next occupied slot of any level: a level 0 slot to expire, or the start of a
+				// higher level slot to cascade. Every tick in between has nothing to do.
+				const std::optional<std::uint64_t> next = next_expiry();
+				if (!next)
+				{
+					m_now = target;
+					break;
+				}
+				m_now = std::min(target, *next);
+
+				if ((m_now & (slots_per_level - 1)) == 0)
+				{
+					cascade();
+				}
+				ran += expire(static_cast<std::size_t>(m_now & (slots_per_level - 1)));
+			}
+			return ran;
+		}
+
+		//!
+		//! The earliest tick at which advance may run a callback, exact for timers within the next 64 ticks and the
+		//! start of the slot otherwise, so that an event loop can sleep until then
+		//! @return the tick, or nothing if no timer is scheduled
+		//!
+		std::optional<std::uint64_t> next_expiry() const
+		{
+			for (std::size_t level = 0; level < levels; ++level)
+			{
+				if (m_occupied[level] != 0)
+				{
+					// Timers always sit in slots after the current one of their level
+					const std::size_t shift = level * slot_bits;
+					const std::uint64_t window = shift + slot_bits >= 64 ? 0 : m_now >> (shift + slot_bits) << (shift + slot_bits);
+					return window + (static_cast<std::uint64_t>(std::countr_zero(m_occupied[level])) << shift);
+				}
+			}
+			return std::nullopt;
+		}
+
+		//!
+		//! Preallocates room for a number of timers
+		//!
+		void reserve(std::size_t count)
+		{
+			m_timers.reserve(count);
+		}
+
+		//!
+		//! The current tick
+		//!
+		std::uint64_t now() const
+		{
+			return m_now;
+		}
+
+		//!
+		//! The number of scheduled timers
+		//!
+		std::size_t size() const
+		{
+			return m_size;
+		}
+
+		bool empty() const
+		{
+			return m_size == 0;
+		}
+
+	private:
+		struct Timer
+		{
+			std::optional<unique_function<void()>> callback;
+			std::uint64_t expiry = 0;
+			std::uint32_t next = none;
+			std::uint32_t previous = none;
+			std::uint32_t generation = 0;
+			std::uint16_t list = no_list;
+		};
+
+		std::uint32_t allocate()
+		{
+			if (m_free != none)
+			{
+				return std::exchange(m_free, m_timers[m_free].next);
+			}
+			m_timers.emplace_back();
+			return static_cast<std::uint32_t>(m_timers.size() - 1);
+		}
+
+		void release(std::uint32_t index)
+		{
+			Timer& timer = m_timers[index];
+			timer.callback.reset();
+			timer.generation += 1;
+			timer.list = no_list;
+			timer.next = std::exchange(m_free, index);
+		}
+
+		//!
+		//! Puts a timer into the slot for its expiry, at the level of the highest 6-bit group in which the expiry
+		//! differs from now
+		//!
+		void place(std::uint32_t index)
+		{
+			const std::uint64_t expiry = m_timers[index].expiry;
+			const std::uint64_t differing = expiry ^ m_now;
+			const std::size_t level = differing == 0 ? 0 : static_cast<std::size_t>(std::bit_width(differing) - 1) / slot_bits;
+			const std::size_t slot = static_cast<std::size_t>(expiry >> (level * slot_bits)) & (slots_per_level - 1);
+			link(index, level * slots_per_level + slot);
+			m_occupied[level] |= std::uint64_t(1) << slot;
+		}
+
+		void link(std::uint32_t index, std::size_t list)
+		{
+			Timer& timer = m_timers[index];
+			timer.list = static_cast<std::uint16_t>(list);
+			timer.previous = none;
+			timer.next = m_heads[list];
+			if (timer.next != none)
+			{
+				m_timers[timer.next].previous = index;
+			}
+			m_heads[list] = index;
+		}
+
+		void unlink(std::uint32_t index)
+		{
+			Timer& timer = m_timers[index];
+			if (timer.previous != none)
+			{
+				m_timers[timer.previous].next = timer.next;
+			}
+			else
+			{
+				m_heads[timer.list] = timer.next;
+				if (timer.next == none && timer.list != expiring_list)
+				{
+					m_occupied[timer.list / slots_per_level] &= ~(std::uint64_t(1) << (timer.list % slots_per_level));
+				}
+			}
+			if (timer.next != none)
+			{
+				m_timers[timer.next].previous = timer.previous;
+			}
+		}
+
+		//!
+		//! Detaches the whole list of a slot
+		//! @return the first timer of the list
+		//!
+		std::uint32_t detach(std::size_t level, std::size_t slot)
+		{
+			m_occupied[level] &= ~(std::uint64_t(1) << slot);
+			return std::exchange(m_heads[level * slots_per_level + slot], none);
+		}
+
+		//!
+		//! Called when the time reaches the start of a level 0 window, moves the timers of every level whose slot
+		//! starts now one or more levels down, from the highest such level on
+		//!
+		void cascade()
+		{
+			std::size_t top = 1;
+			while (top + 1 < levels && ((m_now >> (top * slot_bits)) & (slots_per_level - 1)) == 0)
+			{
+				top += 1;
+			}
+			for (std::size_t level = top; level >= 1; --level)
+			{
+				const std::size_t slot = static_cast<std::size_t>(m_now >> (level * slot_bits)) & (slots_per_level - 1);
+				std::uint32_t index = detach(level, slot);
+				while (index != none)
+				{
+					const std::uint32_t next = m_timers[index].next;
+					place(index);
+					index = next;
+				}
+			}
+		}
+
+		//!
+		//! Runs the callbacks of a level 0 slot. The batch is moved to its own list first, so that callbacks can
+		//! cancel timers of the same batch and schedule new ones without disturbing the iteration.
+		//! @return the number of callbacks run
+		//!
+		std::size_t expire(std::size_t slot)
+		{
+			if (!(m_occupied[0] & (std::uint64_t(1) << slot)))
+			{
+				return 0;
+			}
+			std::uint32_t index = detach(0, slot);
+			m_heads[expiring_list] = index;
+			for (std::uint32_t i = index; i != none; i = m_timers[i].next)
+			{
+				m_timers[i].list = static_cast<std::uint16_t>(expiring_list);
+			}
+
+			std::size_t ran = 0;
+			while ((index = m_heads[expiring_list]) != none)
+			{
+				unlink(index);
+				unique_function<void()> callback = std::move(*m_timers[index].callback);
+				release(index);
+				m_size -= 1;
+				callback();
+				ran += 1;
+			}
+			return ran;
+		}
+
+		std::vector<Timer> m_timers;
+		std::uint32_t m_free = none;
+		std::array<std::uint32_t, expiring_list + 1> m_heads;
+		std::array<std::uint64_t, levels> m_occupied = {};
+		std::uint64_t m_now;
+		std::size_t m_size = 0;
+	};
+}
@@ -33,6 +33,7 @@ namespace gravel
 		explicit unique_function(FuncT&& function)
 			: m_function(FunctionWrapper<std::decay_t<FuncT>>(std::forward<FuncT>(function)))
 		{
+			trace_heap<std::decay_t<FuncT>>();
 		}
 		
 		unique_function(const unique_function<RetT(ArgT...)>& other) = delete;
@@ -60,6 +61,7 @@ namespace gravel
 		unique_function& operator=(FuncT&& function)
 		{
 			m_function.emplace<FunctionWrapper< std::decay_t<FuncT> >>(std::forward<FuncT>(function));
+			trace_heap<std::decay_t<FuncT>>();
 			return *this;
 		}
 
@@ -73,6 +75,9 @@ namespace gravel
 			return (*m_function)(std::forward<ArgT>(arg)...);
 		}
 	private:
+		template <typename OtherRetT, typename... OtherArgT>
+		friend void relocate_at(unique_function<OtherRetT(OtherArgT...)>* source, unique_function<OtherRetT(OtherArgT...)>* destination);
+
 		class FunctionBase
 		{
 		public:
@@ -86,6 +91,9 @@ namespace gravel
 		class FunctionWrapper : public FunctionBase
 		{
 		public:
+			//! Spilling to the heap is traced as a unique_function_heap event only, see trace_heap
+			static constexpr bool traces_own_heap = true;
+
 			FunctionWrapper(FuncT&& f)
 				: m_function(std::move(f))
 			{
@@ -106,6 +114,20 @@ namespace gravel
 			FuncT m_function;
 		};
 		
-		dynamic_value<FunctionBase, Properties<Attr::Movable>> m_function;
+		using Holder = dynamic_value<FunctionBase, Properties<Attr::Movable>>;
+
+		//!
+		//! Instrumentation point for function objects too large for the small buffer
+		//!
+		template <typename FuncT>
+		static void trace_heap()
+		{
+			if constexpr (sizeof(FunctionWrapper<FuncT>) > Holder::properties::small_buffer_size)
+			{
+				GRAVEL_TRACE(trace_event::unique_function_heap, sizeof(FuncT), 0);
+			}
+		}
+
+		Holder m_function;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+
+namespace gravel
+{
+
+	//!
+	//! Bounded Chase-Lev work stealing deque. Its owner pushes and pops at the bottom without contention, while any
+	//! number of thieves steal from the top, so the owner works depth first on its newest tasks while the oldest,
+	//! typically largest, tasks are stolen.
+	//!
+	//! Elements are stored inline, such as unique_function<void()> tasks whose captures fit the small buffer. Unlike
+	//! the classic deque of pointers, a thief moves its element out only after claiming it, and the slot stays
+	//! reserved until it has done so. The owner treats a slot that is still being stolen from as full.
+	//!
+	//! NOTE: Only the owner may push and pop, and only one thread may act as the owner at a time.
+	//!
+	//! @tparam T	the element type, must be move constructible
+	//!
+	template <typename T>
+	class work_stealing_deque
+	{
+		struct Slot
+		{
+			T* value()
+			{
+				return reinterpret_cast<T*>(storage.data());
+			}
+
+			//! Set while the slot holds an element, cleared once it has been moved out
+			std::atomic<bool> occupied{ false };
+			alignas(T) std::array<std::uint8_t, sizeof(T)> storage;
+		};
+
+	public:
+		//!
+		//! Constructor
+		//! @param capacity	the smallest number of elements the deque must be able to hold, rounded up to a power of two
+		//!
+		explicit work_stealing_deque(std::size_t capacity)
+			: m_mask(std::bit_ceil(std::max<std::size_t>(capacity, 1)) - 1)
+			, m_slots(new Slot[m_mask + 1])
+		{
+		}
+
+		work_stealing_deque(const work_stealing_deque&) = delete;
+		work_stealing_deque& operator=(const work_stealing_deque&) = delete;
+
+		//!
+		//! Destructor, destroys any elements still in the deque. No thief may be active at this point.
+		//!
+		~work_stealing_deque()
+		{
+			while (pop())
+			{
+			}
+		}
+
+		//!
+		//! Constructs an element at the bottom of the deque, may only be called from the owner
+		//! @tparam ArgT	the argument types to pass to T's constructor
+		//! @param	args	the arguments to perfectly forward to T's constructor
+		//! @return false if the deque was full, in which case nothing was constructed
+		//!
+		template <typename... ArgT>
+		bool try_emplace(ArgT&&... arguments)
+		{
+			const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			const std::int64_t top = m_top.load(std::memory_order_acquire);
+			Slot& slot = m_slots[static_cast<std::size_t>(bottom) & m_mask];
+			if (bottom - top > static_cast<std::int64_t>(m_mask) || slot.occupied.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			new (slot.value()) T(std::forward<ArgT>(arguments)...);
+			slot.occupied.store(true, std::memory_order_relaxed);
+			m_bottom.store(bottom + 1, std::memory_order_release);
+			return true;
+		}
+
+		//!
+		//! Moves an element to the bottom of the deque, may only be called from the owner
+		//! @param value	the element to push, left untouched if the deque was full
+		//! @return false if the deque was full
+		//!
+		bool try_push(T&& value)
+		{
+			return try_emplace(std::move(value));
+		}
+
+		//!
+		//! Pops the bottom element, the one pushed last, may only be called from the owner
+		//! @return the popped element, or nothing if the deque was empty
+		//!
+		std::optional<T> pop()
+		{
+			const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+			m_bottom.store(bottom, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			std::int64_t top = m_top.load(std::memory_order_relaxed);
+
+			if (top > bottom)
+			{
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				return std::nullopt;
+			}
+			if (top == bottom)
+			{
+				// The last element, race the thieves for it
+				const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				m_bottom.store(bottom + 1, std::memory_order_relaxed);
+				if (!won)
+				{
+					return std::nullopt;
+				}
+			}
+			return take(m_slots[static_cast<std::size_t>(bottom) & m_mask]);
+		}
+
+		//!
+		//! Steals the top element, the oldest one, may be called from any thread
+		//! @return the stolen element, or nothing if the deque was empty or another thread took the element first
+		//!
+		std::optional<T> steal()
+		{
+			std::int64_t top = m_top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const std::int64_t bottom = m_bottom.load(std::memory_order_acquire);
+			if (top >= bottom)
+			{
+				return std::nullopt;
+			}
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				return std::nullopt;
+			}
+			return take(m_slots[static_cast<std::size_t>(top) & m_mask]);
+		}
+
+		//!
+		//! The number of elements in the deque at some point during the call
+		//!
+		std::size_t size() const
+		{
+			const std::int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+			const std::int64_t top = m_top.load(std::memory_order_relaxed);
+			return bottom > top ? static_cast<std::size_t>(bottom - top) : 0;
+		}
+
+		bool empty() const
+		{
+			return size() == 0;
+		}
+
+		std::size_t capacity() const
+		{
+			return m_mask + 1;
+		}
+
+	private:
+		static T take(Slot& slot)
+		{
+			T* value = std::launder(slot.value());
+			T result(std::move(*value));
+			value->~T();
+			slot.occupied.store(false, std::memory_order_release);
+			return result;
+		}
+
+		alignas(64) std::atomic<std::int64_t> m_top{ 0 };
+		alignas(64) std::atomic<std::int64_t> m_bottom{ 0 };
+		const std::size_t m_mask;
+		const std::unique_ptr<Slot[]> m_slots;
+	};
+}
@@ -0,0 +1,178 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gravel/actor.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	//!
+	//! Executor that only runs tasks when asked to, to observe how an actor schedules itself
+	//!
+	class ManualExecutor
+	{
+	public:
+		void submit(unique_function<void()>&& task)
+		{
+			m_tasks.push_back(std::move(task));
+		}
+
+		bool run_one()
+		{
+			if (m_tasks.empty())
+			{
+				return false;
+			}
+			unique_function<void()> task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			task();
+			return true;
+		}
+
+		std::size_t size() const
+		{
+			return m_tasks.size();
+		}
+
+	private:
+		std::deque<unique_function<void()>> m_tasks;
+	};
+}
+
+TEST_CASE("actor runs messages in the order they were sent")
+{
+	ManualExecutor executor;
+	actor<std::vector<int>, ManualExecutor> numbers(executor);
+	for (int i = 0; i < 5; ++i)
+	{
+		numbers.send([i](std::vector<int>& state) { state.push_back(i); });
+	}
+	// Only the first message schedules the actor
+	REQUIRE(executor.size() == 1);
+
+	future<std::vector<int>> copy = numbers.ask([](std::vector<int>& state) { return state; });
+	while (executor.run_one())
+	{
+	}
+	REQUIRE(copy.get() == std::vector<int>{ 0, 1, 2, 3, 4 });
+}
+
+TEST_CASE("actor gives the executor back after a batch")
+{
+	ManualExecutor executor;
+	actor<int, ManualExecutor> counter(executor, 0, 4);
+	for (int i = 0; i < 10; ++i)
+	{
+		counter.send([](int& count) { ++count; });
+	}
+	future<int> count = counter.ask([](int& count) { return count; });
+
+	REQUIRE(executor.run_one());
+	REQUIRE(!count.is_ready());
+	// The drain resubmitted itself behind other work instead of running everything
+	REQUIRE(executor.size() == 1);
+	REQUIRE(executor.run_one());
+	REQUIRE(executor.run_one());
+	REQUIRE(count.get() == 10);
+	REQUIRE(executor.size() == 0);
+}
+
+TEST_CASE("actor ask reports the exception a message threw")
+{
+	inline_executor executor;
+	actor<std::string, inline_executor> text(executor, "state");
+	future<std::size_t> size = text.ask([](std::string& state) { return state.size(); });
+	REQUIRE(size.get() == 5);
+
+	future<void> failed = text.ask([](std::string&) { throw std::runtime_error("Refused"); });
+	REQUIRE_THROWS_AS(failed.get(), std::runtime_error);
+
+	future<std::string> after = text.ask([](std::string& state) { return state + " survived"; });
+	REQUIRE(after.get() == "state survived");
+}
+
+TEST_CASE("actor serializes messages sent from many threads")
+{
+	thread_pool pool(4);
+	struct Counter
+	{
+		int count = 0;
+		std::atomic<int> inside{ 0 };
+		bool overlapped = false;
+	};
+	actor<std::unique_ptr<Counter>> counter(pool, std::make_unique<Counter>());
+	constexpr int senders = 4;
+	constexpr int per_sender = 5000;
+
+	std::vector<std::thread> threads;
+	for (int t = 0; t < senders; ++t)
+	{
+		threads.emplace_back([&counter]()
+		{
+			for (int i = 0; i < per_sender; ++i)
+			{
+				counter.send([](std::unique_ptr<Counter>& state)
+				{
+					state->overlapped = state->overlapped || state->inside.fetch_add(1) != 0;
+					++state->count;
+					state->inside.fetch_sub(1);
+				});
+			}
+		});
+	}
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	future<int> count = counter.ask([](std::unique_ptr<Counter>& state) { return state->overlapped ? -1 : state->count; });
+	REQUIRE(count.get() == senders * per_sender);
+}
+
+TEST_CASE("actors may send messages to each other")
+{
+	thread_pool pool(2);
+	constexpr int messages = 2000;
+	std::atomic<bool> done{ false };
+
+	struct Player
+	{
+		actor<Player>* other = nullptr;
+		int hits = 0;
+	};
+	actor<Player> ping(pool);
+	actor<Player> pong(pool);
+	ping.ask([&pong](Player& state) { state.other = &pong; }).get();
+	pong.ask([&ping](Player& state) { state.other = &ping; }).get();
+
+	struct Hit
+	{
+		void operator()(Player& state)
+		{
+			++state.hits;
+			if (remaining == 0)
+			{
+				*done = true;
+				return;
+			}
+			state.other->send(Hit{ remaining - 1, done });
+		}
+
+		int remaining;
+		std::atomic<bool>* done;
+	};
+	ping.send(Hit{ messages - 1, &done });
+	while (!done)
+	{
+		std::this_thread::yield();
+	}
+	REQUIRE(ping.ask([](Player& state) { return state.hits; }).get() == messages / 2);
+	REQUIRE(pong.ask([](Player& state) { return state.hits; }).get() == messages / 2);
+}
@@ -0,0 +1,185 @@
+#include "catch2/catch_test_macros.hpp"
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "gravel/async_logger.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	//!
+	//! Anonymous temporary file to log to, removed when closed
+	//!
+	class LogFile
+	{
+	public:
+		LogFile()
+			: m_file(std::tmpfile())
+		{
+			REQUIRE(m_file);
+		}
+
+		~LogFile()
+		{
+			std::fclose(m_file);
+		}
+
+		int fd() const
+		{
+			return fileno(m_file);
+		}
+
+		std::vector<std::string> lines() const
+		{
+			std::string contents;
+			char buffer[4096];
+			ssize_t read;
+			while ((read = ::pread(fd(), buffer, sizeof(buffer), static_cast<off_t>(contents.size()))) > 0)
+			{
+				contents.append(buffer, static_cast<std::size_t>(read));
+			}
+			std::vector<std::string> result;
+			std::istringstream stream(contents);
+			for (std::string line; std::getline(stream, line);)
+			{
+				result.push_back(line);
+			}
+			return result;
+		}
+
+	private:
+		std::FILE* m_file;
+	};
+}
+
+TEST_CASE("async_logger writes formatted records with their level once flushed")
+{
+	LogFile file;
+	async_logger logger(file.fd());
+	const int port = 8080;
+	REQUIRE(logger.log(log_level::info, [port](std::string& out) { out += "Listening on port " + std::to_string(port); }));
+	REQUIRE(logger.log(log_level::warning, [](std::string& out) { out += "Low on disk space"; }));
+	REQUIRE(logger.log(log_level::error, [](std::string& out) { out += "Lost connection"; }));
+	REQUIRE(logger.log(log_level::debug, [](std::string& out) { out += "Retrying"; }));
+	logger.flush();
+
+	REQUIRE(file.lines() == std::vector<std::string>{ "INFO Listening on port 8080", "WARNING Low on disk space",
+		"ERROR Lost connection", "DEBUG Retrying" });
+	REQUIRE(logger.dropped() == 0);
+}
+
+TEST_CASE("async_logger formats on the writer thread")
+{
+	LogFile file;
+	async_logger logger(file.fd());
+	const std::thread::id caller = std::this_thread::get_id();
+	std::atomic<bool> on_caller{ true };
+	logger.log(log_level::info, [caller, &on_caller](std::string& out)
+	{
+		on_caller = std::this_thread::get_id() == caller;
+		out += "Formatted";
+	});
+	logger.flush();
+	REQUIRE(!on_caller);
+}
+
+TEST_CASE("async_logger keeps the order of each thread")
+{
+	LogFile file;
+	constexpr int threads = 4;
+	constexpr int per_thread = 2000;
+	{
+		async_logger logger(file.fd(), 64);
+		std::vector<std::thread> loggers;
+		for (int t = 0; t < threads; ++t)
+		{
+			loggers.emplace_back([&logger, t]()
+			{
+				for (int i = 0; i < per_thread; ++i)
+				{
+					while (!logger.log(log_level::info, [t, i](std::string& out) { out += std::to_string(t) + " " + std::to_string(i); }))
+					{
+						std::this_thread::yield();
+					}
+				}
+			});
+		}
+		for (std::thread& thread : loggers)
+		{
+			thread.join();
+		}
+	}
+
+	std::vector<int> next(threads, 0);
+	const std::vector<std::string> lines = file.lines();
+	REQUIRE(lines.size() == threads * per_thread);
+	for (const std::string& line : lines)
+	{
+		int t = -1;
+		int i = -1;
+		REQUIRE(std::sscanf(line.c_str(), "INFO %d %d", &t, &i) == 2);
+		REQUIRE(i == next[t]);
+		next[t] += 1;
+	}
+}
+
+TEST_CASE("async_logger drops records when the ring of a thread is full")
+{
+	LogFile file;
+	async_logger logger(file.fd(), 2);
+	std::atomic<bool> gate{ false };
+	// The writer blocks formatting the first record, which keeps its slot until the batch is done
+	REQUIRE(logger.log(log_level::info, [&gate](std::string& out)
+	{
+		while (!gate.load())
+		{
+			std::this_thread::yield();
+		}
+		out += "first";
+	}));
+	REQUIRE(logger.log(log_level::info, [](std::string& out) { out += "second"; }));
+	REQUIRE(!logger.log(log_level::info, [](std::string& out) { out += "third"; }));
+	REQUIRE(logger.dropped() == 1);
+
+	gate = true;
+	logger.flush();
+	REQUIRE(file.lines() == std::vector<std::string>{ "INFO first", "INFO second" });
+}
+
+TEST_CASE("async_logger writes records of exited threads and reuses their rings")
+{
+	LogFile file;
+	{
+		async_logger logger(file.fd());
+		for (int t = 0; t < 3; ++t)
+		{
+			std::thread([&logger, t]() { logger.log(log_level::info, [t](std::string& out) { out += "thread " + std::to_string(t); }); }).join();
+		}
+	}
+	REQUIRE(file.lines() == std::vector<std::string>{ "INFO thread 0", "INFO thread 1", "INFO thread 2" });
+}
+
+TEST_CASE("async_logger can be created and destroyed many times by a thread logging to each")
+{
+	LogFile file;
+	std::vector<std::string> expected;
+	for (int i = 0; i < 200; ++i)
+	{
+		async_logger logger(file.fd(), 4);
+		REQUIRE(logger.log(log_level::info, [i](std::string& out) { out += "logger " + std::to_string(i); }));
+		expected.push_back("INFO logger " + std::to_string(i));
+	}
+	REQUIRE(file.lines() == expected);
+}
+
+#endif
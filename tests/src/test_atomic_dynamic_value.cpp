@@ -0,0 +1,198 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <thread>
+#include <vector>
+
+#include "gravel/atomic_dynamic_value.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Policy
+	{
+	public:
+		Policy(int* destructor_counter, int id)
+			: m_destructor_counter(destructor_counter)
+			, m_id(id)
+		{
+
+		}
+
+		Policy(const Policy& other)
+			: m_destructor_counter(other.m_destructor_counter)
+			, m_id(other.m_id)
+		{
+
+		}
+
+		virtual ~Policy()
+		{
+			if (m_destructor_counter)
+			{
+				*m_destructor_counter += 1;
+			}
+		}
+
+		virtual int route(int value) const
+		{
+			return value + m_id;
+		}
+
+		int* m_destructor_counter;
+		int m_id;
+	};
+
+	class ScalingPolicy : public Policy
+	{
+	public:
+		ScalingPolicy(int* destructor_counter, int id)
+			: Policy(destructor_counter, id)
+		{
+
+		}
+
+		int route(int value) const override
+		{
+			return value * m_id;
+		}
+	};
+
+	class LargePolicy : public Policy
+	{
+	public:
+		LargePolicy(int* destructor_counter, int id)
+			: Policy(destructor_counter, id)
+		{
+			m_padding.fill(static_cast<std::uint8_t>(id));
+		}
+
+		int route(int value) const override
+		{
+			return value - m_id;
+		}
+
+		std::array<std::uint8_t, 128> m_padding;
+	};
+}
+
+TEST_CASE("Atomic dynamic value basics")
+{
+	ebr::domain domain;
+	atomic_dynamic_value<Policy> value(Policy(nullptr, 1), domain);
+
+	SECTION("Load")
+	{
+		auto snapshot = value.load();
+		REQUIRE(snapshot->route(2) == 3);
+		REQUIRE((*snapshot).m_id == 1);
+	}
+	SECTION("Store")
+	{
+		value.store(dynamic_value<Policy>(ScalingPolicy(nullptr, 3)));
+		REQUIRE(value.load()->route(2) == 6);
+	}
+	SECTION("Emplace Non-Local")
+	{
+		value.emplace<LargePolicy>(nullptr, 5);
+		REQUIRE(value.load()->route(7) == 2);
+	}
+	SECTION("Exchange")
+	{
+		auto previous = value.exchange(dynamic_value<Policy>(ScalingPolicy(nullptr, 4)));
+		REQUIRE(previous->route(2) == 3);
+		REQUIRE(value.load()->route(2) == 8);
+	}
+	SECTION("Compare Exchange")
+	{
+		auto expected = value.load();
+		REQUIRE(value.compare_exchange(expected, dynamic_value<Policy>(ScalingPolicy(nullptr, 2))));
+
+		dynamic_value<Policy> rejected(ScalingPolicy(nullptr, 9));
+		REQUIRE(!value.compare_exchange(expected, std::move(rejected)));
+		REQUIRE(value.load()->route(3) == 6);
+	}
+}
+
+TEST_CASE("Atomic dynamic value reclamation")
+{
+	int dcounter = 0;
+	SECTION("Pinned values are kept alive")
+	{
+		{
+			ebr::domain domain;
+			atomic_dynamic_value<Policy> value(dynamic_value<Policy>::make_emplaced<Policy>(&dcounter, 1), domain);
+			dcounter = 0;
+
+			auto snapshot = value.load();
+			value.emplace<LargePolicy>(&dcounter, 2);
+			domain.collect();
+			domain.collect();
+			REQUIRE(dcounter == 0);
+			REQUIRE(snapshot->route(1) == 2);
+		}
+		REQUIRE(dcounter == 2);
+	}
+	SECTION("Released values are reclaimed")
+	{
+		{
+			ebr::domain domain;
+			atomic_dynamic_value<Policy> value(dynamic_value<Policy>::make_emplaced<Policy>(&dcounter, 1), domain);
+			dcounter = 0;
+
+			value.emplace<LargePolicy>(&dcounter, 2);
+			value.emplace<ScalingPolicy>(&dcounter, 3);
+			domain.collect();
+			domain.collect();
+			REQUIRE(dcounter == 2);
+			REQUIRE(value.load()->route(2) == 6);
+		}
+		REQUIRE(dcounter == 3);
+	}
+}
+
+TEST_CASE("Atomic dynamic value concurrent readers")
+{
+	ebr::domain domain;
+	atomic_dynamic_value<Policy> value(Policy(nullptr, 0), domain);
+
+	std::atomic<bool> done = false;
+	std::vector<std::thread> readers;
+	std::atomic<int> errors = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		readers.emplace_back([&]()
+		{
+			int last = 0;
+			while (!done.load())
+			{
+				auto snapshot = value.load();
+				if (snapshot->m_id < last)
+				{
+					errors += 1;
+				}
+				last = snapshot->m_id;
+			}
+		});
+	}
+
+	for (int i = 1; i <= 2000; ++i)
+	{
+		if (i % 2)
+		{
+			value.emplace<LargePolicy>(nullptr, i);
+		}
+		else
+		{
+			value.emplace<Policy>(nullptr, i);
+		}
+	}
+	done = true;
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+
+	REQUIRE(errors == 0);
+	REQUIRE(value.load()->m_id == 2000);
+}
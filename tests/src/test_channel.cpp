@@ -0,0 +1,207 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "gravel/channel.hpp"
+#include "gravel/dynamic_value.hpp"
+#include "gravel/task.hpp"
+#include "gravel/thread_pool.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	task<void> produce(channel<int>& target, int count)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			co_await target.send(i);
+		}
+		target.close();
+	}
+
+	task<std::vector<int>> collect(channel<int>& source)
+	{
+		std::vector<int> received;
+		while (std::optional<int> value = co_await source.recv())
+		{
+			received.push_back(*value);
+		}
+		co_return received;
+	}
+
+	struct Shape
+	{
+		virtual ~Shape() = default;
+		virtual int area() const = 0;
+	};
+
+	struct Square : Shape
+	{
+		explicit Square(int side)
+			: side(side)
+		{
+		}
+
+		int area() const override
+		{
+			return side * side;
+		}
+
+		int side;
+	};
+}
+
+TEST_CASE("channel try_send and try_recv without coroutines")
+{
+	channel<int> numbers(2);
+	REQUIRE(numbers.capacity() == 2);
+	REQUIRE(numbers.try_send(1));
+	REQUIRE(numbers.try_send(2));
+	REQUIRE(!numbers.try_send(3));
+	REQUIRE(numbers.size() == 2);
+
+	REQUIRE(numbers.try_recv() == 1);
+	REQUIRE(numbers.try_recv() == 2);
+	REQUIRE(!numbers.try_recv());
+}
+
+TEST_CASE("channel recv suspends until a value is sent")
+{
+	channel<int> numbers(4);
+	future<std::vector<int>> received = start(collect(numbers));
+	REQUIRE(!received.is_ready());
+
+	REQUIRE(numbers.try_send(7));
+	REQUIRE(!received.is_ready());
+	numbers.close();
+	REQUIRE(received.get() == std::vector<int>{ 7 });
+}
+
+TEST_CASE("channel send suspends while the channel is full")
+{
+	channel<int> numbers(2);
+	future<void> produced = start(produce(numbers, 5));
+	REQUIRE(!produced.is_ready());
+	REQUIRE(numbers.size() == 2);
+
+	// Every received value makes room for the waiting sender
+	REQUIRE(numbers.try_recv() == 0);
+	REQUIRE(numbers.try_recv() == 1);
+	REQUIRE(numbers.try_recv() == 2);
+	REQUIRE(produced.is_ready());
+	REQUIRE(numbers.closed());
+	REQUIRE(numbers.try_recv() == 3);
+	REQUIRE(numbers.try_recv() == 4);
+	REQUIRE(!numbers.try_recv());
+}
+
+TEST_CASE("channel connects coroutine stages in order")
+{
+	channel<int> numbers(3);
+	future<std::vector<int>> received = start(collect(numbers));
+	future<void> produced = start(produce(numbers, 100));
+	produced.get();
+
+	std::vector<int> expected;
+	for (int i = 0; i < 100; ++i)
+	{
+		expected.push_back(i);
+	}
+	REQUIRE(received.get() == expected);
+}
+
+TEST_CASE("channel close fails waiting senders and later sends")
+{
+	channel<int> numbers(1);
+	REQUIRE(numbers.try_send(1));
+	auto send = [](channel<int>& target) -> task<bool> { co_return co_await target.send(2); };
+	future<bool> sent = start(send(numbers));
+	REQUIRE(!sent.is_ready());
+
+	numbers.close();
+	REQUIRE(sent.get() == false);
+	REQUIRE(!numbers.try_send(3));
+	REQUIRE(numbers.try_recv() == 1);
+}
+
+TEST_CASE("channel stores move only payloads inline")
+{
+	channel<unique_function<int()>> functions(2);
+	channel<dynamic_value<Shape>> shapes(2);
+	REQUIRE(functions.try_send(unique_function<int()>([owned = std::make_unique<int>(5)]() { return *owned; })));
+	REQUIRE(shapes.try_send(make_dynamic_value<Shape, Square>(3)));
+
+	auto consume = [](channel<unique_function<int()>>& functions, channel<dynamic_value<Shape>>& shapes) -> task<int>
+	{
+		std::optional<unique_function<int()>> function = co_await functions.recv();
+		std::optional<dynamic_value<Shape>> shape = co_await shapes.recv();
+		co_return (*function)() + (*shape)->area();
+	};
+	REQUIRE(sync_wait(consume(functions, shapes)) == 14);
+}
+
+TEST_CASE("channel destroys buffered values")
+{
+	auto tracked = std::make_shared<int>(0);
+	{
+		channel<std::shared_ptr<int>> pointers(4);
+		REQUIRE(pointers.try_send(std::shared_ptr<int>(tracked)));
+		REQUIRE(tracked.use_count() == 2);
+	}
+	REQUIRE(tracked.use_count() == 1);
+}
+
+TEST_CASE("channel carries values between coroutines on many threads")
+{
+	const int producer_count = 4;
+	const int per_producer = 2000;
+	thread_pool pool(4);
+	channel<int> numbers(8);
+	std::atomic<long> sum{ 0 };
+	std::atomic<int> received{ 0 };
+
+	auto produce_on = [](thread_pool& pool, channel<int>& target, int count) -> task<void>
+	{
+		co_await pool.schedule();
+		for (int i = 1; i <= count; ++i)
+		{
+			co_await target.send(i);
+		}
+	};
+	auto consume_on = [](thread_pool& pool, channel<int>& source, std::atomic<long>& sum, std::atomic<int>& received) -> task<void>
+	{
+		co_await pool.schedule();
+		while (std::optional<int> value = co_await source.recv())
+		{
+			sum.fetch_add(*value, std::memory_order_relaxed);
+			received.fetch_add(1, std::memory_order_relaxed);
+		}
+	};
+
+	std::vector<future<void>> consumers;
+	for (int i = 0; i < 3; ++i)
+	{
+		consumers.push_back(start(consume_on(pool, numbers, sum, received)));
+	}
+	std::vector<future<void>> producers;
+	for (int i = 0; i < producer_count; ++i)
+	{
+		producers.push_back(start(produce_on(pool, numbers, per_producer)));
+	}
+	for (future<void>& producer : producers)
+	{
+		producer.get();
+	}
+	numbers.close();
+	for (future<void>& consumer : consumers)
+	{
+		consumer.get();
+	}
+	REQUIRE(received.load() == producer_count * per_producer);
+	REQUIRE(sum.load() == static_cast<long>(producer_count) * per_producer * (per_producer + 1) / 2);
+}
@@ -0,0 +1,99 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gravel/command_buffer.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+TEST_CASE("command_buffer replays commands in the order they were recorded")
+{
+	command_buffer<void(std::vector<std::string>&)> commands;
+	REQUIRE(commands.empty());
+	for (int i = 0; i < 100; ++i)
+	{
+		// Strings move when the arena grows
+		commands.record([text = "command " + std::to_string(i) + " with a long enough text"](std::vector<std::string>& log) { log.push_back(text); });
+	}
+	commands.record(unique_function<void(std::vector<std::string>&)>([](std::vector<std::string>& log) { log.push_back("last"); }));
+	REQUIRE(commands.size() == 101);
+
+	std::vector<std::string> log;
+	commands.replay(log);
+	REQUIRE(log.size() == 101);
+	REQUIRE(log[0] == "command 0 with a long enough text");
+	REQUIRE(log[99] == "command 99 with a long enough text");
+	REQUIRE(log[100] == "last");
+
+	// Replaying does not consume the commands
+	commands.replay(log);
+	REQUIRE(log.size() == 202);
+}
+
+TEST_CASE("command_buffer packs commands by their size")
+{
+	command_buffer<void(int&)> commands;
+	commands.record([](int& value) { value += 1; });
+	const std::size_t small = commands.bytes();
+	std::array<int, 50> values{};
+	values[49] = 100;
+	commands.record([values](int& value) { value += values[49]; });
+	REQUIRE(commands.bytes() - small > sizeof(values));
+	REQUIRE(commands.bytes() - small < sizeof(values) + 64);
+
+	int value = 0;
+	commands.replay(value);
+	REQUIRE(value == 101);
+}
+
+TEST_CASE("command_buffer reset destroys commands and keeps the arena")
+{
+	auto tracker = std::make_shared<int>(0);
+	command_buffer<void()> commands(4096);
+	const std::size_t capacity = commands.capacity();
+	REQUIRE(capacity >= 4096);
+
+	for (int frame = 0; frame < 3; ++frame)
+	{
+		int ran = 0;
+		for (int i = 0; i < 50; ++i)
+		{
+			commands.record([tracker, &ran]() { ran += 1; });
+			commands.record([&ran]() { ran += 1; });
+		}
+		REQUIRE(tracker.use_count() == 51);
+		commands.replay();
+		REQUIRE(ran == 100);
+		commands.reset();
+		REQUIRE(commands.empty());
+		REQUIRE(commands.bytes() == 0);
+		REQUIRE(tracker.use_count() == 1);
+		REQUIRE(commands.capacity() == capacity);
+	}
+}
+
+TEST_CASE("command_buffer can be moved")
+{
+	auto tracker = std::make_shared<int>(0);
+	int ran = 0;
+	command_buffer<void()> first;
+	first.record([tracker, &ran]() { ran += 1; });
+
+	command_buffer<void()> second(std::move(first));
+	REQUIRE(first.empty());
+	REQUIRE(second.size() == 1);
+	second.replay();
+	REQUIRE(ran == 1);
+
+	first.record([&ran]() { ran += 10; });
+	first = std::move(second);
+	REQUIRE(tracker.use_count() == 2);
+	first.replay();
+	REQUIRE(ran == 2);
+	first.reset();
+	REQUIRE(tracker.use_count() == 1);
+}
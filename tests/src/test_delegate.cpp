@@ -0,0 +1,125 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gravel/delegate.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Counter
+	{
+	public:
+		void add(int amount)
+		{
+			m_count += amount;
+		}
+
+		void subtract(int amount)
+		{
+			m_count -= amount;
+		}
+
+		int count() const
+		{
+			return m_count;
+		}
+
+		std::string describe(const std::string& prefix) const noexcept
+		{
+			return prefix + std::to_string(m_count);
+		}
+
+	private:
+		int m_count = 0;
+	};
+
+	int twice(int value)
+	{
+		return value * 2;
+	}
+}
+
+static_assert(sizeof(delegate<void(int)>) == 2 * sizeof(void*));
+static_assert(std::is_trivially_copyable_v<delegate<void(int)>>);
+
+TEST_CASE("delegate calls a member function on its object")
+{
+	Counter counter;
+	delegate<void(int)> add(&counter, method<&Counter::add>);
+	add(3);
+	add(4);
+	REQUIRE(counter.count() == 7);
+
+	// Copies call the same member function on the same object
+	delegate<void(int)> copy = add;
+	copy(1);
+	REQUIRE(counter.count() == 8);
+}
+
+TEST_CASE("bind deduces the signature of the member function")
+{
+	Counter counter;
+	auto add = bind<&Counter::add>(&counter);
+	static_assert(std::is_same_v<decltype(add), delegate<void(int)>>);
+	add(5);
+
+	const Counter& view = counter;
+	auto count = bind<&Counter::count>(&view);
+	static_assert(std::is_same_v<decltype(count), delegate<int()>>);
+	REQUIRE(count() == 5);
+
+	auto describe = bind<&Counter::describe>(&view);
+	REQUIRE(describe("count: ") == "count: 5");
+
+	auto doubled = bind<&twice>();
+	REQUIRE(doubled(21) == 42);
+}
+
+TEST_CASE("delegate binds functions and member functions taking their object")
+{
+	delegate<long(int)> doubled(method<&twice>);
+	REQUIRE(doubled(4) == 8);
+
+	Counter counter;
+	delegate<void(Counter&, int)> add(method<&Counter::add>);
+	add(counter, 2);
+	REQUIRE(counter.count() == 2);
+}
+
+TEST_CASE("delegate compares equal when bound to the same object and function")
+{
+	Counter first;
+	Counter second;
+	delegate<void(int)> empty;
+	REQUIRE(!empty);
+	REQUIRE(bind<&Counter::add>(&first));
+	REQUIRE(bind<&Counter::add>(&first) == delegate<void(int)>(&first, method<&Counter::add>));
+	REQUIRE(bind<&Counter::add>(&first) != bind<&Counter::add>(&second));
+	REQUIRE(bind<&Counter::add>(&first) != bind<&Counter::subtract>(&first));
+}
+
+TEST_CASE("delegate passes move-only arguments and fits a unique_function")
+{
+	struct Sink
+	{
+		void take(std::unique_ptr<int> value)
+		{
+			values.push_back(*value);
+		}
+
+		std::vector<int> values;
+	};
+	Sink sink;
+	delegate<void(std::unique_ptr<int>)> take = bind<&Sink::take>(&sink);
+	take(std::make_unique<int>(1));
+
+	unique_function<void(std::unique_ptr<int>)> function(std::move(take));
+	function(std::make_unique<int>(2));
+	REQUIRE(sink.values == std::vector<int>{ 1, 2 });
+}
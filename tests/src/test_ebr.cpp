@@ -0,0 +1,221 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <thread>
+#include <vector>
+
+#include "gravel/ebr.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Counted
+	{
+	public:
+		Counted(int* destructor_counter)
+			: m_destructor_counter(destructor_counter)
+		{
+
+		}
+
+		Counted(const Counted& other)
+			: m_destructor_counter(other.m_destructor_counter)
+		{
+
+		}
+
+		Counted(Counted&& other) noexcept
+			: m_destructor_counter(std::exchange(other.m_destructor_counter, nullptr))
+		{
+
+		}
+
+		virtual ~Counted()
+		{
+			if (m_destructor_counter)
+			{
+				*m_destructor_counter += 1;
+			}
+		}
+
+		int* m_destructor_counter;
+	};
+
+	class LargeCounted : public Counted
+	{
+	public:
+		LargeCounted(int* destructor_counter)
+			: Counted(destructor_counter)
+		{
+			m_padding.fill(0);
+		}
+
+		std::array<std::uint8_t, 128> m_padding;
+	};
+}
+
+TEST_CASE("Epoch domain reclamation")
+{
+	int dcounter = 0;
+	ebr::domain domain(1);
+
+	SECTION("Unpinned objects are reclaimed")
+	{
+		domain.retire(new Counted(&dcounter));
+		domain.synchronize();
+		REQUIRE(dcounter == 1);
+	}
+	SECTION("Pinned objects are kept alive")
+	{
+		std::atomic<bool> pinned = false;
+		std::atomic<bool> release = false;
+		std::thread reader([&]()
+		{
+			auto guard = domain.pin();
+			pinned = true;
+			while (!release)
+			{
+				std::this_thread::yield();
+			}
+		});
+		while (!pinned)
+		{
+			std::this_thread::yield();
+		}
+
+		domain.retire(new Counted(&dcounter));
+		for (int i = 0; i < 10; ++i)
+		{
+			domain.collect();
+		}
+		REQUIRE(dcounter == 0);
+
+		release = true;
+		reader.join();
+		domain.synchronize();
+		REQUIRE(dcounter == 1);
+	}
+	SECTION("Nested guards")
+	{
+		auto outer = domain.pin();
+		{
+			auto inner = domain.pin();
+		}
+		std::thread retirer([&]()
+		{
+			domain.retire(new Counted(&dcounter));
+			for (int i = 0; i < 10; ++i)
+			{
+				domain.collect();
+			}
+		});
+		retirer.join();
+		REQUIRE(dcounter == 0);
+
+		outer.release();
+		domain.synchronize();
+		REQUIRE(dcounter == 1);
+	}
+}
+
+TEST_CASE("Epoch domain retire dynamic values and functions")
+{
+	int dcounter = 0;
+	ebr::domain domain(1);
+
+	SECTION("Local dynamic value")
+	{
+		auto value = make_dynamic_value<Counted>(&dcounter);
+		domain.retire(std::move(value));
+		domain.synchronize();
+		REQUIRE(dcounter == 1);
+	}
+	SECTION("Heap dynamic value")
+	{
+		auto value = make_dynamic_value<Counted, LargeCounted>(&dcounter);
+		domain.retire(std::move(value));
+		REQUIRE(dcounter == 0);
+		domain.synchronize();
+		REQUIRE(dcounter == 1);
+	}
+	SECTION("Function")
+	{
+		int invoked = 0;
+		domain.retire(unique_function<void()>([&invoked, counted = Counted(&dcounter)]() { invoked += 1; }));
+		domain.synchronize();
+		REQUIRE(invoked == 1);
+		REQUIRE(dcounter == 1);
+	}
+}
+
+TEST_CASE("Epoch domain batching")
+{
+	int dcounter = 0;
+	ebr::domain domain(4);
+
+	for (int i = 0; i < 3; ++i)
+	{
+		domain.retire(new Counted(&dcounter));
+	}
+	REQUIRE(dcounter == 0);
+
+	SECTION("Full batch")
+	{
+		// Each full batch moves the epoch once, so the first batch is reclaimed by the time the third is
+		for (int i = 0; i < 9; ++i)
+		{
+			domain.retire(new Counted(&dcounter));
+		}
+		REQUIRE(dcounter >= 4);
+	}
+	SECTION("Exited threads")
+	{
+		std::thread exiting([&]()
+		{
+			domain.retire(new Counted(&dcounter));
+		});
+		exiting.join();
+		domain.synchronize();
+		domain.collect();
+		REQUIRE(dcounter == 4);
+	}
+}
+
+TEST_CASE("Epoch domain concurrent readers and writers")
+{
+	struct Node
+	{
+		int value;
+	};
+
+	ebr::domain domain;
+	std::atomic<Node*> shared = new Node{ 0 };
+	std::atomic<int> errors = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (int i = 1; i <= 5000; ++i)
+			{
+				auto guard = domain.pin();
+				Node* node = shared.load(std::memory_order_acquire);
+				if (node->value < 0)
+				{
+					errors += 1;
+				}
+				if (i % 4 == t)
+				{
+					domain.retire(shared.exchange(new Node{ i }));
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	delete shared.load();
+	REQUIRE(errors == 0);
+}
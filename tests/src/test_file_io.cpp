@@ -0,0 +1,196 @@
+#include "catch2/catch_test_macros.hpp"
+
+#if defined(__linux__)
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "gravel/file_io.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	//!
+	//! Anonymous temporary file, removed when closed
+	//!
+	class TemporaryFile
+	{
+	public:
+		TemporaryFile()
+			: m_file(std::tmpfile())
+		{
+			REQUIRE(m_file);
+		}
+
+		~TemporaryFile()
+		{
+			std::fclose(m_file);
+		}
+
+		int fd() const
+		{
+			return fileno(m_file);
+		}
+
+	private:
+		std::FILE* m_file;
+	};
+
+	std::vector<std::byte> pattern(std::size_t size, unsigned seed)
+	{
+		std::vector<std::byte> bytes(size);
+		for (std::size_t i = 0; i < size; ++i)
+		{
+			bytes[i] = static_cast<std::byte>((i * 31 + seed) & 0xff);
+		}
+		return bytes;
+	}
+
+	//!
+	//! Both backends, io_uring only where the kernel allows it
+	//!
+	std::vector<file_io::backend> backends(thread_pool& pool)
+	{
+		std::vector<file_io::backend> result = { file_io::backend::thread_pool };
+		if (file_io(pool).active_backend() == file_io::backend::io_uring)
+		{
+			result.push_back(file_io::backend::io_uring);
+		}
+		return result;
+	}
+}
+
+TEST_CASE("file_io reads back what it wrote")
+{
+	thread_pool pool(2);
+	for (file_io::backend preferred : backends(pool))
+	{
+		file_io io(pool, 8, preferred);
+		REQUIRE(io.active_backend() == preferred);
+		TemporaryFile file;
+		const std::vector<std::byte> written = pattern(10000, 1);
+
+		ssize_t write_result = 0;
+		io.async_write(file.fd(), written, 0, [&write_result](ssize_t result) { write_result = result; });
+		REQUIRE(io.in_flight() == 1);
+		io.drain();
+		REQUIRE(write_result == 10000);
+
+		std::vector<std::byte> read(10000);
+		ssize_t read_result = 0;
+		io.async_read(file.fd(), read, 0, [&read_result](ssize_t result) { read_result = result; });
+		io.drain();
+		REQUIRE(io.in_flight() == 0);
+		REQUIRE(read_result == 10000);
+		REQUIRE(read == written);
+	}
+}
+
+TEST_CASE("file_io reports the end of the file and errors like pread")
+{
+	thread_pool pool(1);
+	for (file_io::backend preferred : backends(pool))
+	{
+		file_io io(pool, 8, preferred);
+		TemporaryFile file;
+		std::vector<std::byte> buffer(16);
+
+		ssize_t end = -1;
+		io.async_read(file.fd(), buffer, 100, [&end](ssize_t result) { end = result; });
+		ssize_t error = 0;
+		io.async_read(-1, buffer, 0, [&error](ssize_t result) { error = result; });
+		io.drain();
+		REQUIRE(end == 0);
+		REQUIRE(error == -EBADF);
+	}
+}
+
+TEST_CASE("file_io runs more operations than its queue depth")
+{
+	thread_pool pool(2);
+	for (file_io::backend preferred : backends(pool))
+	{
+		file_io io(pool, 4, preferred);
+		TemporaryFile file;
+		constexpr std::size_t blocks = 500;
+		constexpr std::size_t block_size = 512;
+		const std::vector<std::byte> written = pattern(blocks * block_size, 7);
+
+		std::size_t completed = 0;
+		for (std::size_t i = 0; i < blocks; ++i)
+		{
+			io.async_write(file.fd(), std::span(written).subspan(i * block_size, block_size), i * block_size, [&completed](ssize_t result)
+			{
+				completed += result == block_size;
+			});
+		}
+		io.drain();
+		REQUIRE(completed == blocks);
+
+		std::vector<std::byte> read(blocks * block_size);
+		completed = 0;
+		for (std::size_t i = 0; i < blocks; ++i)
+		{
+			io.async_read(file.fd(), std::span(read).subspan(i * block_size, block_size), i * block_size, [&completed](ssize_t result)
+			{
+				completed += result == block_size;
+			});
+			if (i % 64 == 0)
+			{
+				io.poll();
+			}
+		}
+		io.drain();
+		REQUIRE(completed == blocks);
+		REQUIRE(read == written);
+	}
+}
+
+TEST_CASE("file_io handlers may start new operations")
+{
+	thread_pool pool(1);
+	for (file_io::backend preferred : backends(pool))
+	{
+		file_io io(pool, 2, preferred);
+		TemporaryFile file;
+		const std::vector<std::byte> written = pattern(64, 3);
+		std::vector<std::byte> read(64);
+		ssize_t read_result = 0;
+		io.async_write(file.fd(), written, 0, [&](ssize_t result)
+		{
+			REQUIRE(result == 64);
+			io.async_read(file.fd(), read, 0, [&read_result](ssize_t result) { read_result = result; });
+		});
+		while (io.in_flight() > 0)
+		{
+			io.wait();
+		}
+		REQUIRE(read_result == 64);
+		REQUIRE(read == written);
+	}
+}
+
+TEST_CASE("file_io destructor waits for the operations in flight")
+{
+	thread_pool pool(1);
+	for (file_io::backend preferred : backends(pool))
+	{
+		TemporaryFile file;
+		const std::vector<std::byte> written = pattern(4096, 5);
+		auto tracked = std::make_shared<int>(0);
+		int calls = 0;
+		{
+			file_io io(pool, 8, preferred);
+			io.async_write(file.fd(), written, 0, [tracked, &calls](ssize_t) { ++calls; });
+			REQUIRE(tracked.use_count() == 2);
+		}
+		REQUIRE(calls == 1);
+		REQUIRE(tracked.use_count() == 1);
+	}
+}
+
+#endif
@@ -0,0 +1,209 @@
+#include "catch2/catch_test_macros.hpp"
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "gravel/flight_recorder.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	struct ThreadEvents
+	{
+		std::uint64_t thread_id;
+		std::vector<flight_event> events;
+	};
+
+	//!
+	//! Dumps a recorder to a temporary file and reads it back through a mapping, as a post-mortem tool would
+	//!
+	std::vector<ThreadEvents> dump_and_map(const flight_recorder& recorder)
+	{
+		std::FILE* file = std::tmpfile();
+		REQUIRE(file);
+		recorder.dump(fileno(file));
+		struct stat status;
+		REQUIRE(::fstat(fileno(file), &status) == 0);
+		void* mapping = ::mmap(nullptr, static_cast<std::size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fileno(file), 0);
+		REQUIRE(mapping != MAP_FAILED);
+
+		const std::byte* cursor = static_cast<const std::byte*>(mapping);
+		const flight_dump_header& header = *reinterpret_cast<const flight_dump_header*>(cursor);
+		REQUIRE(header.magic == flight_dump_header::expected_magic);
+		REQUIRE(header.event_size == sizeof(flight_event));
+		REQUIRE(header.dump_ticks >= header.start_ticks);
+		REQUIRE(header.dump_realtime_ns >= header.start_realtime_ns);
+		cursor += sizeof(flight_dump_header);
+
+		std::vector<ThreadEvents> threads;
+		for (std::uint64_t t = 0; t < header.thread_count; ++t)
+		{
+			const flight_thread_header& thread = *reinterpret_cast<const flight_thread_header*>(cursor);
+			cursor += sizeof(flight_thread_header);
+			const flight_event* events = reinterpret_cast<const flight_event*>(cursor);
+			threads.push_back({ thread.thread_id, std::vector<flight_event>(events, events + thread.event_count) });
+			cursor += thread.event_count * sizeof(flight_event);
+		}
+		REQUIRE(cursor == static_cast<const std::byte*>(mapping) + status.st_size);
+		::munmap(mapping, static_cast<std::size_t>(status.st_size));
+		std::fclose(file);
+		return threads;
+	}
+}
+
+TEST_CASE("flight_recorder dumps the events of a thread in order")
+{
+	flight_recorder recorder;
+	for (std::uint64_t i = 0; i < 100; ++i)
+	{
+		recorder.record(0x100, i, i * 2);
+	}
+	recorder.record(trace_event::dynamic_value_heap, 64, 32);
+
+	const std::vector<ThreadEvents> threads = dump_and_map(recorder);
+	REQUIRE(threads.size() == 1);
+	const std::vector<flight_event>& events = threads[0].events;
+	REQUIRE(events.size() == 101);
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		REQUIRE(events[i].type == 0x100);
+		REQUIRE(events[i].payload[0] == i);
+		REQUIRE(events[i].payload[1] == i * 2);
+		if (i > 0)
+		{
+			REQUIRE(events[i].timestamp >= events[i - 1].timestamp);
+		}
+	}
+	REQUIRE(events[100].type == static_cast<std::uint16_t>(trace_event::dynamic_value_heap));
+}
+
+TEST_CASE("flight_recorder keeps the most recent events of each thread")
+{
+	flight_recorder recorder(8);
+	for (std::uint64_t i = 0; i < 20; ++i)
+	{
+		recorder.record(0x100, i);
+	}
+	const std::vector<ThreadEvents> threads = dump_and_map(recorder);
+	REQUIRE(threads.size() == 1);
+	REQUIRE(threads[0].events.size() == 8);
+	for (std::size_t i = 0; i < 8; ++i)
+	{
+		REQUIRE(threads[0].events[i].payload[0] == 12 + i);
+	}
+}
+
+TEST_CASE("flight_recorder records every thread in a ring of its own")
+{
+	flight_recorder recorder(1024);
+	constexpr int threads = 4;
+	std::vector<std::thread> recorders;
+	std::atomic<int> done{ 0 };
+	std::atomic<bool> release{ false };
+	for (int t = 0; t < threads; ++t)
+	{
+		// Keep the threads alive until all have recorded, so that none adopts the ring of another
+		recorders.emplace_back([&, t]()
+		{
+			for (std::uint64_t i = 0; i < 500; ++i)
+			{
+				recorder.record(0x100, static_cast<std::uint64_t>(t), i);
+			}
+			done += 1;
+			while (!release)
+			{
+				std::this_thread::yield();
+			}
+		});
+	}
+	while (done < threads)
+	{
+		std::this_thread::yield();
+	}
+	const std::vector<ThreadEvents> dumped = dump_and_map(recorder);
+	release = true;
+	for (std::thread& thread : recorders)
+	{
+		thread.join();
+	}
+
+	REQUIRE(dumped.size() == threads);
+	std::vector<bool> seen(threads, false);
+	for (const ThreadEvents& thread : dumped)
+	{
+		REQUIRE(thread.events.size() == 500);
+		const std::uint64_t t = thread.events[0].payload[0];
+		REQUIRE(!seen[t]);
+		seen[t] = true;
+		for (std::size_t i = 0; i < 500; ++i)
+		{
+			REQUIRE(thread.events[i].payload[0] == t);
+			REQUIRE(thread.events[i].payload[1] == i);
+		}
+	}
+}
+
+TEST_CASE("flight_recorder dumps consistent events while a thread keeps recording")
+{
+	flight_recorder recorder(64);
+	std::atomic<bool> stop{ false };
+	std::thread writer([&]()
+	{
+		for (std::uint64_t i = 0; !stop; ++i)
+		{
+			recorder.record(0x100, i, ~i);
+		}
+	});
+	for (int dump = 0; dump < 50; ++dump)
+	{
+		for (const ThreadEvents& thread : dump_and_map(recorder))
+		{
+			REQUIRE(thread.events.size() <= 64);
+			for (std::size_t i = 0; i < thread.events.size(); ++i)
+			{
+				REQUIRE(thread.events[i].payload[1] == ~thread.events[i].payload[0]);
+				if (i > 0)
+				{
+					REQUIRE(thread.events[i].payload[0] == thread.events[i - 1].payload[0] + 1);
+				}
+			}
+		}
+	}
+	stop = true;
+	writer.join();
+}
+
+TEST_CASE("flight_recorder receives the instrumentation points once installed")
+{
+	{
+		flight_recorder recorder;
+		recorder.install();
+		// What GRAVEL_TRACE does when GRAVEL_ENABLE_TRACING is defined
+		detail::TraceHook hook = detail::trace_hook.load();
+		REQUIRE(hook);
+		hook(trace_event::unique_function_heap, 48, 0);
+
+		const std::vector<ThreadEvents> threads = dump_and_map(recorder);
+		REQUIRE(threads.size() == 1);
+		REQUIRE(threads[0].events.size() == 1);
+		REQUIRE(threads[0].events[0].type == static_cast<std::uint16_t>(trace_event::unique_function_heap));
+		REQUIRE(threads[0].events[0].payload[0] == 48);
+
+		flight_recorder::uninstall();
+		REQUIRE(!detail::trace_hook.load());
+		recorder.install();
+	}
+	// Destroying the installed recorder uninstalls it
+	REQUIRE(!detail::trace_hook.load());
+}
+
+#endif
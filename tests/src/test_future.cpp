@@ -0,0 +1,248 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gravel/future.hpp"
+#include "gravel/thread_pool.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+TEST_CASE("future get returns the value set by the promise")
+{
+	promise<int> source;
+	future<int> result = source.get_future();
+	REQUIRE(result.valid());
+	REQUIRE(!result.is_ready());
+
+	source.set_value(42);
+	REQUIRE(result.is_ready());
+	REQUIRE(result.get() == 42);
+	REQUIRE(!result.valid());
+}
+
+TEST_CASE("future get blocks until the value is set from another thread")
+{
+	promise<std::string> source;
+	future<std::string> result = source.get_future();
+	std::thread producer([&source]() { source.set_value("gravel"); });
+	REQUIRE(result.get() == "gravel");
+	producer.join();
+}
+
+TEST_CASE("future supports move only values")
+{
+	promise<std::unique_ptr<int>> source;
+	future<std::unique_ptr<int>> result = source.get_future();
+	source.set_value(std::make_unique<int>(7));
+	REQUIRE(*result.get() == 7);
+}
+
+TEST_CASE("future<void> signals completion")
+{
+	promise<void> source;
+	future<void> result = source.get_future();
+	source.set_value();
+	REQUIRE(result.is_ready());
+	result.get();
+}
+
+TEST_CASE("future get rethrows the exception set by the promise")
+{
+	promise<int> source;
+	future<int> result = source.get_future();
+	source.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+	REQUIRE_THROWS_AS(result.get(), std::runtime_error);
+}
+
+TEST_CASE("future of a destroyed promise holds a broken promise error")
+{
+	future<int> result;
+	{
+		promise<int> source;
+		result = source.get_future();
+	}
+	REQUIRE(result.is_ready());
+	REQUIRE_THROWS_AS(result.get(), std::future_error);
+}
+
+TEST_CASE("promise without a retrieved future is released")
+{
+	promise<int> source;
+	source.set_value(1);
+}
+
+TEST_CASE("future then runs the continuation when the value is set")
+{
+	promise<int> source;
+	int seen = 0;
+	future<int> doubled = source.get_future().then([&seen](int value)
+	{
+		seen = value;
+		return value * 2;
+	});
+	REQUIRE(seen == 0);
+	REQUIRE(!doubled.is_ready());
+
+	source.set_value(21);
+	REQUIRE(seen == 21);
+	REQUIRE(doubled.is_ready());
+	REQUIRE(doubled.get() == 42);
+}
+
+TEST_CASE("future then runs the continuation immediately when already ready")
+{
+	future<int> result = make_ready_future<int>(5).then([](int value) { return value + 1; });
+	REQUIRE(result.is_ready());
+	REQUIRE(result.get() == 6);
+}
+
+TEST_CASE("future then chains and changes types")
+{
+	promise<int> source;
+	future<std::string> result = source.get_future()
+		.then([](int value) { return value * 3; })
+		.then([](int value) { return std::to_string(value); });
+	source.set_value(6);
+	REQUIRE(result.get() == "18");
+}
+
+TEST_CASE("future then accepts a unique_function")
+{
+	promise<int> source;
+	future<int> result = source.get_future().then(unique_function<int(int)>([](int value) { return value - 1; }));
+	source.set_value(1);
+	REQUIRE(result.get() == 0);
+}
+
+TEST_CASE("future then handles void on either side")
+{
+	promise<void> source;
+	int calls = 0;
+	future<int> counted = source.get_future()
+		.then([&calls]() { ++calls; })
+		.then([&calls]() { return calls; });
+	source.set_value();
+	REQUIRE(counted.get() == 1);
+}
+
+TEST_CASE("future then passes exceptions on without calling the function")
+{
+	promise<int> source;
+	bool called = false;
+	future<int> result = source.get_future().then([&called](int value)
+	{
+		called = true;
+		return value;
+	});
+	source.set_exception(std::make_exception_ptr(std::runtime_error("failed")));
+	REQUIRE(!called);
+	REQUIRE_THROWS_AS(result.get(), std::runtime_error);
+}
+
+TEST_CASE("future then turns a throwing function into an exception")
+{
+	future<int> result = make_ready_future<int>(1).then([](int) -> int { throw std::logic_error("thrown"); });
+	REQUIRE_THROWS_AS(result.get(), std::logic_error);
+}
+
+TEST_CASE("future then continuations are destroyed with the unused result")
+{
+	auto tracked = std::make_shared<int>(0);
+	{
+		promise<int> source;
+		source.get_future().then([tracked](int) {});
+		source.set_value(1);
+	}
+	REQUIRE(tracked.use_count() == 1);
+}
+
+TEST_CASE("when_all is ready once all futures are")
+{
+	promise<int> first;
+	promise<void> second;
+	promise<std::string> third;
+	future<std::tuple<int, std::monostate, std::string>> all = when_all(first.get_future(), second.get_future(), third.get_future());
+
+	third.set_value("three");
+	first.set_value(1);
+	REQUIRE(!all.is_ready());
+	second.set_value();
+	REQUIRE(all.is_ready());
+
+	auto [one, two, three] = all.get();
+	REQUIRE(one == 1);
+	REQUIRE(three == "three");
+}
+
+TEST_CASE("when_all holds the exception of the first failed future")
+{
+	promise<int> first;
+	promise<int> second;
+	future<std::tuple<int, int>> all = when_all(first.get_future(), second.get_future());
+	second.set_exception(std::make_exception_ptr(std::runtime_error("second")));
+	first.set_value(1);
+	REQUIRE_THROWS_AS(all.get(), std::runtime_error);
+}
+
+TEST_CASE("when_all of no futures is ready")
+{
+	future<std::tuple<>> all = when_all();
+	REQUIRE(all.is_ready());
+	all.get();
+}
+
+TEST_CASE("when_any is ready with the first future")
+{
+	promise<int> first;
+	promise<std::string> second;
+	future<std::variant<int, std::string>> any = when_any(first.get_future(), second.get_future());
+	REQUIRE(!any.is_ready());
+
+	second.set_value("second");
+	REQUIRE(any.is_ready());
+	first.set_value(1);
+
+	std::variant<int, std::string> winner = any.get();
+	REQUIRE(winner.index() == 1);
+	REQUIRE(std::get<1>(winner) == "second");
+}
+
+TEST_CASE("when_any keeps its state until every input has completed")
+{
+	promise<int> first;
+	future<std::variant<int, int>> any;
+	{
+		promise<int> second;
+		any = when_any(first.get_future(), second.get_future());
+		first.set_value(1);
+	}
+	REQUIRE(std::get<0>(any.get()) == 1);
+}
+
+TEST_CASE("future continuations run on the completing threads")
+{
+	const int count = 1000;
+	thread_pool pool(4);
+	std::vector<promise<int>> sources(count);
+	std::atomic<int> sum{ 0 };
+	std::vector<future<void>> results;
+	for (promise<int>& source : sources)
+	{
+		results.push_back(source.get_future().then([&sum](int value) { sum.fetch_add(value, std::memory_order_relaxed); }));
+	}
+	for (int i = 0; i < count; ++i)
+	{
+		pool.submit([&sources, i]() { sources[i].set_value(i); });
+	}
+	for (future<void>& result : results)
+	{
+		result.get();
+	}
+	REQUIRE(sum.load() == count * (count - 1) / 2);
+}
@@ -0,0 +1,283 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <thread>
+#include <vector>
+
+#include "gravel/hazard_pointer.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Counted
+	{
+	public:
+		Counted(int* destructor_counter, int value = 0)
+			: m_destructor_counter(destructor_counter)
+			, m_value(value)
+		{
+
+		}
+
+		Counted(const Counted& other)
+			: m_destructor_counter(other.m_destructor_counter)
+			, m_value(other.m_value)
+		{
+
+		}
+
+		virtual ~Counted()
+		{
+			if (m_destructor_counter)
+			{
+				*m_destructor_counter += 1;
+			}
+		}
+
+		int* m_destructor_counter;
+		int m_value;
+	};
+
+	class SpilledCounted : public Counted
+	{
+	public:
+		SpilledCounted(int* destructor_counter, int value)
+			: Counted(destructor_counter, value)
+		{
+			m_padding.fill(0);
+		}
+
+		std::array<std::uint8_t, 128> m_padding;
+	};
+
+	class LiveCounted
+	{
+	public:
+		LiveCounted(std::atomic<int>& live)
+			: m_live(live)
+		{
+			m_live += 1;
+		}
+
+		~LiveCounted()
+		{
+			m_live -= 1;
+		}
+
+		std::atomic<int>& m_live;
+	};
+}
+
+TEST_CASE("Hazard pointer protection")
+{
+	int dcounter = 0;
+	hazard_pointer::domain domain(1);
+	std::atomic<Counted*> shared = new Counted(&dcounter, 1);
+
+	SECTION("Protected objects are kept alive")
+	{
+		auto guard = domain.make_guard();
+		Counted* protected_value = guard.protect(shared);
+		domain.retire(shared.exchange(new Counted(&dcounter, 2)));
+		domain.collect();
+		REQUIRE(dcounter == 0);
+		REQUIRE(protected_value->m_value == 1);
+
+		guard.reset_protection();
+		domain.collect();
+		REQUIRE(dcounter == 1);
+	}
+	SECTION("Only protected objects are kept alive")
+	{
+		auto guard = domain.make_guard();
+		guard.protect(shared);
+		domain.retire(shared.exchange(new Counted(&dcounter, 2)));
+		domain.retire(shared.exchange(new Counted(&dcounter, 3)));
+		domain.collect();
+		REQUIRE(dcounter == 1);
+		REQUIRE(domain.pending() == 1);
+	}
+	SECTION("Try protect")
+	{
+		auto guard = domain.make_guard();
+		Counted* stale = shared.load();
+		domain.retire(shared.exchange(new Counted(&dcounter, 2)));
+		REQUIRE(!guard.try_protect(stale, shared));
+		REQUIRE(guard.try_protect(stale, shared));
+		REQUIRE(stale->m_value == 2);
+	}
+	SECTION("Many guards")
+	{
+		std::vector<hazard_pointer::guard> guards;
+		for (int i = 0; i < 20; ++i)
+		{
+			guards.push_back(domain.make_guard());
+		}
+		guards.back().protect(shared);
+		domain.retire(shared.exchange(new Counted(&dcounter, 2)));
+		domain.collect();
+		REQUIRE(dcounter == 0);
+	}
+	SECTION("Spilled dynamic values")
+	{
+		auto value = make_dynamic_value<Counted, SpilledCounted>(&dcounter, 5);
+		std::atomic<Counted*> spilled = &value.get();
+
+		auto guard = domain.make_guard();
+		REQUIRE(guard.protect(spilled)->m_value == 5);
+		domain.retire(std::move(value));
+		domain.collect();
+		REQUIRE(dcounter == 0);
+
+		guard.reset_protection();
+		domain.collect();
+		REQUIRE(dcounter == 1);
+	}
+
+	delete shared.load();
+}
+
+TEST_CASE("Hazard pointer memory stays bounded with a stalled reader")
+{
+	std::atomic<int> live = 0;
+	hazard_pointer::domain domain;
+	std::atomic<LiveCounted*> shared = new LiveCounted(live);
+
+	std::atomic<bool> protecting = false;
+	std::atomic<bool> release = false;
+	std::thread stalled_reader([&]()
+	{
+		auto guard = domain.make_guard();
+		guard.protect(shared);
+		protecting = true;
+		while (!release)
+		{
+			std::this_thread::yield();
+		}
+	});
+	while (!protecting)
+	{
+		std::this_thread::yield();
+	}
+
+	int max_live = 0;
+	for (int i = 0; i < 100000; ++i)
+	{
+		domain.retire(shared.exchange(new LiveCounted(live)));
+		max_live = std::max(max_live, live.load());
+	}
+
+	// Two threads with eight slots each, so a scan happens at the latest every 32 retired objects
+	REQUIRE(max_live <= 34);
+
+	release = true;
+	stalled_reader.join();
+	domain.collect();
+	REQUIRE(live == 1);
+	delete shared.load();
+}
+
+TEST_CASE("Hazard pointer concurrent readers and writers")
+{
+	struct Node
+	{
+		int value;
+	};
+
+	hazard_pointer::domain domain;
+	std::atomic<Node*> shared = new Node{ 0 };
+	std::atomic<int> errors = 0;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			auto guard = domain.make_guard();
+			for (int i = 1; i <= 5000; ++i)
+			{
+				Node* node = guard.protect(shared);
+				if (node->value < 0)
+				{
+					errors += 1;
+				}
+				guard.reset_protection();
+				if (i % 4 == t)
+				{
+					domain.retire(shared.exchange(new Node{ i }));
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	delete shared.load();
+	REQUIRE(errors == 0);
+}
+
+TEST_CASE("Hazard pointer objects retired by exited threads")
+{
+	struct Node
+	{
+		int value;
+	};
+
+	hazard_pointer::domain domain(1);
+	std::atomic<Node*> shared = new Node{ 0 };
+
+	SECTION("Protected objects are kept alive")
+	{
+		auto guard = domain.make_guard();
+		Node* protected_value = guard.protect(shared);
+		std::thread([&]()
+		{
+			domain.retire(shared.exchange(new Node{ 1 }));
+		}).join();
+		domain.collect();
+		REQUIRE(domain.pending() == 1);
+		REQUIRE(protected_value->value == 0);
+
+		guard.reset_protection();
+		domain.collect();
+		REQUIRE(domain.pending() == 0);
+	}
+	SECTION("Concurrent reader")
+	{
+		std::atomic<bool> done = false;
+		std::atomic<int> errors = 0;
+		std::thread reader([&]()
+		{
+			auto guard = domain.make_guard();
+			while (!done)
+			{
+				if (guard.protect(shared)->value < 0)
+				{
+					errors += 1;
+				}
+				guard.reset_protection();
+			}
+		});
+		std::thread collector([&]()
+		{
+			while (!done)
+			{
+				domain.collect();
+			}
+		});
+		for (int i = 1; i <= 200; ++i)
+		{
+			std::thread([&, i]()
+			{
+				domain.retire(shared.exchange(new Node{ i }));
+			}).join();
+		}
+		done = true;
+		reader.join();
+		collector.join();
+		REQUIRE(errors == 0);
+	}
+
+	delete shared.load();
+}
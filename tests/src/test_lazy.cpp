@@ -0,0 +1,109 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gravel/lazy.hpp"
+
+using namespace gravel;
+
+// The producer and the value share their storage
+static_assert(sizeof(lazy<std::array<char, 40>>) < sizeof(unique_function<std::array<char, 40>()>) + 40);
+
+TEST_CASE("lazy computes its value once, on first access")
+{
+	int calls = 0;
+	lazy<std::string> text([&calls]() { ++calls; return std::string("computed once"); });
+	REQUIRE(!text.is_ready());
+	REQUIRE(calls == 0);
+
+	REQUIRE(*text == "computed once");
+	REQUIRE(text->size() == 13);
+	const lazy<std::string>& view = text;
+	REQUIRE(view.get() == "computed once");
+	REQUIRE(text.is_ready());
+	REQUIRE(calls == 1);
+
+	// Computing through a const object is fine as well, the state it changes is mutable
+	const lazy<int> constant([]() { return 7; });
+	REQUIRE(*constant == 7);
+	REQUIRE(constant.is_ready());
+}
+
+TEST_CASE("lazy destroys its producer or its value")
+{
+	auto tracker = std::make_shared<int>(0);
+	{
+		lazy<int> unread([tracker]() { return 1; });
+		REQUIRE(tracker.use_count() == 2);
+	}
+	REQUIRE(tracker.use_count() == 1);
+	{
+		lazy<std::shared_ptr<int>> read([tracker]() { return tracker; });
+		REQUIRE(tracker.use_count() == 2);
+		// The producer is replaced by the value, which holds the same reference
+		REQUIRE(read.get() == tracker);
+		REQUIRE(tracker.use_count() == 2);
+	}
+	REQUIRE(tracker.use_count() == 1);
+}
+
+TEST_CASE("lazy can be moved before and after computing")
+{
+	lazy<std::vector<int>> pending([]() { return std::vector<int>{ 1, 2, 3 }; });
+	lazy<std::vector<int>> moved(std::move(pending));
+	REQUIRE(!moved.is_ready());
+	REQUIRE(moved->size() == 3);
+
+	lazy<std::vector<int>> ready(std::move(moved));
+	REQUIRE(ready.is_ready());
+	REQUIRE(ready.get() == std::vector<int>{ 1, 2, 3 });
+}
+
+TEST_CASE("lazy runs its producer again after it threw")
+{
+	int calls = 0;
+	lazy<int> flaky([&calls]() { if (++calls == 1) { throw std::runtime_error("Not yet"); } return 7; });
+	REQUIRE_THROWS_AS(flaky.get(), std::runtime_error);
+	REQUIRE(!flaky.is_ready());
+	REQUIRE(flaky.get() == 7);
+	REQUIRE(calls == 2);
+
+	atomic_lazy<int> shared_flaky([&calls]() { if (++calls == 3) { throw std::runtime_error("Not yet"); } return 8; });
+	REQUIRE_THROWS_AS(shared_flaky.get(), std::runtime_error);
+	REQUIRE(shared_flaky.get() == 8);
+	REQUIRE(calls == 4);
+}
+
+TEST_CASE("atomic_lazy computes its value once for all threads")
+{
+	for (int round = 0; round < 100; ++round)
+	{
+		std::atomic<int> calls{ 0 };
+		atomic_lazy<std::vector<int>> numbers([&calls]()
+		{
+			calls.fetch_add(1);
+			std::this_thread::yield();
+			return std::vector<int>(100, 42);
+		});
+
+		std::atomic<int> sum{ 0 };
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t)
+		{
+			threads.emplace_back([&]() { sum.fetch_add(numbers.get()[99]); });
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		REQUIRE(calls == 1);
+		REQUIRE(sum == 4 * 42);
+		REQUIRE(numbers.is_ready());
+	}
+}
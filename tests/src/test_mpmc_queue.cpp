@@ -0,0 +1,179 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gravel/mpmc_queue.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Counted
+	{
+	public:
+		Counted(int* destructor_counter, int value)
+			: m_destructor_counter(destructor_counter)
+			, m_value(value)
+		{
+
+		}
+
+		Counted(Counted&& other) noexcept
+			: m_destructor_counter(std::exchange(other.m_destructor_counter, nullptr))
+			, m_value(other.m_value)
+		{
+
+		}
+
+		~Counted()
+		{
+			if (m_destructor_counter)
+			{
+				*m_destructor_counter += 1;
+			}
+		}
+
+		int* m_destructor_counter;
+		int m_value;
+	};
+}
+
+TEST_CASE("MPMC queue basics")
+{
+	mpmc_queue<std::string> queue(1);
+	REQUIRE(queue.capacity() == 2);
+	REQUIRE(queue.size() == 0);
+	REQUIRE(!queue.try_pop());
+
+	REQUIRE(queue.try_push(std::string("first")));
+	REQUIRE(queue.try_emplace("second"));
+	std::string rejected = "third";
+	REQUIRE(!queue.try_push(std::move(rejected)));
+	REQUIRE(rejected == "third");
+	REQUIRE(queue.size() == 2);
+
+	REQUIRE(queue.try_pop() == "first");
+	queue.push(std::move(rejected));
+	REQUIRE(queue.pop() == "second");
+	REQUIRE(queue.pop() == "third");
+	REQUIRE(!queue.try_pop());
+}
+
+TEST_CASE("MPMC queue of functions")
+{
+	mpmc_queue<unique_function<void()>> queue(16);
+	std::vector<int> order;
+	for (int i = 0; i < 10; ++i)
+	{
+		queue.emplace([&order, i]() { order.push_back(i); });
+	}
+	while (auto task = queue.try_pop())
+	{
+		(*task)();
+	}
+	REQUIRE(order == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+}
+
+TEST_CASE("MPMC queue destroys remaining elements")
+{
+	int dcounter = 0;
+	{
+		mpmc_queue<Counted> queue(4);
+		queue.emplace(&dcounter, 1);
+		queue.emplace(&dcounter, 2);
+		queue.emplace(&dcounter, 3);
+		REQUIRE(queue.try_pop()->m_value == 1);
+		REQUIRE(dcounter == 1);
+	}
+	REQUIRE(dcounter == 3);
+}
+
+TEST_CASE("MPMC queue blocking operations wait for each other")
+{
+	mpmc_queue<int> queue(2);
+
+	SECTION("Pop waits for a push")
+	{
+		std::thread consumer([&queue]() { REQUIRE(queue.pop() == 42); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		queue.push(42);
+		consumer.join();
+	}
+	SECTION("Push waits for a pop")
+	{
+		queue.push(1);
+		queue.push(2);
+		std::thread producer([&queue]() { queue.push(3); });
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		REQUIRE(queue.pop() == 1);
+		REQUIRE(queue.pop() == 2);
+		REQUIRE(queue.pop() == 3);
+		producer.join();
+	}
+}
+
+TEST_CASE("MPMC queue concurrent producers and consumers")
+{
+	const int producer_count = 3;
+	const int consumer_count = 3;
+	const int per_producer = 20000;
+
+	mpmc_queue<int> queue(64);
+	std::atomic<long long> sum = 0;
+	std::vector<std::thread> threads;
+	for (int p = 0; p < producer_count; ++p)
+	{
+		threads.emplace_back([&queue, p]()
+		{
+			for (int i = 1; i <= per_producer; ++i)
+			{
+				// Mix the blocking and non-blocking operations, they must be able to share a queue
+				if (i % 2 == 0)
+				{
+					queue.push(int(i));
+				}
+				else
+				{
+					while (!queue.try_push(int(i)))
+					{
+						std::this_thread::yield();
+					}
+				}
+			}
+		});
+	}
+	for (int c = 0; c < consumer_count; ++c)
+	{
+		threads.emplace_back([&queue, &sum, c]()
+		{
+			for (int i = 0; i < per_producer; ++i)
+			{
+				if (c % 2 == 0)
+				{
+					sum += queue.pop();
+				}
+				else
+				{
+					std::optional<int> value;
+					while (!(value = queue.try_pop()))
+					{
+						std::this_thread::yield();
+					}
+					sum += *value;
+				}
+			}
+		});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	REQUIRE(sum == producer_count * (static_cast<long long>(per_producer) * (per_producer + 1) / 2));
+	REQUIRE(queue.size() == 0);
+}
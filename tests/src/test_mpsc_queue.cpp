@@ -0,0 +1,185 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gravel/mpsc_queue.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Counted
+	{
+	public:
+		Counted(int* destructor_counter, int value)
+			: m_destructor_counter(destructor_counter)
+			, m_value(value)
+		{
+
+		}
+
+		Counted(Counted&& other) noexcept
+			: m_destructor_counter(std::exchange(other.m_destructor_counter, nullptr))
+			, m_value(other.m_value)
+		{
+
+		}
+
+		~Counted()
+		{
+			if (m_destructor_counter)
+			{
+				*m_destructor_counter += 1;
+			}
+		}
+
+		int* m_destructor_counter;
+		int m_value;
+	};
+
+	struct ThrowingConstructor
+	{
+		ThrowingConstructor(bool fail)
+		{
+			if (fail)
+			{
+				throw std::runtime_error("construct");
+			}
+		}
+	};
+}
+
+TEST_CASE("MPSC queue basics")
+{
+	mpsc_queue<std::string> queue;
+	REQUIRE(queue.empty());
+	REQUIRE(!queue.try_pop());
+
+	queue.push(std::string("first"));
+	queue.emplace("second");
+	REQUIRE(!queue.empty());
+	REQUIRE(queue.try_pop() == "first");
+	REQUIRE(queue.try_pop() == "second");
+	REQUIRE(!queue.try_pop());
+}
+
+TEST_CASE("MPSC queue of functions")
+{
+	mpsc_queue<unique_function<void()>> queue;
+	std::vector<int> order;
+
+	for (int i = 0; i < 10; ++i)
+	{
+		queue.emplace([&order, i]() { order.push_back(i); });
+	}
+
+	SECTION("Consume all")
+	{
+		REQUIRE(queue.consume([](unique_function<void()>&& task) { task(); }) == 10);
+		REQUIRE(order == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+	}
+	SECTION("Consume in batches")
+	{
+		REQUIRE(queue.consume([](unique_function<void()>&& task) { task(); }, 4) == 4);
+		REQUIRE(order.size() == 4);
+		REQUIRE(queue.consume([](unique_function<void()>&& task) { task(); }, 4) == 4);
+		REQUIRE(queue.consume([](unique_function<void()>&& task) { task(); }, 4) == 2);
+		REQUIRE(order == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+	}
+}
+
+TEST_CASE("MPSC queue destroys remaining elements")
+{
+	int dcounter = 0;
+	{
+		mpsc_queue<Counted> queue;
+		queue.emplace(&dcounter, 1);
+		queue.emplace(&dcounter, 2);
+		queue.emplace(&dcounter, 3);
+		REQUIRE(queue.try_pop()->m_value == 1);
+		REQUIRE(dcounter == 1);
+	}
+	REQUIRE(dcounter == 3);
+}
+
+TEST_CASE("MPSC queue consumes the element a throwing function was called with")
+{
+	int dcounter = 0;
+	{
+		mpsc_queue<Counted> queue;
+		for (int i = 0; i < 4; ++i)
+		{
+			queue.emplace(&dcounter, i);
+		}
+
+		std::vector<int> seen;
+		REQUIRE_THROWS_AS(queue.consume([&seen](Counted&& counted)
+		{
+			seen.push_back(counted.m_value);
+			if (counted.m_value == 1)
+			{
+				throw std::runtime_error("consume");
+			}
+		}), std::runtime_error);
+		REQUIRE(seen == std::vector<int>{ 0, 1 });
+		REQUIRE(dcounter == 2);
+
+		auto next = queue.try_pop();
+		REQUIRE(next);
+		REQUIRE(next->m_value == 2);
+	}
+	REQUIRE(dcounter == 4);
+}
+
+TEST_CASE("MPSC queue pushes nothing if the constructor of an element throws")
+{
+	mpsc_queue<ThrowingConstructor> queue;
+	REQUIRE_THROWS_AS(queue.emplace(true), std::runtime_error);
+	REQUIRE(queue.empty());
+
+	queue.emplace(false);
+	REQUIRE(queue.try_pop());
+	REQUIRE(queue.empty());
+}
+
+TEST_CASE("MPSC queue concurrent producers")
+{
+	const int producer_count = 4;
+	const int per_producer = 20000;
+
+	mpsc_queue<std::pair<int, int>> queue;
+	std::vector<std::thread> producers;
+	for (int p = 0; p < producer_count; ++p)
+	{
+		producers.emplace_back([&queue, p]()
+		{
+			for (int i = 0; i < per_producer; ++i)
+			{
+				queue.emplace(p, i);
+			}
+		});
+	}
+
+	std::vector<int> next_expected(producer_count, 0);
+	int consumed = 0;
+	bool ordered = true;
+	while (consumed < producer_count * per_producer)
+	{
+		consumed += static_cast<int>(queue.consume([&](std::pair<int, int>&& item)
+		{
+			ordered = ordered && item.second == next_expected[item.first];
+			next_expected[item.first] = item.second + 1;
+		}, 64));
+	}
+	for (auto& producer : producers)
+	{
+		producer.join();
+	}
+
+	REQUIRE(ordered);
+	REQUIRE(queue.empty());
+}
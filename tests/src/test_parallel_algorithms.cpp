@@ -0,0 +1,272 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "gravel/dynamic_value.hpp"
+#include "gravel/parallel_algorithms.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Shape
+	{
+	public:
+		virtual ~Shape() = default;
+		virtual double area() const = 0;
+	};
+
+	class Square : public Shape
+	{
+	public:
+		explicit Square(double side)
+			: m_side(side)
+		{
+		}
+
+		double area() const override
+		{
+			return m_side * m_side;
+		}
+
+	private:
+		double m_side;
+	};
+
+	class Circle : public Shape
+	{
+	public:
+		explicit Circle(double radius)
+			: m_radius(radius)
+		{
+		}
+
+		double area() const override
+		{
+			return 3.0 * m_radius * m_radius;
+		}
+
+	private:
+		double m_radius;
+	};
+
+	using ShapeValue = dynamic_value<Shape, Properties<Attr::Movable>>;
+}
+
+TEST_CASE("Parallel for")
+{
+	thread_pool pool(4);
+
+	SECTION("Over indices")
+	{
+		std::vector<std::atomic<int>> visits(10000);
+		parallel_for(pool, 0, 10000, [&visits](int i) { visits[i] += 1; });
+		REQUIRE(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& count) { return count.load() == 1; }));
+	}
+	SECTION("Over an offset index range with a fixed grain")
+	{
+		std::vector<int> values(100, 0);
+		parallel_for(pool, std::size_t(10), std::size_t(90), [&values](std::size_t i) { values[i] = 1; }, 7);
+		REQUIRE(std::accumulate(values.begin(), values.end(), 0) == 80);
+		REQUIRE(values[9] == 0);
+		REQUIRE(values[10] == 1);
+		REQUIRE(values[89] == 1);
+		REQUIRE(values[90] == 0);
+	}
+	SECTION("Over elements")
+	{
+		std::vector<int> values(5000, 1);
+		parallel_for(pool, values.begin(), values.end(), [](int& value) { value *= 3; });
+		REQUIRE(std::all_of(values.begin(), values.end(), [](int value) { return value == 3; }));
+	}
+	SECTION("Empty ranges")
+	{
+		std::vector<int> values;
+		parallel_for(pool, 5, 5, [](int) { FAIL(); });
+		parallel_for(pool, values.begin(), values.end(), [](int) { FAIL(); });
+	}
+}
+
+TEST_CASE("Parallel transform and reduce over dynamic values")
+{
+	thread_pool pool(4);
+
+	std::vector<ShapeValue> shapes;
+	for (int i = 0; i < 3000; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			shapes.emplace_back(ShapeValue::make_emplaced<Square>(double(i % 10)));
+		}
+		else
+		{
+			shapes.emplace_back(ShapeValue::make_emplaced<Circle>(double(i % 10)));
+		}
+	}
+
+	std::vector<double> areas(shapes.size());
+	REQUIRE(parallel_transform(pool, shapes.begin(), shapes.end(), areas.begin(), [](const ShapeValue& shape) { return shape->area(); }) == areas.end());
+	for (std::size_t i = 0; i < shapes.size(); ++i)
+	{
+		REQUIRE(areas[i] == shapes[i]->area());
+	}
+
+	const double expected = std::accumulate(areas.begin(), areas.end(), 0.0);
+	REQUIRE(parallel_reduce(pool, areas.begin(), areas.end(), 0.0) == expected);
+	REQUIRE(parallel_reduce(pool, areas.begin(), areas.end(), 1.0, [](double a, double b) { return std::max(a, b); }) == 243.0);
+	REQUIRE(parallel_reduce(pool, areas.begin(), areas.begin(), 5.0) == 5.0);
+	REQUIRE(parallel_transform_reduce(pool, shapes.begin(), shapes.end(), 0.0, std::plus<>(), [](const ShapeValue& shape) { return shape->area(); }) == expected);
+
+	// Non-commutative types still reduce to the right elements, just in an unspecified order
+	std::vector<std::string> words(200, "a");
+	REQUIRE(parallel_reduce(pool, words.begin(), words.end(), std::string(), std::plus<>(), 16).size() == 200);
+}
+
+TEST_CASE("Parallel sort")
+{
+	thread_pool pool(4);
+
+	SECTION("Plain data")
+	{
+		std::vector<std::uint32_t> values(100000);
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			values[i] = static_cast<std::uint32_t>(i * 2654435761u);
+		}
+		std::vector<std::uint32_t> expected = values;
+		std::sort(expected.begin(), expected.end());
+		parallel_sort(pool, values.begin(), values.end());
+		REQUIRE(values == expected);
+	}
+	SECTION("Many equal elements")
+	{
+		std::vector<int> values(50000);
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			values[i] = static_cast<int>((i * 7919) % 3);
+		}
+		parallel_sort(pool, values.begin(), values.end(), std::greater<>());
+		REQUIRE(std::is_sorted(values.begin(), values.end(), std::greater<>()));
+	}
+	SECTION("Adversarial comparisons")
+	{
+		// McIlroy's adversary: values are only fixed once compared against the pivot candidate, which forces every
+		// partition to split off a single element, and a plain quicksort to take quadratic time
+		const int size = 50000;
+		std::vector<int> order(size);
+		std::iota(order.begin(), order.end(), 0);
+		std::vector<int> values(size, size);
+		int frozen = 0;
+		int candidate = 0;
+		std::size_t comparisons = 0;
+		std::mutex mutex;
+		parallel_sort(pool, order.begin(), order.end(), [&](int a, int b)
+		{
+			std::lock_guard lock(mutex);
+			++comparisons;
+			if (values[a] == size && values[b] == size)
+			{
+				values[a == candidate ? a : b] = frozen++;
+			}
+			if (values[a] == size)
+			{
+				candidate = a;
+			}
+			else if (values[b] == size)
+			{
+				candidate = b;
+			}
+			return values[a] < values[b];
+		});
+		REQUIRE(std::is_sorted(order.begin(), order.end(), [&](int a, int b) { return values[a] < values[b]; }));
+		// A quadratic sort takes over a billion comparisons here, n log n about a million times a small constant
+		REQUIRE(comparisons < 20 * std::size_t(size) * std::bit_width(std::size_t(size)));
+	}
+	SECTION("Dynamic values")
+	{
+		std::vector<ShapeValue> shapes;
+		for (int i = 0; i < 5000; ++i)
+		{
+			shapes.emplace_back(ShapeValue::make_emplaced<Square>(double((i * 31) % 101)));
+		}
+		parallel_sort(pool, shapes.begin(), shapes.end(), [](const ShapeValue& a, const ShapeValue& b) { return a->area() < b->area(); });
+		REQUIRE(std::is_sorted(shapes.begin(), shapes.end(), [](const ShapeValue& a, const ShapeValue& b) { return a->area() < b->area(); }));
+	}
+}
+
+TEST_CASE("Parallel algorithms nest inside tasks")
+{
+	thread_pool pool(2);
+	std::atomic<int> total = 0;
+	parallel_for(pool, 0, 8, [&](int)
+	{
+		std::vector<int> values(1000, 1);
+		total += parallel_reduce(pool, values.begin(), values.end(), 0);
+	}, 1);
+	REQUIRE(total == 8000);
+}
+
+TEST_CASE("Parallel algorithms rethrow exceptions from the callables")
+{
+	thread_pool pool(4);
+
+	SECTION("From parallel_for")
+	{
+		std::atomic<int> calls = 0;
+		REQUIRE_THROWS_AS(parallel_for(pool, 0, 10000, [&calls](int i)
+		{
+			calls += 1;
+			if (i % 1000 == 999)
+			{
+				throw std::runtime_error("index");
+			}
+		}, 10), std::runtime_error);
+		REQUIRE(calls > 0);
+	}
+	SECTION("From parallel_transform_reduce")
+	{
+		std::vector<int> values(5000, 1);
+		values[4321] = -1;
+		REQUIRE_THROWS_AS(parallel_transform_reduce(pool, values.begin(), values.end(), 0, std::plus<>(), [](int value)
+		{
+			if (value < 0)
+			{
+				throw std::invalid_argument("negative");
+			}
+			return value;
+		}), std::invalid_argument);
+	}
+	SECTION("From parallel_sort")
+	{
+		std::vector<int> values(20000);
+		std::iota(values.rbegin(), values.rend(), 0);
+		std::atomic<int> comparisons = 0;
+		REQUIRE_THROWS_AS(parallel_sort(pool, values.begin(), values.end(), [&comparisons](int a, int b)
+		{
+			if (++comparisons == 30000)
+			{
+				throw std::runtime_error("compare");
+			}
+			return a < b;
+		}), std::runtime_error);
+		// The elements are only reordered, never lost
+		std::sort(values.begin(), values.end());
+		for (int i = 0; i < int(values.size()); ++i)
+		{
+			REQUIRE(values[i] == i);
+		}
+	}
+
+	// The pool is still usable afterwards
+	std::vector<std::atomic<int>> visits(1000);
+	parallel_for(pool, 0, 1000, [&visits](int i) { visits[i] += 1; });
+	REQUIRE(std::all_of(visits.begin(), visits.end(), [](const std::atomic<int>& count) { return count.load() == 1; }));
+}
@@ -0,0 +1,61 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "gravel/pipeline.hpp"
+
+using namespace gravel;
+
+TEST_CASE("compose applies stages in the order they are given")
+{
+	auto add_one = [](int value) { return value + 1; };
+	auto twice = [](int value) { return value * 2; };
+	auto fused = compose(add_one, twice, [](int value) { return std::to_string(value); });
+	static_assert(std::is_same_v<decltype(fused(1)), std::string>);
+	REQUIRE(fused(4) == "10");
+	REQUIRE(compose(twice, add_one)(4) == 9);
+
+	// The first stage takes all arguments
+	REQUIRE(compose([](int a, int b) { return a * b; }, add_one)(3, 4) == 13);
+
+	const auto constant = compose(add_one);
+	REQUIRE(constant(1) == 2);
+}
+
+TEST_CASE("compose keeps the state of its stages")
+{
+	auto counting = compose([count = 0](int value) mutable { return value + ++count; }, [](int value) { return value * 10; });
+	REQUIRE(counting(0) == 10);
+	REQUIRE(counting(0) == 20);
+
+	// Move-only stages make a move-only result, which still fits a unique_function
+	auto owning = compose([owned = std::make_unique<int>(5)](int value) { return value + *owned; }, [](int value) { return -value; });
+	unique_function<int(int)> function(std::move(owning));
+	REQUIRE(function(1) == -6);
+}
+
+TEST_CASE("compose passes references through")
+{
+	std::vector<int> values{ 3, 1, 2 };
+	auto& result = compose([](std::vector<int>& v) -> std::vector<int>& { v.push_back(4); return v; },
+		[](std::vector<int>& v) -> std::vector<int>& { v.erase(v.begin()); return v; })(values);
+	REQUIRE(&result == &values);
+	REQUIRE(values == std::vector<int>{ 1, 2, 4 });
+}
+
+TEST_CASE("pipeline fuses the stages of each then into one")
+{
+	pipeline<std::string> text;
+	REQUIRE(text("same") == "same");
+
+	auto exclaim = [](std::string value) { return value + "!"; };
+	text.then([](std::string value) { return "<" + value; }, [](std::string value) { return value + ">"; })
+		.then(exclaim)
+		.then(unique_function<std::string(std::string)>([](std::string value) { return value + "?"; }));
+	REQUIRE(text.size() == 3);
+	REQUIRE(text("a") == "<a>!?");
+	REQUIRE(text("b") == "<b>!?");
+}
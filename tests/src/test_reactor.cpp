@@ -0,0 +1,267 @@
+#include "catch2/catch_test_macros.hpp"
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "gravel/reactor.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	//!
+	//! Both ends of a pipe, closed on destruction
+	//!
+	struct Pipe
+	{
+		Pipe()
+		{
+			REQUIRE(::pipe(fds) == 0);
+		}
+
+		~Pipe()
+		{
+			::close(fds[0]);
+			::close(fds[1]);
+		}
+
+		int read_end() const
+		{
+			return fds[0];
+		}
+
+		int write_end() const
+		{
+			return fds[1];
+		}
+
+		int fds[2];
+	};
+
+	void write_byte(int fd, char value = 'x')
+	{
+		REQUIRE(::write(fd, &value, 1) == 1);
+	}
+
+	char read_byte(int fd)
+	{
+		char value = 0;
+		REQUIRE(::read(fd, &value, 1) == 1);
+		return value;
+	}
+}
+
+TEST_CASE("reactor calls the handler of a readable pipe with the ready events")
+{
+	reactor loop;
+	Pipe pipe;
+	std::vector<char> received;
+	std::uint32_t seen = 0;
+	loop.add(pipe.read_end(), EPOLLIN, [&](std::uint32_t events)
+	{
+		seen = events;
+		received.push_back(read_byte(pipe.read_end()));
+	});
+	REQUIRE(loop.size() == 1);
+
+	REQUIRE(loop.run_once(0) == 0);
+	write_byte(pipe.write_end(), 'a');
+	REQUIRE(loop.run_once(1000) == 1);
+	REQUIRE((seen & EPOLLIN) != 0);
+	REQUIRE(received == std::vector<char>{ 'a' });
+}
+
+TEST_CASE("reactor modify changes the events waited for")
+{
+	reactor loop;
+	int sockets[2];
+	REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) == 0);
+	int writable = 0;
+	int readable = 0;
+	reactor::handle registration = loop.add(sockets[0], EPOLLOUT, [&](std::uint32_t events)
+	{
+		writable += (events & EPOLLOUT) != 0;
+		readable += (events & EPOLLIN) != 0;
+	});
+
+	REQUIRE(loop.run_once(0) == 1);
+	REQUIRE(writable == 1);
+
+	REQUIRE(loop.modify(registration, EPOLLIN));
+	REQUIRE(loop.run_once(0) == 0);
+	write_byte(sockets[1]);
+	REQUIRE(loop.run_once(1000) == 1);
+	REQUIRE(readable == 1);
+	REQUIRE(writable == 1);
+
+	REQUIRE(loop.remove(registration));
+	REQUIRE(!loop.modify(registration, EPOLLIN));
+	::close(sockets[0]);
+	::close(sockets[1]);
+}
+
+TEST_CASE("reactor remove destroys the handler and makes the handle stale")
+{
+	reactor loop;
+	Pipe pipe;
+	auto tracked = std::make_shared<int>(0);
+	int calls = 0;
+	reactor::handle registration = loop.add(pipe.read_end(), EPOLLIN, [tracked, &calls](std::uint32_t) { ++calls; });
+	REQUIRE(tracked.use_count() == 2);
+
+	REQUIRE(loop.remove(registration));
+	REQUIRE(tracked.use_count() == 1);
+	REQUIRE(loop.size() == 0);
+	REQUIRE(!loop.remove(registration));
+	REQUIRE(!loop.remove(reactor::handle()));
+
+	write_byte(pipe.write_end());
+	REQUIRE(loop.run_once(0) == 0);
+	REQUIRE(calls == 0);
+
+	// The slot is reused with a new generation
+	reactor::handle second = loop.add(pipe.read_end(), EPOLLIN, [&calls](std::uint32_t) { ++calls; });
+	REQUIRE(!(second == registration));
+	REQUIRE(loop.run_once(1000) == 1);
+	REQUIRE(calls == 1);
+}
+
+TEST_CASE("reactor handlers may remove themselves and others of the same batch")
+{
+	reactor loop;
+	Pipe first_pipe;
+	Pipe second_pipe;
+	auto tracked = std::make_shared<int>(0);
+	int calls = 0;
+	reactor::handle first;
+	reactor::handle second;
+	// Both are ready in the same batch, whichever runs first removes both
+	first = loop.add(first_pipe.read_end(), EPOLLIN, [&, tracked](std::uint32_t)
+	{
+		++calls;
+		REQUIRE(loop.remove(first));
+		REQUIRE(tracked.use_count() == 3);
+		REQUIRE(loop.remove(second));
+	});
+	second = loop.add(second_pipe.read_end(), EPOLLIN, [&, tracked](std::uint32_t)
+	{
+		++calls;
+		REQUIRE(loop.remove(second));
+		REQUIRE(tracked.use_count() == 3);
+		REQUIRE(loop.remove(first));
+	});
+	write_byte(first_pipe.write_end());
+	write_byte(second_pipe.write_end());
+
+	REQUIRE(loop.run_once(1000) == 1);
+	REQUIRE(calls == 1);
+	REQUIRE(tracked.use_count() == 1);
+	REQUIRE(loop.size() == 0);
+}
+
+TEST_CASE("reactor handlers may add registrations")
+{
+	reactor loop;
+	Pipe first_pipe;
+	Pipe second_pipe;
+	std::vector<int> order;
+	std::vector<int> duplicates;
+	loop.add(first_pipe.read_end(), EPOLLIN | EPOLLET, [&](std::uint32_t)
+	{
+		order.push_back(1);
+		read_byte(first_pipe.read_end());
+		for (int i = 0; i < 100; ++i)
+		{
+			duplicates.push_back(::dup(second_pipe.read_end()));
+			loop.add(duplicates.back(), EPOLLIN, [](std::uint32_t) {});
+		}
+		loop.add(second_pipe.read_end(), EPOLLIN, [&](std::uint32_t)
+		{
+			order.push_back(2);
+			read_byte(second_pipe.read_end());
+		});
+	});
+	write_byte(first_pipe.write_end());
+	REQUIRE(loop.run_once(1000) == 1);
+	REQUIRE(loop.size() == 102);
+
+	write_byte(second_pipe.write_end());
+	loop.run_once(1000);
+	REQUIRE(order == std::vector<int>{ 1, 2 });
+	for (int fd : duplicates)
+	{
+		::close(fd);
+	}
+}
+
+TEST_CASE("reactor runs posted tasks on the loop thread")
+{
+	reactor loop;
+	int runs = 0;
+	loop.post([&runs]() { ++runs; });
+	loop.post([&runs]() { ++runs; });
+	REQUIRE(loop.run_once(1000) == 2);
+	REQUIRE(runs == 2);
+	REQUIRE(loop.run_once(0) == 0);
+}
+
+TEST_CASE("reactor runs a task posted by a task on a later iteration")
+{
+	reactor loop;
+	int runs = 0;
+	loop.post([&]()
+	{
+		++runs;
+		loop.post([&runs]() { ++runs; });
+	});
+	REQUIRE(loop.run_once(1000) == 1);
+	REQUIRE(runs == 1);
+	REQUIRE(loop.run_once(1000) == 1);
+	REQUIRE(runs == 2);
+}
+
+TEST_CASE("reactor run returns once stopped from another thread")
+{
+	reactor loop;
+	constexpr int producers = 4;
+	constexpr int per_producer = 10000;
+	std::atomic<bool> outside{ false };
+	const std::thread::id loop_thread = std::this_thread::get_id();
+	int runs = 0;
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < producers; ++i)
+	{
+		threads.emplace_back([&]()
+		{
+			for (int j = 0; j < per_producer; ++j)
+			{
+				loop.post([&]()
+				{
+					outside = outside || std::this_thread::get_id() != loop_thread;
+					if (++runs == producers * per_producer)
+					{
+						loop.stop();
+					}
+				});
+			}
+		});
+	}
+	loop.run();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+	REQUIRE(runs == producers * per_producer);
+	REQUIRE(!outside);
+}
+
+#endif
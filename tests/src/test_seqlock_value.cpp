@@ -0,0 +1,228 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <typeinfo>
+#include <vector>
+
+#include "gravel/seqlock_value.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	struct Pair
+	{
+		std::int64_t first;
+		std::int64_t second;
+	};
+
+	class Limit
+	{
+	public:
+		Limit(int limit)
+			: m_limit(limit)
+		{
+
+		}
+
+		virtual ~Limit() = default;
+
+		virtual bool allows(int value) const
+		{
+			return value <= m_limit;
+		}
+
+		int m_limit;
+	};
+
+	class ExclusiveLimit : public Limit
+	{
+	public:
+		ExclusiveLimit(int limit)
+			: Limit(limit)
+		{
+
+		}
+
+		bool allows(int value) const override
+		{
+			return value < m_limit;
+		}
+	};
+
+	class LargeLimit : public Limit
+	{
+	public:
+		LargeLimit(int limit)
+			: Limit(limit)
+		{
+
+		}
+
+		std::array<std::uint8_t, 64> m_padding;
+	};
+
+	class CountedLimit : public Limit
+	{
+	public:
+		CountedLimit(int limit)
+			: Limit(limit)
+		{
+
+		}
+
+		~CountedLimit() override
+		{
+			s_destroyed += 1;
+		}
+
+		static inline int s_destroyed = 0;
+	};
+
+	struct Owning
+	{
+		~Owning()
+		{
+		}
+
+		int m_value;
+	};
+
+	class NonTrivial : public Limit
+	{
+	public:
+		NonTrivial(int limit)
+			: Limit(limit)
+		{
+
+		}
+
+		NonTrivial(const NonTrivial& other)
+			: Limit(other)
+		{
+
+		}
+	};
+}
+
+template <>
+struct gravel::is_bitwise_copyable<Limit>
+{
+	static const bool value = true;
+};
+
+template <>
+struct gravel::is_bitwise_copyable<ExclusiveLimit>
+{
+	static const bool value = true;
+};
+
+template <>
+struct gravel::is_bitwise_copyable<LargeLimit>
+{
+	static const bool value = true;
+};
+
+template <>
+struct gravel::is_bitwise_copyable<CountedLimit>
+{
+	static const bool value = true;
+};
+
+template <>
+struct gravel::is_bitwise_copyable<Owning>
+{
+	static const bool value = true;
+};
+
+TEST_CASE("Seqlock value basics")
+{
+	SECTION("Trivially copyable")
+	{
+		seqlock_value<Pair> value(Pair{ 1, 2 });
+		REQUIRE(value.load()->first == 1);
+		REQUIRE(value.load()->second == 2);
+
+		value.store(Pair{ 3, 4 });
+		REQUIRE(value.load()->first == 3);
+		REQUIRE(value.load()->second == 4);
+	}
+	SECTION("Polymorphic")
+	{
+		seqlock_value<Limit> value(Limit(5));
+		REQUIRE(value.load()->allows(5));
+
+		value.emplace<ExclusiveLimit>(5);
+		auto snapshot = value.load();
+		REQUIRE(!snapshot->allows(5));
+		REQUIRE(typeid(*snapshot) == typeid(ExclusiveLimit));
+
+		dynamic_value<Limit> copied = snapshot.to_dynamic_value();
+		REQUIRE(!copied->allows(5));
+		REQUIRE(typeid(*copied) == typeid(ExclusiveLimit));
+	}
+	SECTION("Storable types")
+	{
+		REQUIRE(seqlock_value<Limit>::storable<ExclusiveLimit>);
+		REQUIRE(!seqlock_value<Limit>::storable<LargeLimit>);
+		REQUIRE(!seqlock_value<Limit>::storable<NonTrivial>);
+		REQUIRE(seqlock_value<Limit, BufferSize<128>>::storable<LargeLimit>);
+		// Without a virtual destructor there is no way to destroy the held value
+		REQUIRE(!seqlock_value<Owning>::storable<Owning>);
+	}
+	SECTION("Destroys replaced values")
+	{
+		const int destroyed = CountedLimit::s_destroyed;
+		{
+			seqlock_value<Limit> value(Limit(5));
+			value.emplace<CountedLimit>(1);
+			// Only the temporary the value was copied from
+			REQUIRE(CountedLimit::s_destroyed == destroyed + 1);
+			REQUIRE(value.load()->allows(1));
+
+			value.store(Limit(2));
+			REQUIRE(CountedLimit::s_destroyed == destroyed + 2);
+
+			value.emplace<CountedLimit>(3);
+			REQUIRE(CountedLimit::s_destroyed == destroyed + 3);
+		}
+		REQUIRE(CountedLimit::s_destroyed == destroyed + 4);
+	}
+}
+
+TEST_CASE("Seqlock value readers never see torn values")
+{
+	seqlock_value<Pair> value(Pair{ 0, 0 });
+	std::atomic<bool> done = false;
+	std::atomic<int> errors = 0;
+	std::vector<std::thread> readers;
+	for (int i = 0; i < 4; ++i)
+	{
+		readers.emplace_back([&]()
+		{
+			while (!done)
+			{
+				auto snapshot = value.load();
+				if (snapshot->first != snapshot->second)
+				{
+					errors += 1;
+				}
+			}
+		});
+	}
+
+	for (std::int64_t i = 1; i <= 100000; ++i)
+	{
+		value.store(Pair{ i, i });
+	}
+	done = true;
+	for (auto& reader : readers)
+	{
+		reader.join();
+	}
+	REQUIRE(errors == 0);
+	REQUIRE(value.load()->first == 100000);
+}
@@ -0,0 +1,134 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gravel/signal.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+TEST_CASE("signal calls slots in the order they were connected")
+{
+	signal<void(int)> numbers;
+	std::vector<int> seen;
+	numbers.connect([&seen](int value) { seen.push_back(value); });
+	numbers.connect([&seen](int value) { seen.push_back(value * 10); });
+	numbers.connect(unique_function<void(int)>([&seen](int value) { seen.push_back(value * 100); }));
+	REQUIRE(numbers.size() == 3);
+
+	numbers.emit(1);
+	numbers(2);
+	REQUIRE(seen == std::vector<int>{ 1, 10, 100, 2, 20, 200 });
+}
+
+TEST_CASE("signal disconnects slots through their connection")
+{
+	signal<void(const std::string&)> text;
+	std::string seen;
+	auto first = text.connect([&seen](const std::string& value) { seen += "a" + value; });
+	auto second = text.connect([&seen](const std::string& value) { seen += "b" + value; });
+	auto third = text.connect([&seen](const std::string& value) { seen += "c" + value; });
+
+	REQUIRE(text.disconnect(second));
+	REQUIRE(!text.disconnect(second));
+	text.emit("1");
+	REQUIRE(seen == "a1c1");
+
+	// The connection index is reused, but the stale connection stays stale
+	auto fourth = text.connect([&seen](const std::string& value) { seen += "d" + value; });
+	REQUIRE(!text.disconnect(second));
+	REQUIRE(text.disconnect(first));
+	text.emit("2");
+	REQUIRE(seen == "a1c1c2d2");
+	REQUIRE(text.disconnect(third));
+	REQUIRE(text.disconnect(fourth));
+	REQUIRE(text.empty());
+	REQUIRE(!text.disconnect(signal<void(const std::string&)>::connection()));
+}
+
+TEST_CASE("signal stores slots of any size and destroys them")
+{
+	auto tracker = std::make_shared<int>(0);
+	{
+		signal<void()> changed;
+		std::array<char, 200> big{};
+		big[199] = 7;
+		int sum = 0;
+		changed.connect([big, &sum]() { sum += big[199]; });
+		auto small = changed.connect([tracker, &sum]() { sum += 1; });
+		for (int i = 0; i < 100; ++i)
+		{
+			changed.connect([tracker]() {});
+		}
+		REQUIRE(tracker.use_count() == 102);
+		changed.emit();
+		REQUIRE(sum == 8);
+
+		REQUIRE(changed.disconnect(small));
+		REQUIRE(tracker.use_count() == 101);
+	}
+	REQUIRE(tracker.use_count() == 1);
+}
+
+TEST_CASE("signal keeps the order of slots across many disconnects")
+{
+	signal<void(std::vector<int>&)> collect;
+	std::vector<signal<void(std::vector<int>&)>::connection> connections;
+	for (int i = 0; i < 1000; ++i)
+	{
+		connections.push_back(collect.connect([i](std::vector<int>& seen) { seen.push_back(i); }));
+	}
+	for (int i = 0; i < 1000; ++i)
+	{
+		if (i % 3 != 0)
+		{
+			REQUIRE(collect.disconnect(connections[i]));
+		}
+	}
+	std::vector<int> seen;
+	collect.emit(seen);
+	REQUIRE(seen.size() == 334);
+	for (std::size_t i = 0; i < seen.size(); ++i)
+	{
+		REQUIRE(seen[i] == static_cast<int>(i) * 3);
+	}
+	// Connections still disconnect the right slots after compaction moved them
+	REQUIRE(collect.disconnect(connections[999]));
+	seen.clear();
+	collect.emit(seen);
+	REQUIRE(seen.size() == 333);
+	REQUIRE(seen.back() == 996);
+}
+
+TEST_CASE("signal may be changed and emitted by its own slots")
+{
+	signal<void(int)> nested;
+	std::vector<std::string> seen;
+	signal<void(int)>::connection self;
+	signal<void(int)>::connection victim;
+
+	self = nested.connect([&](int depth)
+	{
+		seen.push_back("self" + std::to_string(depth));
+		if (depth == 0)
+		{
+			// Connected while emitting, first called by the next emit
+			nested.connect([&seen](int depth) { seen.push_back("late" + std::to_string(depth)); });
+			nested.emit(1);
+			nested.disconnect(victim);
+			nested.disconnect(self);
+		}
+	});
+	victim = nested.connect([&seen](int depth) { seen.push_back("victim" + std::to_string(depth)); });
+
+	nested.emit(0);
+	REQUIRE(seen == std::vector<std::string>{ "self0", "self1", "victim1" });
+	REQUIRE(nested.size() == 1);
+
+	seen.clear();
+	nested.emit(2);
+	REQUIRE(seen == std::vector<std::string>{ "late2" });
+}
@@ -0,0 +1,233 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "gravel/dynamic_value.hpp"
+#include "gravel/spsc_ring.hpp"
+#include "gravel/unique_function.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	class Message
+	{
+	public:
+		Message(int* destructor_counter, int value)
+			: m_destructor_counter(destructor_counter)
+			, m_value(value)
+		{
+
+		}
+
+		Message(Message&& other) noexcept
+			: m_destructor_counter(std::exchange(other.m_destructor_counter, nullptr))
+			, m_value(other.m_value)
+		{
+
+		}
+
+		virtual ~Message()
+		{
+			if (m_destructor_counter)
+			{
+				*m_destructor_counter += 1;
+			}
+		}
+
+		virtual int value() const
+		{
+			return m_value;
+		}
+
+		int* m_destructor_counter;
+		int m_value;
+	};
+
+	class LargeMessage : public Message
+	{
+	public:
+		LargeMessage(int* destructor_counter, int value)
+			: Message(destructor_counter, value)
+		{
+
+		}
+
+		int value() const override
+		{
+			return m_value * 10;
+		}
+
+		std::array<int, 32> m_padding = {};
+	};
+
+	using MessageValue = dynamic_value<Message, Properties<Attr::Movable>>;
+}
+
+TEST_CASE("SPSC ring basics")
+{
+	spsc_ring<std::string> ring(3);
+	REQUIRE(ring.capacity() == 4);
+	REQUIRE(ring.empty());
+	REQUIRE(!ring.try_pop());
+
+	REQUIRE(ring.try_push(std::string("first")));
+	REQUIRE(ring.try_emplace("second"));
+	REQUIRE(ring.try_emplace("third"));
+	REQUIRE(ring.try_emplace("fourth"));
+	REQUIRE(!std::as_const(ring).empty());
+
+	std::string rejected = "fifth";
+	REQUIRE(!ring.try_push(std::move(rejected)));
+	REQUIRE(rejected == "fifth");
+
+	REQUIRE(ring.try_pop() == "first");
+	REQUIRE(ring.try_push(std::move(rejected)));
+	REQUIRE(ring.try_pop() == "second");
+	REQUIRE(ring.try_pop() == "third");
+	REQUIRE(ring.try_pop() == "fourth");
+	REQUIRE(ring.try_pop() == "fifth");
+	REQUIRE(ring.empty());
+}
+
+TEST_CASE("SPSC ring of functions")
+{
+	spsc_ring<unique_function<void()>> ring(16);
+	std::vector<int> order;
+	for (int i = 0; i < 10; ++i)
+	{
+		REQUIRE(ring.try_emplace([&order, i]() { order.push_back(i); }));
+	}
+
+	REQUIRE(ring.consume([](unique_function<void()>&& task) { task(); }, 4) == 4);
+	REQUIRE(order.size() == 4);
+	REQUIRE(ring.consume([](unique_function<void()>&& task) { task(); }) == 6);
+	REQUIRE(order == std::vector<int>{ 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 });
+}
+
+TEST_CASE("SPSC ring relocates in bulk")
+{
+	int dcounter = 0;
+	spsc_ring<MessageValue> ring(8);
+
+	// Move the indices so that the bulk operations wrap around the end of the ring
+	for (int i = 0; i < 6; ++i)
+	{
+		REQUIRE(ring.try_emplace(MessageValue::make_emplaced<Message>(nullptr, i)));
+		REQUIRE(ring.try_pop());
+	}
+
+	alignas(MessageValue) std::array<std::uint8_t, sizeof(MessageValue) * 10> storage;
+	MessageValue* batch = reinterpret_cast<MessageValue*>(storage.data());
+	for (int i = 0; i < 10; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			new (batch + i) MessageValue(MessageValue::make_emplaced<Message>(&dcounter, i));
+		}
+		else
+		{
+			new (batch + i) MessageValue(MessageValue::make_emplaced<LargeMessage>(&dcounter, i));
+		}
+	}
+
+	REQUIRE(ring.push_n(batch, 10) == 8);
+	// The two elements that did not fit are still owned by the caller
+	REQUIRE(batch[8]->value() == 8);
+	REQUIRE(batch[9]->value() == 90);
+	batch[8].~MessageValue();
+	batch[9].~MessageValue();
+	dcounter = 0;
+
+	REQUIRE(ring.pop_n(batch, 3) == 3);
+	REQUIRE(ring.pop_n(batch + 3, 10) == 5);
+	REQUIRE(ring.empty());
+	REQUIRE(dcounter == 0);
+	for (int i = 0; i < 8; ++i)
+	{
+		REQUIRE(batch[i]->value() == (i % 2 == 0 ? i : i * 10));
+		batch[i].~MessageValue();
+	}
+	REQUIRE(dcounter == 8);
+}
+
+TEST_CASE("SPSC ring destroys remaining elements")
+{
+	int dcounter = 0;
+	{
+		spsc_ring<Message> ring(4);
+		ring.try_emplace(&dcounter, 1);
+		ring.try_emplace(&dcounter, 2);
+		ring.try_emplace(&dcounter, 3);
+		REQUIRE(ring.try_pop()->m_value == 1);
+		REQUIRE(dcounter == 1);
+	}
+	REQUIRE(dcounter == 3);
+}
+
+TEST_CASE("SPSC ring consumes the element a throwing function was called with")
+{
+	int dcounter = 0;
+	{
+		spsc_ring<Message> ring(8);
+		for (int i = 0; i < 4; ++i)
+		{
+			REQUIRE(ring.try_emplace(&dcounter, i));
+		}
+
+		std::vector<int> seen;
+		REQUIRE_THROWS_AS(ring.consume([&seen](Message&& message)
+		{
+			seen.push_back(message.value());
+			if (message.value() == 1)
+			{
+				throw std::runtime_error("consume");
+			}
+		}), std::runtime_error);
+		REQUIRE(seen == std::vector<int>{ 0, 1 });
+		REQUIRE(dcounter == 2);
+
+		auto next = ring.try_pop();
+		REQUIRE(next);
+		REQUIRE(next->value() == 2);
+	}
+	REQUIRE(dcounter == 4);
+}
+
+TEST_CASE("SPSC ring concurrent producer and consumer")
+{
+	const int total = 200000;
+
+	spsc_ring<unique_function<int()>> ring(64);
+	std::thread producer([&ring]()
+	{
+		int i = 0;
+		while (i < total)
+		{
+			if (ring.try_emplace([i]() { return i; }))
+			{
+				++i;
+			}
+		}
+	});
+
+	int expected = 0;
+	bool ordered = true;
+	while (expected < total)
+	{
+		ring.consume([&](unique_function<int()>&& task)
+		{
+			ordered = ordered && task() == expected;
+			++expected;
+		}, 16);
+	}
+	producer.join();
+
+	REQUIRE(ordered);
+	REQUIRE(ring.empty());
+}
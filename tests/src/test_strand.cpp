@@ -0,0 +1,135 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "gravel/strand.hpp"
+#include "gravel/thread_pool.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	//!
+	//! Executor that only runs tasks when asked to, to observe what a strand submits
+	//!
+	class ManualExecutor
+	{
+	public:
+		void submit(unique_function<void()>&& task)
+		{
+			m_tasks.push_back(std::move(task));
+		}
+
+		bool run_one()
+		{
+			if (m_tasks.empty())
+			{
+				return false;
+			}
+			unique_function<void()> task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+			task();
+			return true;
+		}
+
+		std::size_t size() const
+		{
+			return m_tasks.size();
+		}
+
+	private:
+		std::deque<unique_function<void()>> m_tasks;
+	};
+}
+
+TEST_CASE("Strand runs tasks in order in batches")
+{
+	ManualExecutor executor;
+	strand<ManualExecutor> serial(executor, 2);
+	std::vector<int> order;
+
+	for (int i = 0; i < 5; ++i)
+	{
+		serial.submit([&order, i]() { order.push_back(i); });
+	}
+	// Only the first submit schedules a drain
+	REQUIRE(executor.size() == 1);
+
+	REQUIRE(executor.run_one());
+	REQUIRE(order == std::vector<int>{ 0, 1 });
+	// The drain gave the executor back and rescheduled itself
+	REQUIRE(executor.size() == 1);
+
+	while (executor.run_one())
+	{
+	}
+	REQUIRE(order == std::vector<int>{ 0, 1, 2, 3, 4 });
+
+	// Idle again, so the next submit schedules a new drain
+	serial.submit([&order]() { order.push_back(5); });
+	REQUIRE(executor.size() == 1);
+	REQUIRE(executor.run_one());
+	REQUIRE(order.back() == 5);
+}
+
+TEST_CASE("Strand dispatch runs inline from within the strand")
+{
+	inline_executor executor;
+	strand<inline_executor> serial(executor);
+	std::vector<int> order;
+
+	REQUIRE(!serial.running_in_this_thread());
+	serial.submit([&]()
+	{
+		REQUIRE(serial.running_in_this_thread());
+		serial.submit([&order]() { order.push_back(2); });
+		serial.dispatch([&order]() { order.push_back(1); });
+		order.push_back(0);
+	});
+	REQUIRE(order == std::vector<int>{ 1, 0, 2 });
+}
+
+TEST_CASE("Strand never runs tasks concurrently")
+{
+	const int producer_count = 4;
+	const int per_producer = 5000;
+
+	thread_pool pool(4);
+	strand<thread_pool> serial(pool, 16);
+	std::atomic<int> active = 0;
+	std::atomic<int> done = 0;
+	bool overlapped = false;
+	// Only touched from strand tasks, so no synchronization is needed
+	std::vector<int> next_expected(producer_count, 0);
+	bool ordered = true;
+
+	std::vector<std::thread> producers;
+	for (int p = 0; p < producer_count; ++p)
+	{
+		producers.emplace_back([&, p]()
+		{
+			for (int i = 0; i < per_producer; ++i)
+			{
+				serial.submit([&, p, i]()
+				{
+					overlapped = overlapped || active.fetch_add(1) != 0;
+					ordered = ordered && next_expected[p] == i;
+					next_expected[p] = i + 1;
+					active.fetch_sub(1);
+					done.fetch_add(1, std::memory_order_release);
+				});
+			}
+		});
+	}
+	for (auto& producer : producers)
+	{
+		producer.join();
+	}
+	pool.run_until([&done]() { return done.load(std::memory_order_acquire) == producer_count * per_producer; });
+
+	REQUIRE(!overlapped);
+	REQUIRE(ordered);
+}
@@ -0,0 +1,190 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gravel/strand.hpp"
+#include "gravel/task.hpp"
+#include "gravel/thread_pool.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	task<int> answer()
+	{
+		co_return 42;
+	}
+
+	task<int> add(int left, int right)
+	{
+		co_return co_await answer() - 42 + left + right;
+	}
+
+	task<std::string> describe(bool& started)
+	{
+		started = true;
+		co_return "described";
+	}
+
+	task<void> fail()
+	{
+		throw std::runtime_error("failed");
+		co_return;
+	}
+
+	task<int> depth(int remaining)
+	{
+		if (remaining == 0)
+		{
+			co_return 0;
+		}
+		co_return 1 + co_await depth(remaining - 1);
+	}
+
+	task<std::thread::id> hop(thread_pool& pool)
+	{
+		co_await pool.schedule();
+		co_return std::this_thread::get_id();
+	}
+
+	//! Captures more than fits a small frame, to use a larger size class
+	task<int> large_frame(int seed)
+	{
+		std::array<int, 256> values{};
+		for (std::size_t i = 0; i < values.size(); ++i)
+		{
+			values[i] = seed + static_cast<int>(i);
+		}
+		co_await answer();
+		int sum = 0;
+		for (int value : values)
+		{
+			sum += value;
+		}
+		co_return sum;
+	}
+}
+
+TEST_CASE("task returns its value to the awaiter")
+{
+	REQUIRE(sync_wait(answer()) == 42);
+	REQUIRE(sync_wait(add(1, 2)) == 3);
+}
+
+TEST_CASE("task is lazy")
+{
+	bool started = false;
+	task<std::string> pending = describe(started);
+	REQUIRE(!started);
+	REQUIRE(!pending.done());
+	REQUIRE(sync_wait(std::move(pending)) == "described");
+	REQUIRE(started);
+}
+
+TEST_CASE("task that is never awaited destroys its frame")
+{
+	auto tracked = std::make_shared<int>(0);
+	{
+		auto capture = [](std::shared_ptr<int> value) -> task<int> { co_return *value; };
+		task<int> pending = capture(tracked);
+		REQUIRE(tracked.use_count() == 2);
+	}
+	REQUIRE(tracked.use_count() == 1);
+}
+
+TEST_CASE("task passes exceptions to the awaiter")
+{
+	REQUIRE_THROWS_AS(sync_wait(fail()), std::runtime_error);
+}
+
+TEST_CASE("task start completes a future")
+{
+	future<int> result = start(answer());
+	REQUIRE(result.is_ready());
+	REQUIRE(result.get() == 42);
+}
+
+TEST_CASE("task resumes the awaiters of deep chains")
+{
+	REQUIRE(sync_wait(depth(1000)) == 1000);
+}
+
+TEST_CASE("task uses pooled frames of larger size classes")
+{
+	REQUIRE(sync_wait(large_frame(1)) == 256 + 255 * 256 / 2);
+	REQUIRE(sync_wait(large_frame(2)) == 2 * 256 + 255 * 256 / 2);
+}
+
+TEST_CASE("task continues on the thread_pool after scheduling")
+{
+	thread_pool pool(2);
+	const std::thread::id resumed_on = sync_wait(hop(pool));
+	REQUIRE(resumed_on != std::this_thread::get_id());
+}
+
+TEST_CASE("task continues on a strand after scheduling")
+{
+	thread_pool pool(4);
+	strand<thread_pool> serial(pool);
+	int counter = 0;
+	std::atomic<bool> outside{ false };
+	auto increment = [](strand<thread_pool>& serial, int& counter, std::atomic<bool>& outside) -> task<void>
+	{
+		co_await serial.schedule();
+		if (!serial.running_in_this_thread())
+		{
+			outside.store(true);
+		}
+		for (int i = 0; i < 100; ++i)
+		{
+			++counter;
+		}
+	};
+
+	future<void> first = start(increment(serial, counter, outside));
+	future<void> second = start(increment(serial, counter, outside));
+	first.get();
+	second.get();
+	REQUIRE(counter == 200);
+	REQUIRE(!outside.load());
+}
+
+TEST_CASE("task continues on any executor through schedule")
+{
+	inline_executor executor;
+	auto scheduled = [](inline_executor& executor) -> task<int>
+	{
+		co_await schedule(executor);
+		co_return 5;
+	};
+	REQUIRE(sync_wait(scheduled(executor)) == 5);
+}
+
+TEST_CASE("task runs many coroutines concurrently on a pool")
+{
+	thread_pool pool(4);
+	std::atomic<int> finished{ 0 };
+	auto work = [](thread_pool& pool, std::atomic<int>& finished) -> task<void>
+	{
+		co_await pool.schedule();
+		co_await answer();
+		finished.fetch_add(1, std::memory_order_relaxed);
+	};
+
+	std::vector<future<void>> results;
+	for (int i = 0; i < 1000; ++i)
+	{
+		results.push_back(start(work(pool, finished)));
+	}
+	for (future<void>& result : results)
+	{
+		result.get();
+	}
+	REQUIRE(finished.load() == 1000);
+}
@@ -0,0 +1,140 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "gravel/task_graph.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	//!
+	//! Records the order tasks ran in
+	//!
+	class Journal
+	{
+	public:
+		void record(int id)
+		{
+			std::lock_guard lock(m_mutex);
+			m_order.push_back(id);
+		}
+
+		std::size_t position(int id) const
+		{
+			for (std::size_t i = 0; i < m_order.size(); ++i)
+			{
+				if (m_order[i] == id)
+				{
+					return i;
+				}
+			}
+			return m_order.size();
+		}
+
+		std::size_t size() const
+		{
+			return m_order.size();
+		}
+
+		void clear()
+		{
+			m_order.clear();
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::vector<int> m_order;
+	};
+}
+
+TEST_CASE("Task graph runs nodes after their predecessors")
+{
+	thread_pool pool(4);
+	task_graph graph;
+	Journal journal;
+
+	// A diamond with a tail: 0 -> 1, 2 -> 3 -> 4
+	auto a = graph.emplace([&journal]() { journal.record(0); });
+	auto b = graph.emplace([&journal]() { journal.record(1); });
+	auto c = graph.emplace([&journal]() { journal.record(2); });
+	auto d = graph.emplace([&journal]() { journal.record(3); });
+	auto e = graph.emplace([&journal]() { journal.record(4); });
+	a.precede(b).precede(c);
+	d.succeed(b).succeed(c);
+	d.precede(e);
+	REQUIRE(graph.size() == 5);
+
+	// Runs are repeatable without rebuilding the graph
+	for (int run = 0; run < 20; ++run)
+	{
+		journal.clear();
+		graph.run(pool);
+		REQUIRE(journal.size() == 5);
+		REQUIRE(journal.position(0) < journal.position(1));
+		REQUIRE(journal.position(0) < journal.position(2));
+		REQUIRE(journal.position(1) < journal.position(3));
+		REQUIRE(journal.position(2) < journal.position(3));
+		REQUIRE(journal.position(3) < journal.position(4));
+	}
+}
+
+TEST_CASE("Task graph can grow between runs")
+{
+	thread_pool pool(2);
+	task_graph graph;
+	std::atomic<int> counter = 0;
+
+	graph.run(pool);
+
+	auto first = graph.emplace([&counter]() { counter += 1; });
+	graph.run(pool);
+	REQUIRE(counter == 1);
+
+	auto second = graph.emplace([&counter]() { counter += 10; });
+	auto third = graph.emplace([&counter]() { counter += 100; });
+	first.precede(third);
+	second.precede(third);
+	graph.run(pool);
+	REQUIRE(counter == 112);
+}
+
+TEST_CASE("Task graph wide and deep")
+{
+	thread_pool pool(4);
+	task_graph graph;
+	std::atomic<long long> sum = 0;
+	long long chain = 0;
+
+	auto source = graph.emplace([]() {});
+	auto sink = graph.emplace([]() {});
+	for (int i = 1; i <= 1000; ++i)
+	{
+		graph.emplace([&sum, i]() { sum += i; }).succeed(source).precede(sink);
+	}
+
+	auto previous = sink;
+	for (int i = 0; i < 1000; ++i)
+	{
+		auto next = graph.emplace([&chain, i]() { chain = (chain * 3 + i) % 1000003; });
+		previous.precede(next);
+		previous = next;
+	}
+
+	long long expected_chain = 0;
+	for (int i = 0; i < 1000; ++i)
+	{
+		expected_chain = (expected_chain * 3 + i) % 1000003;
+	}
+
+	for (int run = 0; run < 3; ++run)
+	{
+		sum = 0;
+		chain = 0;
+		graph.run(pool);
+		REQUIRE(sum == 500500);
+		REQUIRE(chain == expected_chain);
+	}
+}
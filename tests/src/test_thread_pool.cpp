@@ -0,0 +1,121 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gravel/thread_pool.hpp"
+
+using namespace gravel;
+
+namespace
+{
+	struct Fibonacci
+	{
+		thread_pool* pool;
+		int n;
+		long long result = 0;
+
+		void operator()()
+		{
+			if (n < 2)
+			{
+				result = n;
+				return;
+			}
+			Fibonacci first{ pool, n - 1 };
+			Fibonacci second{ pool, n - 2 };
+			std::atomic<bool> first_done = false;
+			pool->submit([&first, &first_done]()
+			{
+				first();
+				first_done.store(true, std::memory_order_release);
+			});
+			second();
+			pool->run_until([&first_done]() { return first_done.load(std::memory_order_acquire); });
+			result = first.result + second.result;
+		}
+	};
+}
+
+TEST_CASE("Thread pool runs submitted tasks")
+{
+	std::atomic<int> counter = 0;
+	{
+		thread_pool pool(2);
+		REQUIRE(pool.size() == 2);
+		REQUIRE(!pool.in_worker());
+		for (int i = 0; i < 1000; ++i)
+		{
+			pool.submit([&counter]() { counter += 1; });
+		}
+		pool.run_until([&counter]() { return counter.load() == 1000; });
+	}
+	REQUIRE(counter == 1000);
+}
+
+TEST_CASE("Thread pool destructor runs remaining tasks")
+{
+	std::atomic<int> counter = 0;
+	{
+		thread_pool pool(2);
+		for (int i = 0; i < 100; ++i)
+		{
+			pool.submit([&counter, &pool]()
+			{
+				// Tasks submitted from a worker go to its own deque, and must run as well
+				pool.submit([&counter]() { counter += 1; });
+				counter += 1;
+			});
+		}
+	}
+	REQUIRE(counter == 200);
+}
+
+TEST_CASE("Thread pool tasks know they are in a worker")
+{
+	thread_pool pool(1);
+	thread_pool other(1);
+	std::atomic<int> checks = 0;
+	pool.submit([&]()
+	{
+		checks += pool.in_worker() && !other.in_worker() ? 1 : 100;
+	});
+	// Not run_until, which would let this thread run the task itself
+	while (checks.load() == 0)
+	{
+		std::this_thread::yield();
+	}
+	REQUIRE(checks == 1);
+}
+
+TEST_CASE("Thread pool fork-join")
+{
+	thread_pool pool(4);
+	Fibonacci root{ &pool, 18 };
+	std::atomic<bool> done = false;
+	pool.submit([&root, &done]()
+	{
+		root();
+		done.store(true, std::memory_order_release);
+	});
+	pool.run_until([&done]() { return done.load(std::memory_order_acquire); });
+	REQUIRE(root.result == 2584);
+}
+
+TEST_CASE("Thread pool wakes parked workers")
+{
+	thread_pool pool(2);
+	for (int round = 0; round < 50; ++round)
+	{
+		// Give the workers time to park between rounds
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+		std::atomic<bool> done = false;
+		pool.submit([&done]() { done.store(true); });
+		while (!done.load())
+		{
+			std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,123 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gravel/detail/thread_records.hpp"
+
+using namespace gravel::detail;
+
+namespace
+{
+	struct Record
+	{
+		std::atomic<bool> in_use{ true };
+		Record* next = nullptr;
+		int uses = 0;
+	};
+
+	class State
+	{
+	public:
+		State()
+		{
+			s_live += 1;
+		}
+
+		State(const State&) = delete;
+
+		~State()
+		{
+			s_live -= 1;
+		}
+
+		Record& acquire_record()
+		{
+			acquired += 1;
+			return records.acquire([]() { return new Record(); });
+		}
+
+		void release_record(Record& record)
+		{
+			released += 1;
+			RecordList<Record>::release(record);
+		}
+
+		static inline std::atomic<int> s_live = 0;
+
+		RecordList<Record> records;
+		std::atomic<int> acquired = 0;
+		std::atomic<int> released = 0;
+	};
+
+	using Records = ThreadRecordCache<State, Record>;
+}
+
+TEST_CASE("Thread record cache")
+{
+	SECTION("Returns the same record for the same state")
+	{
+		auto first = std::make_shared<State>();
+		auto second = std::make_shared<State>();
+		Record& record = Records::record_for(first);
+		REQUIRE(&Records::record_for(second) != &record);
+		REQUIRE(&Records::record_for(first) == &record);
+		REQUIRE(first->acquired == 1);
+		REQUIRE(second->acquired == 1);
+	}
+	SECTION("Does not keep destroyed states alive")
+	{
+		const int live = State::s_live;
+		for (int i = 0; i < 1000; ++i)
+		{
+			auto state = std::make_shared<State>();
+			Records::record_for(state).uses += 1;
+			Records::record_for(state).uses += 1;
+			REQUIRE(State::s_live == live + 1);
+		}
+		REQUIRE(State::s_live == live);
+
+		// A new state is never mistaken for a dead one at the same address
+		for (int i = 0; i < 100; ++i)
+		{
+			auto state = std::make_shared<State>();
+			REQUIRE(Records::record_for(state).uses == 0);
+			Records::record_for(state).uses += 1;
+		}
+	}
+	SECTION("Gives records back when the thread exits")
+	{
+		auto state = std::make_shared<State>();
+		Record* used = nullptr;
+		std::thread([&]() { used = &Records::record_for(state); }).join();
+		REQUIRE(state->released == 1);
+		REQUIRE(!used->in_use);
+		REQUIRE(&Records::record_for(state) == used);
+	}
+	SECTION("Threads outliving a state drop it")
+	{
+		const int live = State::s_live;
+		auto state = std::make_shared<State>();
+		std::atomic<bool> used = false;
+		std::atomic<bool> destroyed = false;
+		std::thread thread([&]()
+		{
+			Records::record_for(state);
+			used = true;
+			while (!destroyed)
+			{
+				std::this_thread::yield();
+			}
+		});
+		while (!used)
+		{
+			std::this_thread::yield();
+		}
+		state.reset();
+		REQUIRE(State::s_live == live);
+		destroyed = true;
+		thread.join();
+	}
+}
@@ -0,0 +1,204 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "gravel/timer_wheel.hpp"
+
+using namespace gravel;
+
+TEST_CASE("timer_wheel runs a callback once its delay has passed")
+{
+	timer_wheel wheel;
+	int calls = 0;
+	wheel.schedule(10, [&calls]() { ++calls; });
+	REQUIRE(wheel.size() == 1);
+	REQUIRE(wheel.next_expiry() == 10);
+
+	REQUIRE(wheel.advance(9) == 0);
+	REQUIRE(calls == 0);
+	REQUIRE(wheel.advance(1) == 1);
+	REQUIRE(calls == 1);
+	REQUIRE(wheel.empty());
+	REQUIRE(!wheel.next_expiry());
+}
+
+TEST_CASE("timer_wheel treats a delay of zero as one tick")
+{
+	timer_wheel wheel(100);
+	int calls = 0;
+	wheel.schedule(0, [&calls]() { ++calls; });
+	REQUIRE(wheel.advance(0) == 0);
+	REQUIRE(wheel.advance(1) == 1);
+	REQUIRE(calls == 1);
+}
+
+TEST_CASE("timer_wheel runs timers in order of expiry across levels")
+{
+	timer_wheel wheel(12345);
+	std::vector<std::uint64_t> fired;
+	const std::vector<std::uint64_t> delays = { 1, 63, 64, 65, 200, 4095, 4096, 4097, 300000, 20'000'000, 70 };
+	for (std::uint64_t delay : delays)
+	{
+		wheel.schedule(delay, [&fired, &wheel]() { fired.push_back(wheel.now()); });
+	}
+
+	wheel.advance(30'000'000);
+	REQUIRE(fired.size() == delays.size());
+	std::vector<std::uint64_t> expected;
+	for (std::uint64_t delay : delays)
+	{
+		expected.push_back(12345 + delay);
+	}
+	std::sort(expected.begin(), expected.end());
+	REQUIRE(fired == expected);
+}
+
+TEST_CASE("timer_wheel skips empty windows at every level")
+{
+	// Stepping through every 64 tick window on the way would take billions of iterations
+	timer_wheel wheel(99);
+	std::vector<std::uint64_t> fired;
+	for (std::uint64_t delay : { std::uint64_t(1) << 40, (std::uint64_t(1) << 52) + 12345 })
+	{
+		wheel.schedule(delay, [&fired, &wheel]() { fired.push_back(wheel.now()); });
+	}
+	REQUIRE(wheel.advance(std::uint64_t(1) << 60) == 2);
+	REQUIRE(fired == std::vector<std::uint64_t>{ 99 + (std::uint64_t(1) << 40), 99 + (std::uint64_t(1) << 52) + 12345 });
+	REQUIRE(wheel.now() == 99 + (std::uint64_t(1) << 60));
+}
+
+TEST_CASE("timer_wheel fires on the exact tick when advanced one tick at a time")
+{
+	timer_wheel wheel(7);
+	std::vector<std::uint64_t> fired;
+	for (std::uint64_t delay : { 5, 64, 130, 4100 })
+	{
+		wheel.schedule(delay, [&fired, &wheel]() { fired.push_back(wheel.now()); });
+	}
+	for (int i = 0; i < 5000; ++i)
+	{
+		wheel.advance(1);
+	}
+	REQUIRE(fired == std::vector<std::uint64_t>{ 12, 71, 137, 4107 });
+}
+
+TEST_CASE("timer_wheel cancel prevents the callback and destroys it")
+{
+	timer_wheel wheel;
+	auto tracked = std::make_shared<int>(0);
+	bool called = false;
+	timer_wheel::handle timer = wheel.schedule(100, [tracked, &called]() { called = true; });
+	REQUIRE(tracked.use_count() == 2);
+
+	REQUIRE(wheel.cancel(timer));
+	REQUIRE(tracked.use_count() == 1);
+	REQUIRE(!wheel.cancel(timer));
+	REQUIRE(wheel.empty());
+	wheel.advance(200);
+	REQUIRE(!called);
+}
+
+TEST_CASE("timer_wheel handles become stale once their slot is reused")
+{
+	timer_wheel wheel;
+	timer_wheel::handle first = wheel.schedule(1, []() {});
+	wheel.advance(1);
+	int calls = 0;
+	timer_wheel::handle second = wheel.schedule(1, [&calls]() { ++calls; });
+	REQUIRE(!(first == second));
+	REQUIRE(!wheel.cancel(first));
+	REQUIRE(!wheel.cancel(timer_wheel::handle()));
+	wheel.advance(1);
+	REQUIRE(calls == 1);
+}
+
+TEST_CASE("timer_wheel callbacks may cancel and schedule timers of the same batch")
+{
+	timer_wheel wheel;
+	std::vector<int> fired;
+	timer_wheel::handle first;
+	timer_wheel::handle second;
+	// Both are in the same slot, whichever runs first cancels the other
+	first = wheel.schedule(5, [&]()
+	{
+		fired.push_back(1);
+		REQUIRE(wheel.cancel(second));
+		wheel.schedule(1, [&fired]() { fired.push_back(3); });
+	});
+	second = wheel.schedule(5, [&]()
+	{
+		fired.push_back(2);
+		REQUIRE(wheel.cancel(first));
+		wheel.schedule(1, [&fired]() { fired.push_back(3); });
+	});
+
+	REQUIRE(wheel.advance(5) == 1);
+	REQUIRE(fired.size() == 1);
+	REQUIRE(wheel.advance(1) == 1);
+	REQUIRE(fired.back() == 3);
+	REQUIRE(wheel.empty());
+}
+
+TEST_CASE("timer_wheel next_expiry is a lower bound of the next callback")
+{
+	timer_wheel wheel(1000);
+	wheel.schedule(500, []() {});
+	const std::uint64_t bound = *wheel.next_expiry();
+	REQUIRE(bound > 1000);
+	REQUIRE(bound <= 1500);
+
+	REQUIRE(wheel.advance_to(bound - 1) == 0);
+	while (wheel.advance_to(*wheel.next_expiry()) == 0)
+	{
+	}
+	REQUIRE(wheel.now() == 1500);
+}
+
+TEST_CASE("timer_wheel matches a sorted reference under random use")
+{
+	using Key = std::pair<std::uint64_t, int>;
+	std::mt19937_64 random(42);
+	timer_wheel wheel;
+	std::set<Key> reference;
+	std::vector<std::pair<timer_wheel::handle, Key>> live;
+	std::vector<Key> fired;
+
+	for (int round = 0; round < 200; ++round)
+	{
+		for (int i = 0; i < 50; ++i)
+		{
+			const std::uint64_t delay = 1 + random() % (std::uint64_t(1) << (random() % 24));
+			const Key key(wheel.now() + delay, round * 50 + i);
+			reference.insert(key);
+			live.emplace_back(wheel.schedule(delay, [&fired, &wheel, key]() { fired.emplace_back(wheel.now(), key.second); }), key);
+		}
+		for (int i = 0; i < 10 && !live.empty(); ++i)
+		{
+			const std::size_t victim = random() % live.size();
+			REQUIRE(wheel.cancel(live[victim].first));
+			reference.erase(live[victim].second);
+			live[victim] = live.back();
+			live.pop_back();
+		}
+
+		const std::uint64_t target = wheel.now() + random() % 100000;
+		fired.clear();
+		wheel.advance_to(target);
+		std::vector<Key> expected;
+		while (!reference.empty() && reference.begin()->first <= target)
+		{
+			expected.push_back(*reference.begin());
+			reference.erase(reference.begin());
+		}
+		// Timers of the same tick run in no particular order
+		std::sort(fired.begin(), fired.end());
+		REQUIRE(fired == expected);
+		std::erase_if(live, [target](const auto& entry) { return entry.second.first <= target; });
+	}
+	REQUIRE(wheel.size() == reference.size());
+}
@@ -1,5 +1,6 @@
 #include "catch2/catch_test_macros.hpp"
 
+#include <array>
 #include <future>
 
 #include "gravel/unique_function.hpp"
@@ -107,6 +108,15 @@ TEST_CASE("lambdas")
 
 		REQUIRE(f2(12) == true);
 	}
+	SECTION("construct, move and call with heap allocated capture")
+	{
+		std::array<int, 32> captured = {};
+		captured[5] = 42;
+		unique_function<int()> f([captured]() { return captured[5]; });
+		unique_function<int()> f2 = std::move(f);
+
+		REQUIRE(f2() == 42);
+	}
 }
 
 TEST_CASE("primitive assignments")
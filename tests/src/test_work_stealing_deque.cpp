@@ -0,0 +1,112 @@
+#include "catch2/catch_test_macros.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gravel/unique_function.hpp"
+#include "gravel/work_stealing_deque.hpp"
+
+using namespace gravel;
+
+TEST_CASE("Work stealing deque basics")
+{
+	work_stealing_deque<int> deque(3);
+	REQUIRE(deque.capacity() == 4);
+	REQUIRE(deque.empty());
+	REQUIRE(!deque.pop());
+	REQUIRE(!deque.steal());
+
+	for (int i = 0; i < 4; ++i)
+	{
+		REQUIRE(deque.try_push(int(i)));
+	}
+	REQUIRE(!deque.try_push(4));
+	REQUIRE(deque.size() == 4);
+
+	// The owner takes the newest element, thieves the oldest
+	REQUIRE(deque.pop() == 3);
+	REQUIRE(deque.steal() == 0);
+	REQUIRE(deque.try_emplace(5));
+	REQUIRE(deque.pop() == 5);
+	REQUIRE(deque.pop() == 2);
+	REQUIRE(deque.steal() == 1);
+	REQUIRE(!deque.pop());
+	REQUIRE(!deque.steal());
+}
+
+TEST_CASE("Work stealing deque of functions")
+{
+	std::vector<int> order;
+	{
+		work_stealing_deque<unique_function<void()>> deque(16);
+		for (int i = 0; i < 4; ++i)
+		{
+			REQUIRE(deque.try_emplace([&order, i]() { order.push_back(i); }));
+		}
+		(*deque.steal())();
+		(*deque.pop())();
+		// The remaining ones are destroyed without being run
+	}
+	REQUIRE(order == std::vector<int>{ 0, 3 });
+}
+
+TEST_CASE("Work stealing deque owner and thieves take every element once")
+{
+	const int total = 100000;
+	const int thief_count = 3;
+
+	work_stealing_deque<int> deque(64);
+	std::atomic<bool> done = false;
+	std::atomic<long long> stolen_sum = 0;
+	std::vector<std::thread> thieves;
+	for (int t = 0; t < thief_count; ++t)
+	{
+		thieves.emplace_back([&]()
+		{
+			long long sum = 0;
+			while (!done.load())
+			{
+				if (std::optional<int> value = deque.steal())
+				{
+					sum += *value;
+				}
+			}
+			while (std::optional<int> value = deque.steal())
+			{
+				sum += *value;
+			}
+			stolen_sum += sum;
+		});
+	}
+
+	long long owned_sum = 0;
+	for (int i = 1; i <= total; ++i)
+	{
+		while (!deque.try_push(int(i)))
+		{
+			if (std::optional<int> value = deque.pop())
+			{
+				owned_sum += *value;
+			}
+		}
+		if (i % 3 == 0)
+		{
+			if (std::optional<int> value = deque.pop())
+			{
+				owned_sum += *value;
+			}
+		}
+	}
+	done.store(true);
+	for (auto& thief : thieves)
+	{
+		thief.join();
+	}
+	while (std::optional<int> value = deque.pop())
+	{
+		owned_sum += *value;
+	}
+
+	REQUIRE(owned_sum + stolen_sum == static_cast<long long>(total) * (total + 1) / 2);
+}